@@ -19,10 +19,16 @@
 
 #include "crypto/ed25519.h"
 
-void Account::init(const VerifyKey& _verifyKey)
+void Account::init(const VerifyKey& _verifyKey, uint32_t _number)
 {
   verifyKey = _verifyKey;
   nonce = 0;
+  number = _number;
+}
+
+uint32_t Account::getNumber() const
+{
+  return +number;
 }
 
 void Account::setNonce(uint64_t _nonce)
@@ -39,3 +45,13 @@ void Account::verifySignature(gsl::span<const byte> data,
   if (!ed25519_verify(sig, +verifyKey, data))
     throw Error("Account::verifySignature: invalid transaction signature");
 }
+
+std::string Account::numberKey(const Ident& account)
+{
+  return KeyPrefix + account.to_string() + "/number";
+}
+
+std::string Account::nonceKey(const Ident& account)
+{
+  return KeyPrefix + account.to_string() + "/nonce";
+}
@@ -35,7 +35,11 @@ public:
   static constexpr char KeyPrefix[] = "u/";
 
   /// Initialize account information. To be called right after the creation.
-  void init(const VerifyKey& verifyKey);
+  /// The number must come from the Registry.
+  void init(const VerifyKey& verifyKey, uint32_t number);
+
+  /// Return the dense number assigned to this account at creation.
+  uint32_t getNumber() const;
 
   /// Set the nonce of this account to the new value. Note that the new nonce
   /// must be 1 + the old nonce, or else this function will throw.
@@ -45,7 +49,16 @@ public:
   /// respect to this account's verify key.
   void verifySignature(gsl::span<const byte> data, const Signature& sig) const;
 
+  /// Return the storage key of the number of the given account. Must match the
+  /// layout of the number field below.
+  static std::string numberKey(const Ident& account);
+
+  /// Return the storage key of the nonce of the given account. Must match the
+  /// layout of the nonce field below.
+  static std::string nonceKey(const Ident& account);
+
 private:
   DATA(VerifyKey, verifyKey)
   DATA(uint256_t, nonce)
+  DATA(uint32_t, number)
 };
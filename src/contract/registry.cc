@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "registry.h"
+
+#include <limits>
+
+void Registry::init()
+{
+  accountCount = 0;
+}
+
+uint32_t Registry::assign()
+{
+  return assignRange(1);
+}
+
+uint32_t Registry::assignRange(uint32_t count)
+{
+  const uint32_t first = +accountCount;
+  if (count > std::numeric_limits<uint32_t>::max() - first)
+    throw Error("Registry::assignRange: out of account numbers");
+
+  accountCount = first + count;
+  return first;
+}
+
+uint32_t Registry::claim(const Ident& user)
+{
+  auto& number = reserved[user];
+  if (!number.exist())
+    return assign();
+
+  const uint32_t result = +number;
+  number.erase();
+  return result;
+}
+
+uint32_t Registry::reserve(const Ident& holder)
+{
+  auto& number = reserved[holder];
+  if (!number.exist())
+    number = assign();
+  return +number;
+}
+
+nonstd::optional<uint32_t> Registry::findReserved(const Ident& holder)
+{
+  auto& number = reserved[holder];
+  if (!number.exist())
+    return nonstd::nullopt;
+  return +number;
+}
+
+std::string Registry::accountCountKey()
+{
+  return KeyPrefix + Key.to_string() + "/accountCount";
+}
+
+std::string Registry::reservedKey(const Ident& holder)
+{
+  return KeyPrefix + Key.to_string() + "/reserved/" + holder.to_string();
+}
@@ -0,0 +1,76 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include "inc/essential.h"
+#include "store/contract.h"
+#include "store/data.h"
+#include "store/map.h"
+#include "util/string.h"
+
+/// Registry assigns each account a dense 32-bit number at creation. Per-account
+/// state such as token balances can then live in arrays indexed by that number
+/// rather than under one key per account. A holder that receives tokens before
+/// registering gets its number reserved then, and keeps it once it registers.
+class Registry final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  /// All registry keys must begin with "r/" namespace.
+  static constexpr char KeyPrefix[] = "r/";
+
+  /// The ident under which the one registry of the chain is created.
+  static inline const Ident Key{"accounts"s};
+
+  /// Initialize the registry. To be called right after the creation.
+  void init();
+
+  /// Assign the next account number.
+  uint32_t assign();
+
+  /// Assign count consecutive account numbers and return the first one.
+  uint32_t assignRange(uint32_t count);
+
+  /// Return the number of the new account of the given user: the one reserved
+  /// for it if it held tokens before, or the next one otherwise. The
+  /// reservation is released.
+  uint32_t claim(const Ident& user);
+
+  /// Return the number reserved for the given holder without an account,
+  /// reserving the next one if it has none yet.
+  uint32_t reserve(const Ident& holder);
+
+  /// Return the number reserved for the given holder, or nullopt if it has
+  /// none.
+  nonstd::optional<uint32_t> findReserved(const Ident& holder);
+
+  /// Return the storage key of the account count of the registry. Must match
+  /// the layout of the accountCount field below.
+  static std::string accountCountKey();
+
+  /// Return the storage key of the number reserved for the given holder. Must
+  /// match the layout of the reserved field below.
+  static std::string reservedKey(const Ident& holder);
+
+private:
+  DATA(uint32_t, accountCount)
+
+  /// Numbers reserved for holders that do not have an account yet.
+  DATAMAP(Data<uint32_t>, reserved)
+};
@@ -17,6 +17,9 @@
 
 #include "token.h"
 
+#include "contract/account.h"
+#include "contract/registry.h"
+
 void Token::init(const Ident& _baseIdent, const Curve& _curveData)
 {
   // Verify that base token contract exists.
@@ -34,17 +37,18 @@ Ident Token::base() const
 
 void Token::mint(const Ident& receiver, const uint256_t& value)
 {
-  balances[receiver] = +balances[receiver] + value;
-  currentSupply = +currentSupply + value;
+  addBalance(receiver, value);
+  currentSupply.add(value);
 }
 
 void Token::transfer(const Ident& src, const Ident& dst, const uint256_t& value)
 {
-  if (+balances[src] < value)
+  const uint256_t srcBalance = getBalance(src);
+  if (srcBalance < value)
     throw Error("Token::transfer: sender has insufficient tokens");
 
-  balances[src] = +balances[src] - value;
-  balances[dst] = +balances[dst] + value;
+  setBalance(src, srcBalance - value);
+  addBalance(dst, value);
 }
 
 uint256_t Token::buy(const Ident& buyer, const uint256_t& value)
@@ -55,13 +59,14 @@ uint256_t Token::buy(const Ident& buyer, const uint256_t& value)
   uint256_t buyTokens =
       curve.apply(+currentSupply + value) - curve.apply(+currentSupply);
 
-  if (+baseToken.balances[buyer] < buyTokens)
+  const uint256_t baseBalance = baseToken.getBalance(buyer);
+  if (baseBalance < buyTokens)
     throw Error("Token::buy: buyer has insufficient base tokens");
 
-  baseToken.balances[buyer] = +baseToken.balances[buyer] - buyTokens;
-  balances[buyer] = +balances[buyer] + value;
+  baseToken.setBalance(buyer, baseBalance - buyTokens);
+  addBalance(buyer, value);
 
-  currentSupply = +currentSupply + value;
+  currentSupply.add(value);
   return buyTokens;
 }
 
@@ -70,19 +75,73 @@ uint256_t Token::sell(const Ident& seller, const uint256_t& value)
   Curve curve = +curveData;
   auto& baseToken = storage.load<Token>(+baseIdent);
 
-  if (+balances[seller] < value)
+  const uint256_t balance = getBalance(seller);
+  if (balance < value)
     throw Error("Token::sell: seller has insufficient tokens");
 
   uint256_t sellTokens =
       curve.apply(+currentSupply) - curve.apply(+currentSupply - value);
 
-  balances[seller] = +balances[seller] - value;
-  baseToken.balances[seller] = +baseToken.balances[seller] + sellTokens;
+  setBalance(seller, balance - value);
+  baseToken.addBalance(seller, sellTokens);
 
   currentSupply = +currentSupply - value;
   return sellTokens;
 }
 
+void Token::addSupply(const uint256_t& value)
+{
+  currentSupply.add(value);
+}
+
+std::string Token::balancesKey(const Ident& token)
+{
+  return KeyPrefix + token.to_string() + "/balances/";
+}
+
+std::string Token::baseKey(const Ident& token)
+{
+  return KeyPrefix + token.to_string() + "/baseIdent";
+}
+
+std::string Token::curveDataKey(const Ident& token)
+{
+  return KeyPrefix + token.to_string() + "/curveData";
+}
+
+std::string Token::currentSupplyKey(const Ident& token)
+{
+  return KeyPrefix + token.to_string() + "/currentSupply";
+}
+
+uint256_t Token::getBalance(const Ident& holder)
+{
+  if (auto number = findNumber(holder, false); number)
+    return balances.get(*number);
+  return 0;
+}
+
+void Token::setBalance(const Ident& holder, const uint256_t& value)
+{
+  balances.set(*findNumber(holder, true), value);
+}
+
+void Token::addBalance(const Ident& holder, const uint256_t& value)
+{
+  balances.add(*findNumber(holder, true), value);
+}
+
+nonstd::optional<uint32_t> Token::findNumber(const Ident& holder, bool reserve)
+{
+  if (auto account = storage.find<Account>(holder); account != nullptr)
+    return account->getNumber();
+
+  auto& registry = storage.load<Registry>(Registry::Key);
+  if (reserve)
+    return registry.reserve(holder);
+  return registry.findReserved(holder);
+}
+
 // void Token::mint(uint256_t value)
 // {
 //   // TODO
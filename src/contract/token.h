@@ -20,7 +20,7 @@
 #include "inc/essential.h"
 #include "store/contract.h"
 #include "store/data.h"
-#include "store/map.h"
+#include "store/paged_array.h"
 #include "util/equation.h"
 #include "util/string.h"
 
@@ -56,12 +56,49 @@ public:
   /// they receive.
   uint256_t sell(const Ident& seller, const uint256_t& value);
 
+  /// Increase the supply of this token by value without crediting anyone. To
+  /// be called after the matching balances are bulk loaded at genesis.
+  void addSupply(const uint256_t& value);
+
+  /// Return the base storage key of the balances of the given token. Must
+  /// match the layout of the balances field below.
+  static std::string balancesKey(const Ident& token);
+
+  /// Return the storage key of the base token ident of the given token. Must
+  /// match the layout of the baseIdent field below.
+  static std::string baseKey(const Ident& token);
+
+  /// Return the storage key of the bonding curve of the given token. Must
+  /// match the layout of the curveData field below.
+  static std::string curveDataKey(const Ident& token);
+
+  /// Return the storage key of the current supply of the given token. Must
+  /// match the layout of the currentSupply field below.
+  static std::string currentSupplyKey(const Ident& token);
+
+private:
+  /// Return the balance of the given holder.
+  uint256_t getBalance(const Ident& holder);
+
+  /// Set the balance of the given holder to the new value.
+  void setBalance(const Ident& holder, const uint256_t& value);
+
+  /// Add value to the balance of the given holder.
+  void addBalance(const Ident& holder, const uint256_t& value);
+
+  /// Return the number under which the balance of the given holder is kept,
+  /// or nullopt if it has none. If reserve is set, a holder without an
+  /// account that has no number yet gets one reserved.
+  nonstd::optional<uint32_t> findNumber(const Ident& holder, bool reserve);
+
 private:
   DATA(Curve, curveData)
   DATA(Ident, baseIdent)
   DATA(uint256_t, currentSupply)
 
-  DATAMAP(Data<uint256_t>, balances)
+  /// Balances indexed by the account numbers assigned by the Registry. Holders
+  /// without an account use the number the Registry reserves for them.
+  PAGED_ARRAY(uint256_t, balances)
 };
 
 // {
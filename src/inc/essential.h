@@ -17,11 +17,12 @@
 
 #pragma once
 
-#include <boost/multiprecision/cpp_int.hpp>
 #include <gsl/gsl>
 #include <spdlog/spdlog.h>
 
-using uint256_t = boost::multiprecision::checked_uint256_t;
+#include "inc/uint256.h"
+
+using uint256_t = UInt256;
 using byte = std::byte;
 
 #include "inc/exception.h"
@@ -0,0 +1,173 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "inc/uint256.h"
+
+#include <algorithm>
+
+#include "inc/essential.h"
+
+namespace
+{
+using uint128_t = unsigned __int128;
+
+/// The largest power of 10 that fits in a limb, used to print 19 decimal
+/// digits per division.
+constexpr uint64_t DecimalChunk = 10'000'000'000'000'000'000ull;
+constexpr int DecimalChunkDigits = 19;
+
+int digitValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return 16;
+}
+} // namespace
+
+UInt256::UInt256(const std::string& str)
+{
+  const bool isHex = str.size() > 2 && str[0] == '0' &&
+                     (str[1] == 'x' || str[1] == 'X');
+  const int base = isHex ? 16 : 10;
+  if (str.empty())
+    throw Failure("UInt256: cannot parse an empty string");
+
+  UInt256 result;
+  for (size_t idx = isHex ? 2 : 0; idx < str.size(); ++idx) {
+    const int digit = digitValue(str[idx]);
+    if (digit >= base)
+      throw Failure("UInt256: invalid character in {}", str);
+    result = result * base + digit;
+  }
+  *this = result;
+}
+
+std::string UInt256::str() const
+{
+  if (words[1] == 0 && words[2] == 0 && words[3] == 0)
+    return std::to_string(words[0]);
+
+  // Peel off 19 decimal digits at a time, least significant chunk first.
+  std::string result;
+  UInt256 rest = *this;
+  while (rest) {
+    UInt256 chunk;
+    divmod(rest, DecimalChunk, rest, chunk);
+    std::string digits = std::to_string(chunk.words[0]);
+    if (rest)
+      digits.insert(0, DecimalChunkDigits - digits.size(), '0');
+    result.insert(0, digits);
+  }
+  return result;
+}
+
+void UInt256::divmod(const UInt256& lhs,
+                     const UInt256& rhs,
+                     UInt256& quotient,
+                     UInt256& remainder)
+{
+  if (!rhs)
+    throw std::overflow_error("UInt256: division by zero");
+
+  if (lhs < rhs) {
+    remainder = lhs;
+    quotient = 0;
+    return;
+  }
+
+  UInt256 result;
+  if (rhs.words[1] == 0 && rhs.words[2] == 0 && rhs.words[3] == 0) {
+    // Single-limb divisor: divide limb by limb with 128-bit arithmetic.
+    const uint64_t divisor = rhs.words[0];
+    uint64_t rest = 0;
+    for (size_t idx = LimbCount; idx-- > 0;) {
+      const uint128_t current = (uint128_t(rest) << 64) | lhs.words[idx];
+      result.words[idx] = uint64_t(current / divisor);
+      rest = uint64_t(current % divisor);
+    }
+    quotient = result;
+    remainder = rest;
+    return;
+  }
+
+  // Multi-limb divisor: long division one limb at a time, as in Knuth's
+  // Algorithm D (TAOCP 4.3.1). Normalize so that the top limb of the divisor
+  // has its high bit set, which keeps each estimated quotient limb at most
+  // two above the true one.
+  const size_t n = (rhs.bitLength() + 63) / 64;
+  const size_t m = (lhs.bitLength() + 63) / 64 - n;
+  const unsigned shift = __builtin_clzll(rhs.words[n - 1]);
+  const Limbs v = shiftLeft(rhs, shift).words;
+  uint64_t u[LimbCount + 1];
+  const Limbs shifted = shiftLeft(lhs, shift).words;
+  std::copy(shifted.begin(), shifted.end(), u);
+  u[LimbCount] = shift == 0 ? 0 : lhs.words[LimbCount - 1] >> (64 - shift);
+
+  for (size_t j = m + 1; j-- > 0;) {
+    // Estimate the quotient limb from the top two limbs of the remainder and
+    // refine it with the next limb of the divisor.
+    const uint128_t top = (uint128_t(u[j + n]) << 64) | u[j + n - 1];
+    uint128_t qhat = top / v[n - 1];
+    uint128_t rhat = top % v[n - 1];
+    while (qhat >> 64 != 0 ||
+           qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+      --qhat;
+      rhat += v[n - 1];
+      if (rhat >> 64 != 0)
+        break;
+    }
+
+    // Subtract qhat times the divisor from the current window.
+    uint64_t carry = 0;
+    uint64_t borrow = 0;
+    for (size_t idx = 0; idx < n; ++idx) {
+      const uint128_t product = qhat * v[idx] + carry;
+      carry = uint64_t(product >> 64);
+      const uint128_t diff = uint128_t(u[idx + j]) - uint64_t(product) - borrow;
+      u[idx + j] = uint64_t(diff);
+      borrow = uint64_t(diff >> 64) != 0;
+    }
+    const uint128_t diff = uint128_t(u[j + n]) - carry - borrow;
+    u[j + n] = uint64_t(diff);
+
+    // The estimate was one too large, which is rare. Add the divisor back.
+    if (uint64_t(diff >> 64) != 0) {
+      --qhat;
+      uint64_t addCarry = 0;
+      for (size_t idx = 0; idx < n; ++idx) {
+        const uint128_t sum = uint128_t(u[idx + j]) + v[idx] + addCarry;
+        u[idx + j] = uint64_t(sum);
+        addCarry = uint64_t(sum >> 64);
+      }
+      u[j + n] += addCarry;
+    }
+    result.words[j] = uint64_t(qhat);
+  }
+
+  // The remainder is left in the low n limbs, still normalized.
+  UInt256 rest;
+  for (size_t idx = 0; idx < n; ++idx) {
+    rest.words[idx] = u[idx] >> shift;
+    if (shift != 0)
+      rest.words[idx] |= u[idx + 1] << (64 - shift);
+  }
+  quotient = result;
+  remainder = rest;
+}
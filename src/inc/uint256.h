@@ -0,0 +1,421 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/// UInt256 is a fixed-width unsigned 256-bit integer stored as four 64-bit
+/// limbs, least significant first. It follows the checked semantics of
+/// boost's checked_uint256_t: any operation whose result does not fit throws
+/// instead of wrapping around, and the value is left unchanged.
+class UInt256
+{
+public:
+  static constexpr size_t LimbCount = 4;
+  static constexpr size_t Bits = 64 * LimbCount;
+
+  using Limbs = std::array<uint64_t, LimbCount>;
+
+  constexpr UInt256() = default;
+
+  /// Create a value from a built-in integer. Throw if the integer is negative.
+  template <typename T,
+            typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  constexpr UInt256(T val)
+  {
+    if constexpr (std::is_signed_v<T>) {
+      if (val < 0)
+        throw std::range_error("UInt256: negative value");
+    }
+    words[0] = uint64_t(val);
+  }
+
+  /// Parse a decimal or 0x-prefixed hexadecimal string. Throw on invalid
+  /// characters or if the value does not fit in 256 bits.
+  explicit UInt256(const std::string& str);
+
+  /// Create a value from its limbs, least significant first.
+  static constexpr UInt256 fromLimbs(const Limbs& limbs)
+  {
+    UInt256 result;
+    result.words = limbs;
+    return result;
+  }
+
+  /// Return the limbs of this value, least significant first.
+  constexpr const Limbs& limbs() const
+  {
+    return words;
+  }
+
+  /// Return the number of significant bits, which is 0 for zero.
+  size_t bitLength() const
+  {
+    for (size_t idx = LimbCount; idx-- > 0;) {
+      if (words[idx] != 0)
+        return 64 * idx + 64 - __builtin_clzll(words[idx]);
+    }
+    return 0;
+  }
+
+  /// Return the decimal representation of this value.
+  std::string str() const;
+
+  explicit operator bool() const
+  {
+    return (words[0] | words[1] | words[2] | words[3]) != 0;
+  }
+
+  /// Convert to a built-in unsigned integer. Throw if the value does not fit.
+  template <typename T,
+            typename std::enable_if_t<
+                std::is_integral_v<T> && !std::is_same_v<T, bool>,
+                int> = 0>
+  explicit operator T() const
+  {
+    if ((words[1] | words[2] | words[3]) != 0 ||
+        words[0] > uint64_t(std::numeric_limits<T>::max()))
+      throw std::overflow_error("UInt256: value does not fit");
+    return T(words[0]);
+  }
+
+  friend bool operator==(const UInt256& lhs, const UInt256& rhs)
+  {
+    return lhs.words == rhs.words;
+  }
+
+  friend bool operator!=(const UInt256& lhs, const UInt256& rhs)
+  {
+    return lhs.words != rhs.words;
+  }
+
+  friend bool operator<(const UInt256& lhs, const UInt256& rhs)
+  {
+    for (size_t idx = LimbCount; idx-- > 0;) {
+      if (lhs.words[idx] != rhs.words[idx])
+        return lhs.words[idx] < rhs.words[idx];
+    }
+    return false;
+  }
+
+  friend bool operator>(const UInt256& lhs, const UInt256& rhs)
+  {
+    return rhs < lhs;
+  }
+
+  friend bool operator<=(const UInt256& lhs, const UInt256& rhs)
+  {
+    return !(rhs < lhs);
+  }
+
+  friend bool operator>=(const UInt256& lhs, const UInt256& rhs)
+  {
+    return !(lhs < rhs);
+  }
+
+  friend UInt256 operator+(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 result;
+    bool carry = false;
+    for (size_t idx = 0; idx < LimbCount; ++idx) {
+      uint64_t sum;
+      const bool overflow =
+          __builtin_add_overflow(lhs.words[idx], rhs.words[idx], &sum);
+      carry = __builtin_add_overflow(sum, uint64_t(carry), &sum) || overflow;
+      result.words[idx] = sum;
+    }
+    if (carry)
+      throw std::overflow_error("UInt256: addition overflow");
+    return result;
+  }
+
+  friend UInt256 operator-(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 result;
+    bool borrow = false;
+    for (size_t idx = 0; idx < LimbCount; ++idx) {
+      uint64_t diff;
+      const bool underflow =
+          __builtin_sub_overflow(lhs.words[idx], rhs.words[idx], &diff);
+      borrow =
+          __builtin_sub_overflow(diff, uint64_t(borrow), &diff) || underflow;
+      result.words[idx] = diff;
+    }
+    if (borrow)
+      throw std::range_error("UInt256: subtraction underflow");
+    return result;
+  }
+
+  friend UInt256 operator*(const UInt256& lhs, const UInt256& rhs)
+  {
+    using uint128_t = unsigned __int128;
+    UInt256 result;
+    for (size_t i = 0; i < LimbCount; ++i) {
+      if (lhs.words[i] == 0)
+        continue;
+      uint64_t carry = 0;
+      for (size_t j = 0; j < LimbCount; ++j) {
+        const uint128_t product =
+            uint128_t(lhs.words[i]) * rhs.words[j] + carry;
+        if (i + j >= LimbCount) {
+          if (product != 0)
+            throw std::overflow_error("UInt256: multiplication overflow");
+          continue;
+        }
+        const uint128_t sum = product + result.words[i + j];
+        result.words[i + j] = uint64_t(sum);
+        carry = uint64_t(sum >> 64);
+      }
+      if (carry != 0)
+        throw std::overflow_error("UInt256: multiplication overflow");
+    }
+    return result;
+  }
+
+  friend UInt256 operator/(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 quotient, remainder;
+    divmod(lhs, rhs, quotient, remainder);
+    return quotient;
+  }
+
+  friend UInt256 operator%(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 quotient, remainder;
+    divmod(lhs, rhs, quotient, remainder);
+    return remainder;
+  }
+
+  friend UInt256 operator&(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 result;
+    for (size_t idx = 0; idx < LimbCount; ++idx)
+      result.words[idx] = lhs.words[idx] & rhs.words[idx];
+    return result;
+  }
+
+  friend UInt256 operator|(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 result;
+    for (size_t idx = 0; idx < LimbCount; ++idx)
+      result.words[idx] = lhs.words[idx] | rhs.words[idx];
+    return result;
+  }
+
+  friend UInt256 operator^(const UInt256& lhs, const UInt256& rhs)
+  {
+    UInt256 result;
+    for (size_t idx = 0; idx < LimbCount; ++idx)
+      result.words[idx] = lhs.words[idx] ^ rhs.words[idx];
+    return result;
+  }
+
+  UInt256 operator~() const
+  {
+    UInt256 result;
+    for (size_t idx = 0; idx < LimbCount; ++idx)
+      result.words[idx] = ~words[idx];
+    return result;
+  }
+
+  /// Shift left. Throw if any set bit is shifted out.
+  friend UInt256 operator<<(const UInt256& lhs, unsigned shift)
+  {
+    if (lhs && lhs.bitLength() + shift > Bits)
+      throw std::overflow_error("UInt256: shift overflow");
+    return shiftLeft(lhs, shift);
+  }
+
+  friend UInt256 operator>>(const UInt256& lhs, unsigned shift)
+  {
+    return shiftRight(lhs, shift);
+  }
+
+  UInt256& operator+=(const UInt256& rhs)
+  {
+    return *this = *this + rhs;
+  }
+
+  UInt256& operator-=(const UInt256& rhs)
+  {
+    return *this = *this - rhs;
+  }
+
+  UInt256& operator*=(const UInt256& rhs)
+  {
+    return *this = *this * rhs;
+  }
+
+  UInt256& operator/=(const UInt256& rhs)
+  {
+    return *this = *this / rhs;
+  }
+
+  UInt256& operator%=(const UInt256& rhs)
+  {
+    return *this = *this % rhs;
+  }
+
+  UInt256& operator&=(const UInt256& rhs)
+  {
+    return *this = *this & rhs;
+  }
+
+  UInt256& operator|=(const UInt256& rhs)
+  {
+    return *this = *this | rhs;
+  }
+
+  UInt256& operator^=(const UInt256& rhs)
+  {
+    return *this = *this ^ rhs;
+  }
+
+  UInt256& operator<<=(unsigned shift)
+  {
+    return *this = *this << shift;
+  }
+
+  UInt256& operator>>=(unsigned shift)
+  {
+    return *this = *this >> shift;
+  }
+
+  UInt256& operator++()
+  {
+    return *this += 1;
+  }
+
+  UInt256& operator--()
+  {
+    return *this -= 1;
+  }
+
+  UInt256 operator++(int)
+  {
+    UInt256 result = *this;
+    ++*this;
+    return result;
+  }
+
+  UInt256 operator--(int)
+  {
+    UInt256 result = *this;
+    --*this;
+    return result;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const UInt256& val)
+  {
+    return os << val.str();
+  }
+
+  /// Compute both the quotient and the remainder of the given division.
+  /// Throw on division by zero.
+  static void divmod(const UInt256& lhs,
+                     const UInt256& rhs,
+                     UInt256& quotient,
+                     UInt256& remainder);
+
+private:
+  /// Shift without overflow checks. Bits shifted out are dropped.
+  static UInt256 shiftLeft(const UInt256& val, unsigned shift);
+  static UInt256 shiftRight(const UInt256& val, unsigned shift);
+
+  Limbs words{};
+};
+
+inline UInt256 UInt256::shiftLeft(const UInt256& val, unsigned shift)
+{
+  UInt256 result;
+  if (shift >= Bits)
+    return result;
+  const size_t limbShift = shift / 64;
+  const unsigned bitShift = shift % 64;
+  for (size_t idx = LimbCount; idx-- > limbShift;) {
+    result.words[idx] = val.words[idx - limbShift] << bitShift;
+    if (bitShift != 0 && idx > limbShift)
+      result.words[idx] |= val.words[idx - limbShift - 1] >> (64 - bitShift);
+  }
+  return result;
+}
+
+inline UInt256 UInt256::shiftRight(const UInt256& val, unsigned shift)
+{
+  UInt256 result;
+  if (shift >= Bits)
+    return result;
+  const size_t limbShift = shift / 64;
+  const unsigned bitShift = shift % 64;
+  for (size_t idx = 0; idx + limbShift < LimbCount; ++idx) {
+    result.words[idx] = val.words[idx + limbShift] >> bitShift;
+    if (bitShift != 0 && idx + limbShift + 1 < LimbCount)
+      result.words[idx] |= val.words[idx + limbShift + 1] << (64 - bitShift);
+  }
+  return result;
+}
+
+namespace std
+{
+template <>
+struct hash<UInt256> {
+  size_t operator()(const UInt256& val) const
+  {
+    size_t seed = 0;
+    for (uint64_t limb : val.limbs())
+      seed ^= hash<uint64_t>()(limb) + 0x9e3779b97f4a7c15ull + (seed << 6) +
+              (seed >> 2);
+    return seed;
+  }
+};
+
+template <>
+class numeric_limits<UInt256>
+{
+public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = false;
+  static constexpr bool is_integer = true;
+  static constexpr bool is_exact = true;
+  static constexpr bool is_bounded = true;
+  static constexpr int radix = 2;
+  static constexpr int digits = UInt256::Bits;
+  static constexpr int digits10 = 77;
+
+  static UInt256 min() noexcept
+  {
+    return 0;
+  }
+
+  static UInt256 lowest() noexcept
+  {
+    return 0;
+  }
+
+  static UInt256 max() noexcept
+  {
+    return ~UInt256();
+  }
+};
+} // namespace std
@@ -31,8 +31,8 @@ void CayleyListener::handleAddWikiEdge(const BlockMsg& blk,
                                        const AddWikiEdgeMsg& msg,
                                        const AddWikiEdgeResponse& res)
 {
-  graph.add_edge(msg.subject.to_string(), msg.predicate.to_string(),
-                 msg.object.to_string(), msg.label.to_string());
+  graph.add_edge(
+      graph.intern(msg.subject, msg.predicate, msg.object, msg.label));
 }
 
 void CayleyListener::handleRemoveWikiEdge(const BlockMsg& blk,
@@ -40,6 +40,9 @@ void CayleyListener::handleRemoveWikiEdge(const BlockMsg& blk,
                                           const RemoveWikiEdgeMsg& msg,
                                           const RemoveWikiEdgeResponse& res)
 {
-  graph.delete_edge(msg.subject.to_string(), msg.predicate.to_string(),
-                    msg.object.to_string(), msg.label.to_string());
+  // An edge with a node that was never interned cannot be in the graph.
+  auto edge = graph.find(msg.subject, msg.predicate, msg.object, msg.label);
+  if (!edge)
+    return;
+  graph.delete_edge(*edge);
 }
@@ -25,11 +25,12 @@
 namespace
 {
 /// Parse the header part of the given raw messages. This helper function is
-/// used both during checkTx and applyTx
+/// used both during checkTx and applyTx. The returned buffer reads the rest of
+/// raw in place.
 std::tuple<HeaderMsg, gsl::span<const byte>, Buffer>
 parseHeader(gsl::span<const byte> raw)
 {
-  Buffer buf(raw);
+  Buffer buf = Buffer::view(raw);
 
   HeaderMsg hdr;
   hdr.hash = sha256(raw);
@@ -42,8 +43,78 @@ parseHeader(gsl::span<const byte> raw)
   auto dataSize = buf.size_bytes();
   buf >> hdr.nonce;
 
-  return {hdr, raw.last(dataSize), buf};
+  return {hdr, raw.last(dataSize), std::move(buf)};
 }
+
+/// Parse the JSON app state given at genesis. An empty state results in the
+/// default genesis account and token. The accounts, which may number in the
+/// millions, are converted one by one as the parser reaches the end of each,
+/// and then dropped, so the document is never held in memory as a whole. The
+/// expected format is
+///
+///   {
+///     "account": "BandGod",
+///     "verifyKey": "<hex>",
+///     "token": "Band",
+///     "accounts": [
+///       {"user": "alice", "verifyKey": "<hex>", "balance": "1000"},
+///       ...
+///     ]
+///   }
+std::pair<GenesisMsg, std::vector<GenesisAccount>>
+parseGenesis(gsl::span<const byte> raw)
+{
+  GenesisMsg genesis;
+  genesis.account = "BandGod"s;
+  genesis.token = "Band"s;
+
+  if (raw.empty())
+    return {genesis, {}};
+
+  // The top-level key whose value is being parsed. Depth 1 holds the values
+  // of the top-level keys and depth 2 the elements of the accounts array.
+  std::vector<GenesisAccount> accounts;
+  std::string topKey;
+  auto onEvent = [&](int depth, json::parse_event_t event, json& parsed) {
+    if (depth == 1 && event == json::parse_event_t::key) {
+      topKey = parsed.get<std::string>();
+    } else if (depth == 2 && event == json::parse_event_t::object_end &&
+               topKey == "accounts") {
+      GenesisAccount account;
+      account.user = parsed.at("user").get<std::string>();
+      account.verifyKey =
+          VerifyKey::hex(parsed.at("verifyKey").get<std::string>());
+      account.balance = uint256_t{parsed.value("balance", "0"s)};
+      accounts.push_back(std::move(account));
+      return false;
+    }
+    return true;
+  };
+  const char* begin = (const char*)raw.data();
+  const json state = json::parse(begin, begin + raw.size_bytes(), onEvent);
+
+  if (auto it = state.find("account"); it != state.end())
+    genesis.account = it->get<std::string>();
+  if (auto it = state.find("verifyKey"); it != state.end())
+    genesis.verifyKey = VerifyKey::hex(it->get<std::string>());
+  if (auto it = state.find("token"); it != state.end())
+    genesis.token = it->get<std::string>();
+
+  return {genesis, std::move(accounts)};
+}
+
+/// Overloads to notify the given listener about one message, so that the
+/// messages of a batch reach the same handlers as standalone ones.
+#define NOTIFY_LISTENER(R, _, MSG)                                             \
+  void notify(BaseListener& listener, const BlockMsg& blk,                     \
+              const HeaderMsg& hdr, const BAND_MACRO_MSG(MSG) & msg,           \
+              const BAND_MACRO_RESPONSE(MSG) & res)                            \
+  {                                                                            \
+    listener.BAND_MACRO_HANDLE(MSG)(blk, hdr, msg, res);                       \
+  }
+
+BAND_MACRO_MESSAGE_FOR_EACH(NOTIFY_LISTENER)
+#undef NOTIFY_LISTENER
 } // namespace
 
 std::string ListenerManager::abi()
@@ -60,6 +131,7 @@ std::string ListenerManager::abi()
   }
 
   BAND_MACRO_MESSAGE_FOR_EACH(ADD_TX_INTERFACE)
+  ADD_TX_INTERFACE(_, _, Batch)
 #undef ADD_TX_INTERFACE
 
   return interface.dump();
@@ -76,13 +148,11 @@ void ListenerManager::loadStates()
 
 void ListenerManager::initChain(gsl::span<const byte> raw)
 {
-  GenesisMsg genesis;
-  // TODO
-  genesis.account = "BandGod"s;
-  genesis.token = "Band"s;
+  auto [genesis, accounts] = parseGenesis(raw);
+  INFO(log, "Initializing the chain with {} genesis accounts", accounts.size());
 
   if (primary)
-    primary->init(genesis);
+    primary->init(genesis, accounts);
 
   for (auto& listener : listeners)
     listener->init(genesis);
@@ -109,6 +179,9 @@ void ListenerManager::checkTransaction(gsl::span<const byte> raw)
   auto [hdr, data, buf] = parseHeader(raw);
   (void)buf;
   primary->validateTransaction(PrimaryMode::Check, hdr, data);
+
+  if (prefetcher)
+    prefetcher->enqueue(raw);
 }
 
 std::string ListenerManager::applyTransaction(gsl::span<const byte> raw,
@@ -128,8 +201,9 @@ std::string ListenerManager::applyTransaction(gsl::span<const byte> raw,
 #define HANDLE_APPLY_CASE(R, _, MSG)                                           \
   case +MsgType::MSG: {                                                        \
     auto msg = buf.read<BAND_MACRO_MSG(MSG)>();                                \
-    auto res = primary ? primary->process(block, hdr, msg)                     \
-                       : Buffer(rawResult).read<BAND_MACRO_RESPONSE(MSG)>();   \
+    auto res = primary                                                         \
+                   ? primary->process(block, hdr, msg)                         \
+                   : Buffer::view(rawResult).read<BAND_MACRO_RESPONSE(MSG)>(); \
     result = Buffer::serialize(res);                                           \
     for (auto& listener : listeners) {                                         \
       listener->BAND_MACRO_HANDLE(MSG)(block, hdr, msg, res);                  \
@@ -139,6 +213,28 @@ std::string ListenerManager::applyTransaction(gsl::span<const byte> raw,
 
     BAND_MACRO_MESSAGE_FOR_EACH(HANDLE_APPLY_CASE)
 #undef HANDLE_APPLY_CASE
+
+    case +MsgType::Batch: {
+      auto msg = buf.read<BatchMsg>();
+      auto res = primary ? primary->process(block, hdr, msg)
+                         : Buffer::view(rawResult).read<BatchResponse>();
+      if (res.responses.size() != msg.msgs.size())
+        throw Failure("applyTransaction: batch response count mismatch");
+      result = Buffer::serialize(res);
+      // Listeners see each message of the batch on its own, in order.
+      for (size_t idx = 0; idx < msg.msgs.size(); ++idx) {
+        msg.msgs[idx].visit([&](const auto& subMsg) {
+          using Msg = std::decay_t<decltype(subMsg)>;
+          using Response = typename ResponseOf<Msg>::type;
+          const auto* subRes = res.responses[idx].template get<Response>();
+          if (!subRes)
+            throw Failure("applyTransaction: batch response type mismatch");
+          for (auto& listener : listeners)
+            notify(*listener, block, hdr, subMsg, *subRes);
+        });
+      }
+      break;
+    }
   }
 
   return result;
@@ -170,6 +266,14 @@ void ListenerManager::setPrimary(std::unique_ptr<PrimaryListener> _primary)
   primary = std::move(_primary);
 }
 
+void ListenerManager::setPrefetcher(std::unique_ptr<Prefetcher> _prefetcher)
+{
+  if (prefetcher)
+    throw Failure("setPrefetcher: set prefetcher while one already exists");
+
+  prefetcher = std::move(_prefetcher);
+}
+
 void ListenerManager::addListener(std::unique_ptr<BaseListener> listener)
 {
   if (dynamic_cast<PrimaryListener*>(listener.get()) != nullptr)
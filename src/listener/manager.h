@@ -21,6 +21,7 @@
 
 #include "inc/essential.h"
 #include "listener/base.h"
+#include "listener/prefetcher.h"
 #include "listener/primary.h"
 #include "util/bytes.h"
 
@@ -59,7 +60,8 @@ public:
   void beginBlock(uint64_t timestamp, const Address& proposer);
 
   /// Notify the primary listener to check the given transaction message. Fail
-  /// if no primary listener is set.
+  /// if no primary listener is set. Valid transactions are handed to the
+  /// prefetcher, if any. Safe to call while a block is being applied.
   void checkTransaction(gsl::span<const byte> raw);
 
   /// Notify the listeners to apply the given transaction message. Optionally
@@ -81,6 +83,10 @@ public:
   /// listener already exists.
   void setPrimary(std::unique_ptr<PrimaryListener> primary);
 
+  /// Set the prefetcher loading the state of checked transactions ahead of
+  /// their execution. Fail if the prefetcher already exists.
+  void setPrefetcher(std::unique_ptr<Prefetcher> prefetcher);
+
   /// Add the given listener to this manager. Fail if the given listener is
   /// a primary listener.
   void addListener(std::unique_ptr<BaseListener> listener);
@@ -94,7 +100,13 @@ private:
   /// advisable to not add any other listeners for maximum performance.
   std::vector<std::unique_ptr<BaseListener>> listeners;
 
+  /// The optional prefetcher fed by checkTransaction.
+  std::unique_ptr<Prefetcher> prefetcher;
+
   /// The information the most recent block. Use this timestamp for all
   /// applying transactions until the block ends.
   BlockMsg block;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("manager");
 };
@@ -0,0 +1,225 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "prefetcher.h"
+
+#include "contract/account.h"
+#include "contract/registry.h"
+#include "contract/token.h"
+#include "store/paged_array.h"
+#include "util/buffer.h"
+
+namespace
+{
+/// Append the keys of the account contract and the fields read by every
+/// transaction of that account.
+void addAccountKeys(std::vector<std::string>& keys, const Ident& account)
+{
+  keys.push_back(Account::KeyPrefix + account.to_string());
+  keys.push_back(Account::nonceKey(account));
+  keys.push_back(Account::numberKey(account));
+}
+
+/// Append the keys read to locate the balances of a holder that may not have
+/// an account yet, in which case the Registry holds its reserved number.
+void addHolderKeys(std::vector<std::string>& keys, const Ident& holder)
+{
+  addAccountKeys(keys, holder);
+  keys.push_back(Registry::KeyPrefix + Registry::Key.to_string());
+  keys.push_back(Registry::reservedKey(holder));
+}
+
+/// Append the keys of the token contract and its fields.
+void addTokenKeys(std::vector<std::string>& keys, const Ident& token)
+{
+  keys.push_back(Token::KeyPrefix + token.to_string());
+  keys.push_back(Token::curveDataKey(token));
+  keys.push_back(Token::baseKey(token));
+  keys.push_back(Token::currentSupplyKey(token));
+}
+} // namespace
+
+Prefetcher::Prefetcher(Storage& _storage)
+    : storage(_storage)
+    , worker([this] { run(); })
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  queued.notify_one();
+  worker.join();
+}
+
+void Prefetcher::enqueue(gsl::span<const byte> raw)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.size() >= MaxPending)
+      return;
+    pending.emplace_back((const char*)raw.data(), raw.size_bytes());
+  }
+  queued.notify_one();
+}
+
+void Prefetcher::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  drained.wait(lock, [this] { return pending.empty() && inFlight == 0; });
+}
+
+void Prefetcher::run()
+{
+  while (true) {
+    std::string raw;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queued.wait(lock, [this] { return stopping || !pending.empty(); });
+      if (stopping)
+        return;
+      raw = std::move(pending.front());
+      pending.pop_front();
+      ++inFlight;
+    }
+
+    try {
+      prefetch(raw);
+    } catch (const std::exception& err) {
+      DEBUG(log, "Failed to prefetch transaction: {}", err.what());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      --inFlight;
+      if (!pending.empty() || inFlight != 0)
+        continue;
+    }
+    drained.notify_all();
+  }
+}
+
+void Prefetcher::prefetch(const std::string& raw)
+{
+  Buffer buf = Buffer::view(gsl::as_bytes(gsl::make_span(raw)));
+  const auto user = buf.read<Ident>();
+  buf.read<Signature>();
+  buf.read<uint64_t>();
+
+  // The contracts read directly by the transaction, and the (token, account)
+  // pairs whose balances it touches. Buying and selling also touch the
+  // balance of the base token, which is only known once the token is loaded.
+  std::vector<std::string> keys;
+  std::vector<std::pair<Ident, Ident>> balances;
+  std::vector<Ident> tradedTokens;
+
+  addAccountKeys(keys, user);
+  auto collect = [&](const auto& msg) {
+    using T = std::decay_t<decltype(msg)>;
+    if constexpr (std::is_same_v<T, CreateAccountMsg>) {
+      keys.push_back(Account::KeyPrefix + msg.user.to_string());
+      keys.push_back(Registry::KeyPrefix + Registry::Key.to_string());
+      keys.push_back(Registry::accountCountKey());
+      keys.push_back(Registry::reservedKey(msg.user));
+    } else if constexpr (std::is_same_v<T, CreateTokenMsg>) {
+      keys.push_back(Token::KeyPrefix + msg.createdToken.to_string());
+      keys.push_back(Token::KeyPrefix + msg.baseToken.to_string());
+    } else if constexpr (std::is_same_v<T, MintTokenMsg>) {
+      addTokenKeys(keys, msg.token);
+      balances.emplace_back(msg.token, user);
+    } else if constexpr (std::is_same_v<T, TransferTokenMsg>) {
+      addTokenKeys(keys, msg.token);
+      addHolderKeys(keys, msg.dest);
+      balances.emplace_back(msg.token, user);
+      balances.emplace_back(msg.token, msg.dest);
+    } else if constexpr (std::is_same_v<T, BuyTokenMsg> ||
+                         std::is_same_v<T, SellTokenMsg>) {
+      addTokenKeys(keys, msg.token);
+      balances.emplace_back(msg.token, user);
+      tradedTokens.push_back(msg.token);
+    }
+  };
+
+  // A batch is read as a whole, a standalone message as the only entry.
+  const auto msgType = buf.read<MsgType>();
+  if (msgType == +MsgType::Batch) {
+    for (const auto& entry : buf.read<BatchMsg>().msgs)
+      entry.visit(collect);
+  } else {
+    BatchEntryMsg entry;
+    entry.read(buf, msgType);
+    entry.visit(collect);
+  }
+  storage.prefetch(keys);
+
+  // The balance pages are located by the account numbers, which the first
+  // round has just brought into the read cache.
+  keys.clear();
+  for (const auto& token : tradedTokens) {
+    if (auto base = baseToken(token); base) {
+      addTokenKeys(keys, *base);
+      balances.emplace_back(*base, user);
+    }
+  }
+  for (const auto& [token, account] : balances) {
+    if (auto number = accountNumber(account); number) {
+      const uint32_t pageIdx = *number / PagedArray<uint256_t>::ElementsPerPage;
+      keys.push_back(PagedArray<uint256_t>::pageKey(Token::balancesKey(token),
+                                                    pageIdx));
+    }
+  }
+  storage.prefetch(keys);
+}
+
+nonstd::optional<uint32_t> Prefetcher::accountNumber(const Ident& account)
+{
+  if (auto it = numbers.find(account); it != numbers.end())
+    return it->second;
+
+  // A holder without an account keeps its balances under the number the
+  // Registry reserved for it, which its account takes once created.
+  auto raw = storage.peek(Account::numberKey(account));
+  if (!raw)
+    raw = storage.peek(Registry::reservedKey(account));
+  if (!raw)
+    return nonstd::nullopt;
+
+  if (numbers.size() >= MaxRemembered)
+    numbers.clear();
+  const uint32_t number = Buffer::deserialize<uint32_t>(*raw);
+  numbers.emplace(account, number);
+  return number;
+}
+
+nonstd::optional<Ident> Prefetcher::baseToken(const Ident& token)
+{
+  if (auto it = bases.find(token); it != bases.end())
+    return it->second;
+
+  auto raw = storage.peek(Token::baseKey(token));
+  if (!raw)
+    return nonstd::nullopt;
+
+  if (bases.size() >= MaxRemembered)
+    bases.clear();
+  const Ident base = Buffer::deserialize<Ident>(*raw);
+  bases.emplace(token, base);
+  return base;
+}
@@ -0,0 +1,113 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/storage.h"
+#include "util/bytes.h"
+#include "util/msg.h"
+
+/// Prefetcher loads the state that upcoming transactions will touch into the
+/// read cache of the storage. Transactions that pass CheckTx are queued here
+/// and decoded on a background thread, so by the time the same transactions
+/// are delivered, their accounts, token contracts and balances are already in
+/// memory. Prefetching is only a hint: transactions are dropped if the queue
+/// is full, and keys that cannot be resolved yet are simply skipped.
+class Prefetcher
+{
+public:
+  /// Start the background thread prefetching into the given storage, whose
+  /// prefetch and peek must be safe to call concurrently with its other uses.
+  Prefetcher(Storage& storage);
+
+  /// Stop the background thread. Pending transactions are discarded.
+  ~Prefetcher();
+
+  Prefetcher(const Prefetcher& prefetcher) = delete;
+  Prefetcher& operator=(const Prefetcher& prefetcher) = delete;
+
+  /// Queue the given raw transaction to be prefetched.
+  void enqueue(gsl::span<const byte> raw);
+
+  /// Block until every queued transaction has been prefetched.
+  void wait();
+
+private:
+  /// The body of the background thread.
+  void run();
+
+  /// Load the storage keys the given raw transaction will touch.
+  void prefetch(const std::string& raw);
+
+  /// Return the number of the given account, or the one reserved for it if it
+  /// has no account yet, if it is known from either the previous lookups or
+  /// the read cache of the storage.
+  nonstd::optional<uint32_t> accountNumber(const Ident& account);
+
+  /// Return the base token of the given token if it is known.
+  nonstd::optional<Ident> baseToken(const Ident& token);
+
+public:
+  /// The maximum number of transactions waiting to be prefetched.
+  static constexpr size_t MaxPending = 1 << 12;
+
+  /// The maximum number of account numbers and base tokens remembered. Both
+  /// never change once assigned.
+  static constexpr size_t MaxRemembered = 1 << 16;
+
+private:
+  /// Reference to the storage to prefetch into.
+  Storage& storage;
+
+  /// The raw transactions waiting to be prefetched.
+  std::deque<std::string> pending;
+
+  /// The number of transactions dequeued but not prefetched yet.
+  size_t inFlight = 0;
+
+  /// True once the background thread is asked to stop.
+  bool stopping = false;
+
+  /// Protect pending, inFlight and stopping.
+  std::mutex mutex;
+
+  /// Notified whenever a transaction is queued or the thread should stop.
+  std::condition_variable queued;
+
+  /// Notified whenever the queue becomes empty.
+  std::condition_variable drained;
+
+  /// Account numbers and base tokens learned so far. Only accessed by the
+  /// background thread.
+  std::unordered_map<Ident, uint32_t> numbers;
+  std::unordered_map<Ident, Ident> bases;
+
+  /// The background thread. Must be declared last so that it starts after
+  /// every other member is initialized.
+  std::thread worker;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("prefetcher");
+};
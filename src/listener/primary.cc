@@ -17,28 +17,149 @@
 
 #include "primary.h"
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
 #include "contract/account.h"
+#include "contract/registry.h"
 #include "contract/token.h"
+#include "store/paged_array.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
 #include "util/equation.h"
+#include "util/parallel.h"
+
+namespace
+{
+/// Return the state flushed into the given scratch storage as a run of
+/// entries sorted by key.
+std::vector<std::pair<std::string, std::string>> sortedRun(StorageMap& scratch)
+{
+  std::vector<std::pair<std::string, std::string>> run(
+      std::make_move_iterator(scratch.applyCache.begin()),
+      std::make_move_iterator(scratch.applyCache.end()));
+  std::sort(run.begin(), run.end());
+  return run;
+}
+} // namespace
 
 PrimaryListener::PrimaryListener(Storage& _storage)
     : storage(_storage)
+    , checkView(_storage)
 {
 }
 
 void PrimaryListener::load()
 {
-  // TODO
+  storage.warmup();
 }
 
-void PrimaryListener::init(const GenesisMsg& genesis)
+void PrimaryListener::init(const GenesisMsg& genesis,
+                           const std::vector<GenesisAccount>& accounts)
 {
+  // The genesis account takes number 0 and the genesis accounts the numbers
+  // following it.
+  if (accounts.size() >= std::numeric_limits<uint32_t>::max())
+    throw Error("PrimaryListener::init: too many genesis accounts");
+  const uint32_t firstNumber = 1;
+
+  // The whole state is built and checked before anything is written, so that
+  // a bad genesis leaves the storage untouched. The raw state of each chunk of
+  // accounts is built in a scratch storage, so that the key layout stays the
+  // one of the contracts. Each chunk comes back as a sorted run together with
+  // the total balance it holds.
+  auto runs = parallelChunks(accounts.size(), [&](size_t begin, size_t end) {
+    StorageMap scratch;
+    scratch.switchToApply();
+
+    uint256_t supply = 0;
+    for (size_t idx = begin; idx < end; ++idx) {
+      const auto& account = accounts[idx];
+      if (account.user.to_string() == genesis.account.to_string())
+        throw Error("PrimaryListener::init: genesis account {} is duplicated",
+                    account.user);
+
+      scratch.create<Account>(account.user, account.verifyKey,
+                              firstNumber + idx);
+      supply += account.balance;
+    }
+    scratch.flush();
+    return std::make_pair(sortedRun(scratch), supply);
+  });
+
+  // Lay the balances out as the pages of the genesis token's balances array.
+  // The genesis account holds nothing, so only the pages of the range exist.
+  using Balances = PagedArray<uint256_t>;
+  const uint32_t perPage = Balances::ElementsPerPage;
+  const std::string balancesKey = Token::balancesKey(genesis.token);
+  const uint32_t firstPage = firstNumber / perPage;
+  const uint32_t endPage = (firstNumber + accounts.size() - 1) / perPage + 1;
+  auto buildPages = [&](size_t begin, size_t end) {
+    std::vector<std::pair<std::string, std::string>> run;
+    for (uint32_t pageIdx = firstPage + begin; pageIdx < firstPage + end;
+         ++pageIdx) {
+      std::vector<uint256_t> values(perPage, 0);
+      bool isEmpty = true;
+      for (uint32_t offset = 0; offset < perPage; ++offset) {
+        const uint64_t number = uint64_t(pageIdx) * perPage + offset;
+        if (number >= firstNumber && number - firstNumber < accounts.size()) {
+          values[offset] = accounts[number - firstNumber].balance;
+          isEmpty = isEmpty && values[offset] == 0;
+        }
+      }
+      if (!isEmpty)
+        run.emplace_back(Balances::pageKey(balancesKey, pageIdx),
+                         Balances::encodePage(values));
+    }
+    std::sort(run.begin(), run.end());
+    return std::make_pair(std::move(run), uint256_t(0));
+  };
+  auto pageRuns = parallelChunks(endPage - firstPage, buildPages);
+  runs.insert(runs.end(), std::make_move_iterator(pageRuns.begin()),
+              std::make_move_iterator(pageRuns.end()));
+
+  uint256_t supply = 0;
+  for (const auto& [run, runSupply] : runs)
+    supply += runSupply;
+
+  // The registry, the genesis account and the genesis token, which is native
+  // to Band and is used to reward people. The genesis account can use it to
+  // create more accounts later.
+  {
+    StorageMap scratch;
+    scratch.switchToApply();
+    auto& registry = scratch.create<Registry>(Registry::Key);
+    scratch.create<Account>(genesis.account, genesis.verifyKey,
+                            registry.assign());
+    registry.assignRange(accounts.size());
+    scratch.create<Token>(genesis.token, genesis.token, Curve::linear())
+        .addSupply(supply);
+    scratch.flush();
+    runs.emplace_back(sortedRun(scratch), uint256_t(0));
+  }
+
+  // Merge the sorted runs into one sorted batch.
+  std::vector<std::pair<std::string, std::string>> entries;
+  for (auto& [run, runSupply] : runs) {
+    auto middle = entries.size();
+    entries.insert(entries.end(), std::make_move_iterator(run.begin()),
+                   std::make_move_iterator(run.end()));
+    std::inplace_merge(entries.begin(), entries.begin() + middle,
+                       entries.end());
+  }
+
+  auto duplicate = std::adjacent_find(
+      entries.begin(), entries.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; });
+  if (duplicate != entries.end())
+    throw Error("PrimaryListener::init: genesis key {} is duplicated",
+                duplicate->first);
+
+  // Only now is the state written, in one batch committed as a whole.
   storage.switchToApply();
-  // Genesis account. This account can use it to create more accounts laer.
-  storage.create<Account>(genesis.account, genesis.verifyKey);
-  // Genesis token. This token is native to Band and is used to reward people.
-  storage.create<Token>(genesis.token, genesis.token, Curve::linear());
-  storage.flush();
+  storage.bulkLoad(std::move(entries));
+  storage.commit();
 }
 
 void PrimaryListener::begin(const BlockMsg& blk)
@@ -48,7 +169,12 @@ void PrimaryListener::begin(const BlockMsg& blk)
 
 void PrimaryListener::commit(const BlockMsg& blk)
 {
+  // The mempool checks its transactions again after each commit, so the
+  // nonces they set in the view are dropped along with the old state.
+  std::lock_guard<std::mutex> lock(checkMutex);
   storage.flush();
+  storage.commit();
+  checkView.clear();
 }
 
 void PrimaryListener::validateTransaction(PrimaryMode mode,
@@ -56,24 +182,38 @@ void PrimaryListener::validateTransaction(PrimaryMode mode,
                                           gsl::span<const byte> data)
 {
   switch (mode) {
-    case +PrimaryMode::Check:
-      storage.switchToCheck();
+    case +PrimaryMode::Check: {
+      // The nonce is kept in the view, so that the same transaction cannot be
+      // admitted twice before it is committed. A failed check leaves nothing.
+      std::lock_guard<std::mutex> lock(checkMutex);
+      BOOST_SCOPE_EXIT(&checkView)
+      {
+        checkView.reset();
+      }
+      BOOST_SCOPE_EXIT_END
+
+      auto& account = checkView.load<Account>(hdr.user);
+      // account.verifySignature(data, hdr.sig);
+      account.setNonce(hdr.nonce);
+      checkView.flush();
       break;
-    case +PrimaryMode::Apply:
+    }
+    case +PrimaryMode::Apply: {
       storage.switchToApply();
+      auto& account = storage.load<Account>(hdr.user);
+      // account.verifySignature(data, hdr.sig);
+      account.setNonce(hdr.nonce);
       break;
+    }
   }
-
-  auto& account = storage.load<Account>(hdr.user);
-  // account.verifySignature(data, hdr.sig);
-  account.setNonce(hdr.nonce);
 }
 
 CreateAccountResponse PrimaryListener::handle(const BlockMsg& blk,
                                               const HeaderMsg& hdr,
                                               const CreateAccountMsg& msg)
 {
-  storage.create<Account>(msg.user, msg.vk);
+  auto& registry = storage.load<Registry>(Registry::Key);
+  storage.create<Account>(msg.user, msg.vk, registry.claim(msg.user));
   return {};
 }
 
@@ -142,3 +282,21 @@ RemoveWikiEdgeResponse PrimaryListener::handle(const BlockMsg& blk,
   // TODO
   return {};
 }
+
+BatchResponse PrimaryListener::handle(const BlockMsg& blk,
+                                      const HeaderMsg& hdr,
+                                      const BatchMsg& msg)
+{
+  if (msg.msgs.empty() || msg.msgs.size() > MaxBatchSize)
+    throw Error("PrimaryListener::handle: invalid batch size {}",
+                msg.msgs.size());
+
+  BatchResponse res;
+  res.responses.reserve(msg.msgs.size());
+  for (const auto& entry : msg.msgs) {
+    res.responses.push_back(entry.visit([&](const auto& subMsg) {
+      return BatchEntryResponse(handle(blk, hdr, subMsg));
+    }));
+  }
+  return res;
+}
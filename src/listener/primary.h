@@ -19,9 +19,12 @@
 
 #include <boost/scope_exit.hpp>
 #include <enum/enum.h>
+#include <mutex>
+#include <vector>
 
 #include "inc/essential.h"
 #include "store/storage.h"
+#include "store/storage_view.h"
 #include "util/msg.h"
 
 /// The mode in which this primary listener is running. Switching back and
@@ -38,7 +41,8 @@ public:
 
   /// Validate the given set of transaction information. Mutate the user's
   /// nonce appropriately. Mode must be specified before this is called.
-  /// Throw exception if the validation fails.
+  /// Throw exception if the validation fails. Check mode validates against
+  /// the check view and may run while a block is being executed.
   void validateTransaction(PrimaryMode mode,
                            const HeaderMsg& hdr,
                            gsl::span<const byte> data);
@@ -47,14 +51,18 @@ public:
   /// database calls.
   void load();
 
-  /// Initialize blockchain state according to the given genesis struct.
-  void init(const GenesisMsg& genesis);
+  /// Initialize blockchain state according to the given genesis struct. The
+  /// genesis accounts are built in parallel and the whole state is checked
+  /// before it is bulk loaded into the storage in one batch, so a bad genesis
+  /// leaves the storage untouched.
+  void init(const GenesisMsg& genesis,
+            const std::vector<GenesisAccount>& accounts = {});
 
   /// Begin a new block. The listener may override this function to perform
   /// necessary transactional operations.
   void begin(const BlockMsg& blk);
 
-  /// Commit the current block.
+  /// Commit the current block and start the check view over from it.
   void commit(const BlockMsg& blk);
 
   /// Set up storage environment and call into primary logic to handle the
@@ -87,7 +95,22 @@ private:
 
 #undef BASE_PROCESS_MESSAGE
 
+  /// Handle each message of the batch in order. Since process flushes only
+  /// once the whole batch succeeds, a failing message reverts all of them.
+  BatchResponse handle(const BlockMsg& blk,
+                       const HeaderMsg& hdr,
+                       const BatchMsg& msg);
+
 private:
   /// Reference to the key-value storage manager.
   Storage& storage;
+
+  /// The state transactions are checked against: the committed state of the
+  /// storage plus the nonces of the transactions checked since. Its contracts
+  /// are separate from the ones of the executing block.
+  StorageView checkView;
+
+  /// Serialize the checks with each other and with the commit, which clears
+  /// the check view.
+  std::mutex checkMutex;
 };
@@ -27,6 +27,8 @@
 
 CmdArg<bool> use_db("use-db", "set this flag to use rocksdb");
 CmdArg<int> port("p,port", "the port on which tmapp connects", "26658");
+CmdArg<int> threads("threads", "the number of threads serving connections",
+                    "4");
 CmdArg<bool> use_set("s,use-set", "set this flag to use graph set");
 
 int main(int argc, char* argv[])
@@ -53,8 +55,6 @@ int main(int argc, char* argv[])
   BandApplication app(ctx);
 
   Server server(service, app, +port);
-  server.start();
-
-  service.run();
+  server.run(std::max(1, +threads));
   return 0;
 }
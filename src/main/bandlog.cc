@@ -21,7 +21,10 @@
 #include "net/server.h"
 #include "net/tmapp.h"
 #include "store/storage.h"
+#include "store/storage_btree.h"
+#include "store/storage_cache.h"
 #include "store/storage_map.h"
+#include "store/storage_trace.h"
 #include "util/cli.h"
 
 class BandLoggingApplication : public TendermintApplication
@@ -89,23 +92,49 @@ private:
 };
 
 CmdArg<int> port("p,port", "the port on which tmapp connects", "26658");
+CmdArg<int> threads("threads", "the number of threads serving connections",
+                    "4");
+CmdArg<bool> pipelined("pipelined-commit",
+                       "persist each block while the next one executes");
+CmdArg<std::string> profile("access-profile",
+                            "file to keep hot storage keys across restarts");
+CmdArg<bool> prefetch("prefetch",
+                      "load the state of checked transactions ahead of time");
+CmdArg<std::string> btreePath("btree-path",
+                              "file to persist the state to, in memory if not "
+                              "given");
+CmdArg<std::string> trace("storage-trace",
+                          "file to record all storage operations to");
 
 int main(int argc, char* argv[])
 {
   Cmd cmd("Band ACBI application", argc, argv);
   boost::asio::io_service service;
 
-  ListenerManager manager;
-  StorageMap storage;
+  std::unique_ptr<Storage> backend;
+  if (btreePath.given())
+    backend = std::make_unique<StorageBTree>(+btreePath);
+  else
+    backend = std::make_unique<StorageMap>();
+  StorageCache cache(*backend, +pipelined, profile.given() ? +profile : "");
+
+  // Optionally record the storage workload for offline replay.
+  std::unique_ptr<StorageTrace> tracer;
+  if (trace.given())
+    tracer = std::make_unique<StorageTrace>(cache, +trace);
+  Storage& storage = tracer ? static_cast<Storage&>(*tracer) : cache;
 
+  // Declared after the storage, so that the prefetcher stops before it goes.
+  ListenerManager manager;
   manager.setPrimary(std::make_unique<PrimaryListener>(storage));
   manager.addListener(std::make_unique<LoggingListener>());
+  if (+prefetch)
+    manager.setPrefetcher(std::make_unique<Prefetcher>(storage));
+  manager.loadStates();
 
   BandLoggingApplication app(manager);
 
   Server server(service, app, +port);
-  server.start();
-
-  service.run();
+  server.run(std::max(1, +threads));
   return 0;
 }
@@ -0,0 +1,172 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <unordered_set>
+
+#include "inc/essential.h"
+#include "store/storage_btree.h"
+#include "store/storage_cache.h"
+#include "store/storage_map.h"
+#include "store/storage_trace.h"
+#include "util/buffer.h"
+#include "util/cli.h"
+
+CmdArg<std::string> tracePath("trace", "storage trace file to replay");
+CmdArg<std::string> backendName("backend",
+                                "map, cache, pipelined-cache or btree", "map");
+CmdArg<std::string> btreePath("btree-path",
+                              "file of the btree backend, replaced on start",
+                              "bandstoragebench.btree");
+
+namespace
+{
+std::unique_ptr<Storage> makeBackend(const std::string& name,
+                                     StorageMap& underlying)
+{
+  if (name == "map")
+    return std::make_unique<StorageMap>();
+  if (name == "cache")
+    return std::make_unique<StorageCache>(underlying, false);
+  if (name == "pipelined-cache")
+    return std::make_unique<StorageCache>(underlying, true);
+  if (name == "btree") {
+    std::remove((+btreePath).c_str());
+    return std::make_unique<StorageBTree>(+btreePath);
+  }
+
+  throw Error("Unknown storage backend {}", name);
+}
+
+/// Return the keys the given trace adds to. Their values must be replayed as
+/// counters for the adds to apply.
+std::unordered_set<std::string> counterKeys(const std::string& path)
+{
+  std::unordered_set<std::string> keys;
+  TraceReader reader(path);
+  while (auto record = reader.next()) {
+    if (record->op == +TraceOp::Add)
+      keys.insert(record->key);
+  }
+  return keys;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double ratio)
+{
+  return sorted[std::min<size_t>(sorted.size() - 1, sorted.size() * ratio)];
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Cmd cmd("Replay a storage trace and report per-operation latency. Written "
+          "values are replayed as placeholders of the recorded sizes, except "
+          "that counters are written as zero and then get the recorded deltas",
+          argc, argv);
+
+  StorageMap underlying;
+  auto storage = makeBackend(+backendName, underlying);
+  storage->switchToApply();
+
+  // Latency of every replayed operation in nanoseconds, per operation type.
+  std::vector<std::vector<uint64_t>> latencies(TraceOp::_size());
+
+  const auto counters = counterKeys(+tracePath);
+  const std::string zero = Buffer::serialize<uint256_t>(0);
+  auto placeholder = [&](const TraceRecord& record) {
+    if (counters.count(record.key))
+      return zero;
+    return std::string(record.valueSize, 'x');
+  };
+
+  TraceReader reader(+tracePath);
+  const auto start = std::chrono::steady_clock::now();
+  while (auto record = reader.next()) {
+    const std::string value = placeholder(*record);
+    // The entries of a bulk load follow it as put records.
+    std::vector<std::pair<std::string, std::string>> entries;
+    if (record->op == +TraceOp::BulkLoad) {
+      for (uint64_t idx = 0; idx < record->valueSize; ++idx) {
+        auto entry = reader.next();
+        if (!entry || entry->op != +TraceOp::Put)
+          throw Failure("Truncated bulk load in {}", +tracePath);
+        entries.emplace_back(entry->key, placeholder(*entry));
+      }
+    }
+    const auto opStart = std::chrono::steady_clock::now();
+    switch (record->op) {
+      case +TraceOp::Get:
+        storage->get(record->key);
+        break;
+      case +TraceOp::Put:
+        storage->put(record->key, value);
+        break;
+      case +TraceOp::Del:
+        storage->del(record->key);
+        break;
+      case +TraceOp::Add:
+        storage->add(record->key, record->delta);
+        break;
+      case +TraceOp::Commit:
+        storage->commit();
+        break;
+      case +TraceOp::SwitchToCheck:
+        storage->switchToCheck();
+        break;
+      case +TraceOp::SwitchToApply:
+        storage->switchToApply();
+        break;
+      case +TraceOp::BulkLoad:
+        storage->bulkLoad(std::move(entries));
+        break;
+    }
+    const auto opEnd = std::chrono::steady_clock::now();
+    latencies[record->op._to_integral()].push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(opEnd - opStart)
+            .count());
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  size_t total = 0;
+  for (auto& opLatencies : latencies)
+    total += opLatencies.size();
+
+  std::cout << "backend " << +backendName << ": " << total << " ops in "
+            << elapsed.count() << " s (" << total / elapsed.count()
+            << " ops/s)" << std::endl;
+  std::cout << "op              count      p50 ns      p90 ns      p99 ns"
+               "      max ns"
+            << std::endl;
+  for (auto op : TraceOp::_values()) {
+    auto& opLatencies = latencies[op._to_integral()];
+    if (opLatencies.empty())
+      continue;
+
+    std::sort(opLatencies.begin(), opLatencies.end());
+    std::cout << "{:<14}{:>7}{:>12}{:>12}{:>12}{:>12}"_format(
+                     op._to_string(), opLatencies.size(),
+                     percentile(opLatencies, 0.5),
+                     percentile(opLatencies, 0.9),
+                     percentile(opLatencies, 0.99), opLatencies.back())
+              << std::endl;
+  }
+  return 0;
+}
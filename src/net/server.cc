@@ -26,7 +26,6 @@ Server::Server(boost::asio::io_service& _service, NetApplication& _app,
     : app(_app)
     , service(_service)
     , acceptor(service, tcp::endpoint(tcp::v4(), port))
-    , socket(service)
 {
 }
 
@@ -35,14 +34,29 @@ void Server::start()
   accept_connection();
 }
 
+void Server::run(size_t threads)
+{
+  start();
+
+  std::vector<std::thread> workers;
+  for (size_t idx = 1; idx < threads; ++idx)
+    workers.emplace_back([this] { service.run(); });
+  service.run();
+
+  for (auto& worker : workers)
+    worker.join();
+}
+
 void Server::accept_connection()
 {
-  acceptor.async_accept(socket, [this](const auto error_code) {
-    if (!error_code) {
-      std::make_shared<Session>(std::move(socket), app)->serve();
-      accept_connection();
-    } else {
-      throw Failure("Failed to accept socket connection");
-    }
-  });
+  acceptor.async_accept(
+      boost::asio::make_strand(service),
+      [this](const auto error_code, tcp::socket socket) {
+        if (!error_code) {
+          std::make_shared<Session>(std::move(socket), app)->serve();
+          accept_connection();
+        } else {
+          throw Failure("Failed to accept socket connection");
+        }
+      });
 }
@@ -18,6 +18,8 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <thread>
+#include <vector>
 
 #include "inc/essential.h"
 #include "net/netapp.h"
@@ -27,12 +29,19 @@ class Server
 public:
   Server(boost::asio::io_service& service, NetApplication& app, uint16_t port);
 
-  /// Run the server and block forever.
+  /// Start accepting connections. The caller is responsible for running the
+  /// service.
   void start();
 
+  /// Start accepting connections and run the service on the given number of
+  /// threads, including the calling one. Block until the service stops.
+  void run(size_t threads);
+
 private:
   /// Add an asynchronous call to accept a new connection. Once a connection is
-  /// accepted, another accept_connection will be invoked automatically.
+  /// accepted, another accept_connection will be invoked automatically. Each
+  /// connection is bound to its own strand, so the handlers of one session
+  /// never run concurrently while different sessions run in parallel.
   void accept_connection();
 
 private:
@@ -40,5 +49,4 @@ private:
 
   boost::asio::io_service& service;
   boost::asio::ip::tcp::acceptor acceptor;
-  boost::asio::ip::tcp::socket socket;
 };
@@ -30,24 +30,32 @@ void Session::serve()
 
 void Session::process_read(size_t length)
 {
-  read_buffer << gsl::span(socket_buffer, length);
+  read_buffer.commit(length);
+  if (length == read_size)
+    read_size = std::min(2 * read_size, MaxReadSize);
+
+  Buffer write_buffer;
   while (app.process(read_buffer, write_buffer)) {
     // Keep processing incoming messages until everything is done.
   }
-  async_write();
+  if (!write_buffer.empty()) {
+    pending_buffers.push_back(std::move(write_buffer));
+    async_write();
+  }
+  async_read();
 }
 
-void Session::process_write(size_t length)
+void Session::process_write()
 {
-  write_buffer.consume(length);
-  async_read();
+  writing_buffers.clear();
+  async_write();
 }
 
 void Session::async_read()
 {
-  boost::asio::async_read(
-      socket, boost::asio::buffer(socket_buffer, sizeof(socket_buffer)),
-      boost::asio::transfer_at_least(1),
+  auto read_span = read_buffer.prepare(read_size);
+  socket.async_read_some(
+      boost::asio::buffer(read_span.data(), read_span.size_bytes()),
       [self = shared_from_this()](const auto ec, size_t length) {
         if (!ec) {
           self->process_read(length);
@@ -59,16 +67,21 @@ void Session::async_read()
 
 void Session::async_write()
 {
-  if (write_buffer.empty()) {
-    return async_read();
+  if (!writing_buffers.empty() || pending_buffers.empty())
+    return;
+
+  writing_buffers.swap(pending_buffers);
+  std::vector<boost::asio::const_buffer> sequence;
+  sequence.reserve(writing_buffers.size());
+  for (const auto& buffer : writing_buffers) {
+    auto write_span = buffer.as_const_span();
+    sequence.emplace_back(write_span.data(), write_span.size_bytes());
   }
 
-  auto write_span = write_buffer.as_span();
   boost::asio::async_write(
-      socket, boost::asio::buffer(write_span.data(), write_span.size_bytes()),
-      [self = shared_from_this()](const auto ec, size_t length) {
+      socket, sequence, [self = shared_from_this()](const auto ec, size_t) {
         if (!ec) {
-          self->process_write(length);
+          self->process_write();
         } else {
           WARN(log, "Failed to write to socket. Client disconnected");
         }
@@ -18,11 +18,19 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <vector>
 
 #include "inc/essential.h"
 #include "net/netapp.h"
 #include "util/buffer.h"
 
+/// Session serves one client connection. Incoming bytes are read by asio
+/// straight into the tail of the read buffer, which keeps the unprocessed
+/// prefix of a partial message and grows to hold large ones. Reading goes on
+/// while responses are written. Responses produced during a write are queued
+/// and sent together with a single gather write once it completes. The socket
+/// is bound to a strand by the server, so the read and write handlers of one
+/// session never run concurrently.
 class Session : public std::enable_shared_from_this<Session>
 {
 public:
@@ -32,7 +40,7 @@ public:
 
 private:
   void process_read(size_t length);
-  void process_write(size_t length);
+  void process_write();
 
   void async_read();
   void async_write();
@@ -42,9 +50,19 @@ private:
   boost::asio::ip::tcp::socket socket;
 
   Buffer read_buffer;
-  Buffer write_buffer;
 
-  std::byte socket_buffer[1024];
+  /// The number of bytes to ask for in the next read. Doubles while reads
+  /// fill the whole space, up to MaxReadSize.
+  size_t read_size = MinReadSize;
+
+  /// Responses waiting to be written, one buffer per processed read.
+  std::vector<Buffer> pending_buffers;
+
+  /// Responses currently being written. Empty if no write is in flight.
+  std::vector<Buffer> writing_buffers;
+
+  static constexpr size_t MinReadSize = 4096;
+  static constexpr size_t MaxReadSize = 1 << 20;
 
   static inline auto log = logger::get("session");
 };
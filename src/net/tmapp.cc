@@ -55,8 +55,8 @@ void TendermintApplication::do_info(const RequestInfo& req, ResponseInfo& res)
   }
   res.set_data(get_name());
   res.set_version(get_version());
-  if (last_block_height != 0) {
-    res.set_last_block_height(last_block_height);
+  if (const uint64_t height = committed_block_height; height != 0) {
+    res.set_last_block_height(height);
     res.set_last_block_app_hash(get_current_app_hash());
   }
 }
@@ -74,7 +74,7 @@ void TendermintApplication::do_init_chain(const RequestInitChain& req)
 void TendermintApplication::do_query(const RequestQuery& req,
                                      ResponseQuery& res)
 {
-  res.set_height(last_block_height);
+  res.set_height(committed_block_height);
   try {
     res.set_value(query(req.path(), req.data()));
     res.set_code(0);
@@ -161,6 +161,7 @@ void TendermintApplication::do_commit(ResponseCommit& res)
 {
   // TODO: Notify the application to flush the blockchain state
   commit_block();
+  committed_block_height = last_block_height;
   res.set_data(get_current_app_hash());
 }
 
@@ -176,6 +177,19 @@ bool TendermintApplication::process(Buffer& read_buffer, Buffer& write_buffer)
   req.ParseFromArray(read_buffer.as_span().data(), size);
   read_buffer.consume(size);
 
+  std::unique_lock<std::mutex> block_lock(block_mutex, std::defer_lock);
+  switch (req.value_case()) {
+    case Request::ValueCase::kInitChain:
+    case Request::ValueCase::kBeginBlock:
+    case Request::ValueCase::kDeliverTx:
+    case Request::ValueCase::kEndBlock:
+    case Request::ValueCase::kCommit:
+      block_lock.lock();
+      break;
+    default:
+      break;
+  }
+
   switch (req.value_case()) {
     case Request::ValueCase::kEcho:
       res.mutable_echo()->set_message(req.echo().message());
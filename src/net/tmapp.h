@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include "abci/abci.h"
@@ -41,11 +43,14 @@ public:
   init(const std::vector<std::pair<VerifyKey, uint64_t>>& validators,
        const std::string& init_state) = 0;
 
-  /// Query blockchain state.
+  /// Query blockchain state. May be called while a block is being executed,
+  /// so it must only read the committed state.
   virtual std::string query(const std::string& path,
                             const std::string& data) = 0;
 
-  /// Apply an incoming message. Throw if the message is not valid.
+  /// Check an incoming message. Throw if the message is not valid. May be
+  /// called while a block is being executed, so it must not touch the state
+  /// of that block.
   virtual void check(const std::string& msg_raw) = 0;
 
   /// Apply an incoming message to the blockchain.
@@ -80,8 +85,18 @@ private:
   void do_end_block(const RequestEndBlock&, ResponseEndBlock&);
   void do_commit(ResponseCommit&);
 
-  /// Process incoming message and write to the outgoing buffer.
+  /// Process incoming message and write to the outgoing buffer. Safe to call
+  /// from concurrent connections. See block_mutex below.
   bool process(Buffer& read_buffer, Buffer& write_buffer) final;
 
+  /// Guard of the block execution. Tendermint talks to the application over
+  /// separate consensus, mempool and query connections, which may be served
+  /// by different threads. The block requests hold it. CheckTx, Info and
+  /// Query only need the committed state and never wait for a block.
+  std::mutex block_mutex;
+
+  /// The height of the last committed block, as reported by Info and Query.
+  std::atomic<uint64_t> committed_block_height{0};
+
   static inline auto log = logger::get("tmapp");
 };
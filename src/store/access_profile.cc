@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "access_profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+#include "util/buffer.h"
+
+AccessProfile::AccessProfile(size_t _capacity)
+    : capacity(_capacity)
+{
+}
+
+void AccessProfile::record(const std::string& key)
+{
+  auto& count = counts[key];
+  if (count != std::numeric_limits<uint32_t>::max())
+    ++count;
+
+  if (counts.size() > 2 * capacity)
+    decay();
+}
+
+std::vector<std::string> AccessProfile::hottest(size_t limit) const
+{
+  std::vector<std::string> keys;
+  for (auto& [key, count] : top(limit))
+    keys.push_back(key);
+  return keys;
+}
+
+void AccessProfile::save(const std::string& path) const
+{
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    file << Buffer::serialize(top(capacity));
+    if (!file)
+      throw Failure("AccessProfile::save: failed to write {}", tmpPath);
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    throw Failure("AccessProfile::save: failed to rename {} to {}", tmpPath,
+                  path);
+}
+
+void AccessProfile::load(const std::string& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return;
+
+  std::string raw((std::istreambuf_iterator<char>(file)),
+                  std::istreambuf_iterator<char>());
+  std::vector<std::pair<std::string, uint32_t>> entries;
+  try {
+    Buffer buf = Buffer::view(gsl::as_bytes(gsl::make_span(raw)));
+    // Every entry takes at least a few bytes, so a count that the rest of the
+    // file cannot hold is rejected before allocating for it.
+    const uint64_t count = buf.read<uint64_t>();
+    const size_t minEntrySize =
+        encoded_size(std::string()) + encoded_size(uint32_t(0));
+    if (count > uint64_t(buf.size_bytes()) / minEntrySize)
+      throw Error("{} entries cannot fit in {} bytes", count,
+                  buf.size_bytes());
+    entries.resize(count);
+    for (auto& entry : entries)
+      buf >> entry;
+  } catch (const Error& err) {
+    throw Failure("AccessProfile::load: {} is corrupt: {}", path, err.what());
+  }
+
+  for (auto& [key, count] : entries) {
+    auto& current = counts[key];
+    current = std::max(current, count);
+  }
+
+  if (counts.size() > 2 * capacity)
+    decay();
+}
+
+std::vector<std::pair<std::string, uint32_t>>
+AccessProfile::top(size_t limit) const
+{
+  std::vector<std::pair<std::string, uint32_t>> entries(counts.begin(),
+                                                        counts.end());
+  auto cmp = [](const auto& lhs, const auto& rhs) {
+    return lhs.second > rhs.second;
+  };
+  if (entries.size() > limit) {
+    std::nth_element(entries.begin(), entries.begin() + limit, entries.end(),
+                     cmp);
+    entries.resize(limit);
+  }
+  std::sort(entries.begin(), entries.end(), cmp);
+  return entries;
+}
+
+void AccessProfile::decay()
+{
+  for (auto it = counts.begin(); it != counts.end();) {
+    it->second /= 2;
+    if (it->second == 0) {
+      it = counts.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Keys accessed exactly as often as each other may survive halving. Keep
+  // only the hottest ones in that case.
+  if (counts.size() > capacity) {
+    auto entries = top(capacity);
+    counts = std::unordered_map<std::string, uint32_t>(entries.begin(),
+                                                       entries.end());
+  }
+}
@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+
+/// AccessProfile keeps a compact, approximate access frequency of storage
+/// keys. The counts are halved whenever the profile grows past twice its
+/// capacity, so keys that stop being accessed eventually fall out. The hottest
+/// keys can be saved to a file and loaded back after a restart.
+class AccessProfile
+{
+public:
+  AccessProfile(size_t capacity);
+
+  /// Record one access of the given key.
+  void record(const std::string& key);
+
+  /// Return at most limit keys, hottest first.
+  std::vector<std::string> hottest(size_t limit) const;
+
+  /// Write the hottest keys together with their counts to the given path.
+  /// The file is replaced atomically.
+  void save(const std::string& path) const;
+
+  /// Merge the profile saved at the given path into this one. Do nothing if
+  /// the file does not exist. Throw Failure if the file is corrupt.
+  void load(const std::string& path);
+
+private:
+  /// Return at most limit (key, count) entries, sorted by count descending.
+  std::vector<std::pair<std::string, uint32_t>> top(size_t limit) const;
+
+  /// Halve all the counts and drop the keys that reach zero.
+  void decay();
+
+private:
+  /// The number of keys kept when the profile is saved or decayed.
+  const size_t capacity;
+
+  /// The approximate access count of each key.
+  std::unordered_map<std::string, uint32_t> counts;
+};
@@ -0,0 +1,343 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <nonstd/optional.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/field_key.h"
+#include "store/storage.h"
+#include "util/buffer.h"
+
+/// Shorthand macro to define bitmap field inside of contract.
+#define BITMAP(NAME) Bitmap NAME{storage, key, "/" #NAME "/"};
+
+/// Bitmap is a set of dense 32-bit IDs stored as compressed chunks, in the
+/// style of Roaring bitmaps. The high 16 bits of an ID select the chunk and
+/// the low 16 bits a position in it. A chunk with few IDs keeps them as a
+/// sorted array, and switches to a plain 8 KiB bitset once the array would
+/// be larger. Each chunk is one key-value entry, so checking a flag reads one
+/// chunk and counting reads each chunk once. The indices of the non-empty
+/// chunks are stored at the base key.
+class Bitmap
+{
+public:
+  Bitmap(Storage& _storage, const std::string& _key)
+      : storage(_storage)
+      , baseKey(_key)
+  {
+  }
+
+  /// Create this bitmap for the field of the contract at parentKey.
+  Bitmap(Storage& _storage, const std::string& parentKey, const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
+  }
+
+  /// Copy and move don't make much sense here and can lead to weird bugs.
+  /// Better to just disable them both.
+  Bitmap(const Bitmap& bitmap) = delete;
+  Bitmap(Bitmap&& bitmap) = delete;
+
+  /// Write back the chunks and the chunk list whose bytes differ from the
+  /// ones loaded. Empty chunks are deleted.
+  ~Bitmap()
+  {
+    if (!storage.shouldFlush())
+      return;
+
+    for (auto& [chunkIdx, chunk] : cache) {
+      if (!chunk.isChanged)
+        continue;
+      if (chunk.cardinality() == 0) {
+        if (chunk.loaded)
+          storage.del(chunkKey(chunkIdx));
+        continue;
+      }
+      std::string raw = chunk.encode();
+      if (chunk.loaded != raw)
+        storage.put(chunkKey(chunkIdx), raw);
+    }
+
+    if (isChunkListLoaded) {
+      std::string raw = Buffer::serialize(chunkList);
+      if (loadedChunkList ? raw != *loadedChunkList : !chunkList.empty())
+        storage.put(baseKey.str(), raw);
+    }
+  }
+
+  /// Return whether the ID is in the bitmap.
+  bool test(uint32_t id) const
+  {
+    return getChunk(id >> 16).test(id & 0xffff);
+  }
+
+  /// Add the ID to the bitmap. Return false if it was already there.
+  bool set(uint32_t id)
+  {
+    Chunk& chunk = getChunk(id >> 16);
+    const bool wasEmpty = chunk.cardinality() == 0;
+    if (!chunk.set(id & 0xffff))
+      return false;
+
+    if (wasEmpty) {
+      loadChunkList();
+      chunkList.insert(std::lower_bound(chunkList.begin(), chunkList.end(),
+                                        uint16_t(id >> 16)),
+                       id >> 16);
+    }
+    return true;
+  }
+
+  /// Remove the ID from the bitmap. Return false if it was not there.
+  bool clear(uint32_t id)
+  {
+    Chunk& chunk = getChunk(id >> 16);
+    if (!chunk.clear(id & 0xffff))
+      return false;
+
+    if (chunk.cardinality() == 0) {
+      loadChunkList();
+      chunkList.erase(std::lower_bound(chunkList.begin(), chunkList.end(),
+                                       uint16_t(id >> 16)));
+    }
+    return true;
+  }
+
+  /// Return the number of IDs in the bitmap.
+  uint64_t count() const
+  {
+    loadChunkList();
+    uint64_t result = 0;
+    for (uint16_t chunkIdx : chunkList)
+      result += getChunk(chunkIdx).cardinality();
+    return result;
+  }
+
+  /// Call fn with every ID in the bitmap in increasing order.
+  template <typename Fn>
+  void forEach(Fn&& fn) const
+  {
+    loadChunkList();
+    for (uint16_t chunkIdx : chunkList) {
+      const uint32_t high = uint32_t(chunkIdx) << 16;
+      const Chunk& chunk = getChunk(chunkIdx);
+      if (!chunk.isBitset) {
+        for (uint16_t low : chunk.array)
+          fn(high | low);
+        continue;
+      }
+      for (uint32_t word = 0; word < WordsPerBitset; ++word) {
+        for (uint64_t bits = chunk.words[word]; bits != 0; bits &= bits - 1)
+          fn(high | (word << 6) | __builtin_ctzll(bits));
+      }
+    }
+  }
+
+public:
+  /// The largest array chunk. Beyond this, an array takes more space than a
+  /// bitset of the whole chunk.
+  static constexpr size_t MaxArraySize = 4096;
+  static constexpr uint32_t WordsPerBitset = 1024;
+
+private:
+  struct Chunk {
+    /// The sorted low bits of the IDs if not a bitset.
+    std::vector<uint16_t> array;
+
+    /// The bits of the chunk if a bitset.
+    std::vector<uint64_t> words;
+    bool isBitset = false;
+    uint32_t bitsetCardinality = 0;
+
+    nonstd::optional<std::string> loaded;
+    bool isChanged = false;
+
+    uint32_t cardinality() const
+    {
+      return isBitset ? bitsetCardinality : array.size();
+    }
+
+    bool test(uint16_t low) const
+    {
+      if (isBitset)
+        return (words[low >> 6] >> (low & 63)) & 1;
+      return std::binary_search(array.begin(), array.end(), low);
+    }
+
+    bool set(uint16_t low)
+    {
+      if (isBitset) {
+        uint64_t& word = words[low >> 6];
+        const uint64_t mask = uint64_t(1) << (low & 63);
+        if (word & mask)
+          return false;
+        word |= mask;
+        ++bitsetCardinality;
+      } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (it != array.end() && *it == low)
+          return false;
+        array.insert(it, low);
+        if (array.size() > MaxArraySize)
+          toBitset();
+      }
+      isChanged = true;
+      return true;
+    }
+
+    bool clear(uint16_t low)
+    {
+      if (isBitset) {
+        uint64_t& word = words[low >> 6];
+        const uint64_t mask = uint64_t(1) << (low & 63);
+        if (!(word & mask))
+          return false;
+        word &= ~mask;
+        if (--bitsetCardinality <= MaxArraySize)
+          toArray();
+      } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (it == array.end() || *it != low)
+          return false;
+        array.erase(it);
+      }
+      isChanged = true;
+      return true;
+    }
+
+    void toBitset()
+    {
+      words.assign(WordsPerBitset, 0);
+      for (uint16_t low : array)
+        words[low >> 6] |= uint64_t(1) << (low & 63);
+      bitsetCardinality = array.size();
+      array.clear();
+      array.shrink_to_fit();
+      isBitset = true;
+    }
+
+    void toArray()
+    {
+      array.clear();
+      array.reserve(bitsetCardinality);
+      for (uint32_t word = 0; word < WordsPerBitset; ++word) {
+        for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+          array.push_back((word << 6) | __builtin_ctzll(bits));
+      }
+      words.clear();
+      words.shrink_to_fit();
+      isBitset = false;
+    }
+
+    /// Encode as 'a' followed by the array, or 'b' followed by the words, all
+    /// little endian.
+    std::string encode() const
+    {
+      std::string raw(1, isBitset ? 'b' : 'a');
+      if (isBitset) {
+        raw.reserve(1 + 8 * WordsPerBitset);
+        for (uint64_t word : words)
+          for (int shift = 0; shift < 64; shift += 8)
+            raw.push_back(char(word >> shift));
+      } else {
+        raw.reserve(1 + 2 * array.size());
+        for (uint16_t low : array) {
+          raw.push_back(char(low));
+          raw.push_back(char(low >> 8));
+        }
+      }
+      return raw;
+    }
+
+    void decode(const std::string& raw)
+    {
+      const auto byte = [&](size_t idx) { return uint8_t(raw[idx]); };
+      if (raw.size() == 1 + 8 * WordsPerBitset && raw[0] == 'b') {
+        words.assign(WordsPerBitset, 0);
+        for (uint32_t word = 0; word < WordsPerBitset; ++word)
+          for (int shift = 0; shift < 64; shift += 8)
+            words[word] |= uint64_t(byte(1 + 8 * word + shift / 8)) << shift;
+        bitsetCardinality = 0;
+        for (uint64_t word : words)
+          bitsetCardinality += __builtin_popcountll(word);
+        isBitset = true;
+      } else if (raw.size() % 2 == 1 && raw[0] == 'a') {
+        for (size_t idx = 1; idx < raw.size(); idx += 2)
+          array.push_back(byte(idx) | (byte(idx + 1) << 8));
+      } else {
+        throw Failure("Bitmap: invalid chunk encoding");
+      }
+    }
+  };
+
+  std::string chunkKey(uint16_t chunkIdx) const
+  {
+    return baseKey + std::to_string(chunkIdx);
+  }
+
+  const Chunk& getChunk(uint16_t chunkIdx) const
+  {
+    if (auto it = cache.find(chunkIdx); it != cache.end())
+      return it->second;
+
+    Chunk chunk;
+    chunk.loaded = storage.get(chunkKey(chunkIdx));
+    if (chunk.loaded)
+      chunk.decode(*chunk.loaded);
+    return cache.emplace(chunkIdx, std::move(chunk)).first->second;
+  }
+
+  Chunk& getChunk(uint16_t chunkIdx)
+  {
+    return const_cast<Chunk&>(
+        static_cast<const Bitmap*>(this)->getChunk(chunkIdx));
+  }
+
+  void loadChunkList() const
+  {
+    if (isChunkListLoaded)
+      return;
+
+    loadedChunkList = storage.get(baseKey.str());
+    if (loadedChunkList)
+      chunkList = Buffer::deserialize<std::vector<uint16_t>>(*loadedChunkList);
+    isChunkListLoaded = true;
+  }
+
+private:
+  /// Reference to the storage layer.
+  Storage& storage;
+
+  /// The key holding the chunk list. Each chunk lives at the key followed by
+  /// its index.
+  const FieldKey baseKey;
+
+  /// The sorted indices of the non-empty chunks. Only valid once
+  /// isChunkListLoaded is true.
+  mutable std::vector<uint16_t> chunkList;
+  mutable nonstd::optional<std::string> loadedChunkList;
+  mutable bool isChunkListLoaded = false;
+
+  /// The chunks that have been accessed.
+  mutable std::unordered_map<uint16_t, Chunk> cache;
+};
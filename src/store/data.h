@@ -21,21 +21,22 @@
 #include <nonstd/optional.hpp>
 
 #include "inc/essential.h"
+#include "store/field_key.h"
 #include "store/storage.h"
 #include "util/buffer.h"
 
 /// Shorthand marcro to define data field inside of contract.
-#define DATA(TYPE, NAME) Data<TYPE> NAME{storage, key + "/" + #NAME};
+#define DATA(TYPE, NAME) Data<TYPE> NAME{storage, key, "/" #NAME};
 
 /// The status of data inside the wrapper. Data will be flushed to database
 /// following this status.
-ENUM(DataCacheStatus, uint8_t, Unchanged, Changed, Erased)
+ENUM(DataCacheStatus, uint8_t, Unchanged, Changed, Erased, Merged)
 
 /// Data is a wrapper for any data type on top of a key-value storage layer.
 /// It is responsible for loading data from the underlying store, saving changes
 /// and flushing the change to the store on destruction.
 template <typename T>
-class Data
+class Data : private FlushHook
 {
 public:
   /// Create this data wrapper based on the given key and the storage reference.
@@ -45,26 +46,30 @@ public:
   {
   }
 
+  /// Create this data wrapper for the field of the contract at parentKey. The
+  /// key is only built when the storage is first accessed.
+  Data(Storage& _storage, const std::string& parentKey, const char* suffix)
+      : storage(_storage)
+      , key(parentKey, suffix)
+  {
+  }
+
   /// On destruction, flush all changes made to this wrapper into the persistent
-  /// key-value storage.
+  /// key-value storage. Changes that leave the stored bytes as they were loaded
+  /// are not written. Errors are logged rather than thrown, since throwing
+  /// from a destructor would terminate the node.
   ~Data()
   {
+    if (isHooked)
+      storage.removeFlushHook(this);
+
     if (!storage.shouldFlush())
       return;
 
-    switch (status) {
-      case +DataCacheStatus::Unchanged:
-        break;
-      case +DataCacheStatus::Changed: {
-        DEBUG(log, "PUT {} -> {}", key, *cache);
-        storage.put(key, Buffer::serialize<T>(*cache));
-        break;
-      }
-      case +DataCacheStatus::Erased: {
-        DEBUG(log, "DEL {}", key);
-        storage.del(key);
-        break;
-      }
+    try {
+      write();
+    } catch (const std::exception& err) {
+      WARN(log, "Failed to flush {}: {}", key.str(), err.what());
     }
   }
 
@@ -83,19 +88,27 @@ public:
     if (cache)
       return *cache;
 
-    nonstd::optional<std::string> result = storage.get(key);
+    nonstd::optional<std::string> result = storage.get(key.str());
+    loaded = result;
+    isLoaded = true;
 
     if (result) {
       cache = Buffer::deserialize<T>(*result);
-      return *cache;
-    }
-
-    if constexpr (!std::is_enum_v<T>) {
+    } else if constexpr (!std::is_enum_v<T>) {
       cache = T{};
-      return *cache;
+    } else {
+      throw Error("Data::operator+: construct object without default ctor");
     }
 
-    throw Error("Data::operator+: construct object without default ctor");
+    if constexpr (std::is_same_v<T, uint256_t>) {
+      // Fold the pending delta now that the base value is known.
+      if (status == DataCacheStatus::Merged) {
+        *cache += delta;
+        delta = 0;
+        status = DataCacheStatus::Changed;
+      }
+    }
+    return *cache;
   }
 
   /// Check if the data actually has the underlying value backed in storage.
@@ -104,10 +117,10 @@ public:
     if (status == DataCacheStatus::Erased)
       return false;
 
-    if (cache)
+    if (cache || status == DataCacheStatus::Merged)
       return true;
 
-    return storage.get(key).has_value();
+    return storage.get(key.str()).has_value();
   }
 
   /// Update the value. Note that it does not actually make the change into the
@@ -115,30 +128,113 @@ public:
   void operator=(const T& value)
   {
     cache = value;
+    delta = 0;
     status = DataCacheStatus::Changed;
   }
 
+  /// Add the given value to the underlying integer. If the current value has
+  /// not been loaded, the delta is recorded without reading the storage and is
+  /// folded into the stored value at the start of the flush. This keeps hot
+  /// counters free of read dependencies, while an overflow still fails the
+  /// transaction rather than the write-back.
+  void add(const uint256_t& value)
+  {
+    static_assert(std::is_same_v<T, uint256_t>,
+                  "Data::add is only available for uint256_t");
+
+    if (cache) {
+      *cache += value;
+      status = DataCacheStatus::Changed;
+    } else if (status == DataCacheStatus::Erased) {
+      cache = value;
+      status = DataCacheStatus::Changed;
+    } else {
+      delta += value;
+      status = DataCacheStatus::Merged;
+      if (!isHooked) {
+        storage.addFlushHook(this);
+        isHooked = true;
+      }
+    }
+  }
+
   /// Mark the value as erased. Similar to operator=, this is not reflect in the
   /// storage until data destruction.
   void erase()
   {
     cache = nonstd::nullopt;
+    delta = 0;
     status = DataCacheStatus::Erased;
   }
 
+private:
+  /// Fold the pending delta into the stored value. Throw if the sum overflows.
+  void prepareFlush() final
+  {
+    isHooked = false;
+    if (status == DataCacheStatus::Merged)
+      +*this;
+  }
+
+  /// Write the change made to this wrapper into the storage.
+  void write()
+  {
+    switch (status) {
+      case +DataCacheStatus::Unchanged:
+        break;
+      case +DataCacheStatus::Changed: {
+        // Reuse one scratch string per thread for the serialized value.
+        static thread_local std::string raw;
+        Buffer::serializeInto<T>(*cache, raw);
+        if (isLoaded && loaded == raw)
+          break;
+        DEBUG(log, "PUT {} -> {}", key.str(), *cache);
+        storage.put(key.str(), raw);
+        break;
+      }
+      case +DataCacheStatus::Erased: {
+        if (isLoaded && !loaded)
+          break;
+        DEBUG(log, "DEL {}", key.str());
+        storage.del(key.str());
+        break;
+      }
+      case +DataCacheStatus::Merged: {
+        // Only reached if the flush hook did not run.
+        if (delta == 0)
+          break;
+        DEBUG(log, "ADD {} += {}", key.str(), delta);
+        storage.add(key.str(), delta);
+        break;
+      }
+    }
+  }
+
 private:
   /// Reference to the storage layer.
   Storage& storage;
 
   /// The key to which this wrapper use to access data.
-  const std::string key;
+  const FieldKey key;
 
   /// The status of the cache below.
-  DataCacheStatus status = DataCacheStatus::Unchanged;
+  mutable DataCacheStatus status = DataCacheStatus::Unchanged;
 
   /// The cache value. This will be flushed once this wrapper is destroyed.
   mutable nonstd::optional<T> cache;
 
+  /// The sum of all deltas added while the value is not loaded. Only relevant
+  /// when the status is Merged.
+  mutable uint256_t delta = 0;
+
+  /// The raw bytes read from the storage, or nullopt if the key did not exist.
+  /// Only valid if isLoaded is true.
+  mutable nonstd::optional<std::string> loaded;
+  mutable bool isLoaded = false;
+
+  /// Whether this is registered to fold its delta at the next flush.
+  bool isHooked = false;
+
   /// Static logger for this class.
   static inline auto log = logger::get("data");
 };
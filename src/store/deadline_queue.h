@@ -0,0 +1,241 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <nonstd/optional.hpp>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/field_key.h"
+#include "store/storage.h"
+#include "util/buffer.h"
+
+#define DEADLINE_QUEUE(VAL, NAME)                                              \
+  DeadlineQueue<VAL> NAME{storage, key, "/" #NAME "/"};
+
+/// DeadlineQueue is a binary min-heap of (deadline, id) entries laid out in
+/// the key-value storage, one entry per slot. Both push and pop touch
+/// O(log n) slots, so processing expiries at EndBlock costs time proportional
+/// to the number of entries that are actually due. Entries with the same
+/// deadline come out in the order they were pushed.
+template <typename T>
+class DeadlineQueue
+{
+public:
+  DeadlineQueue(Storage& _storage, const std::string& _key)
+      : storage(_storage)
+      , baseKey(_key)
+  {
+  }
+
+  /// Create this queue for the field of the contract at parentKey. Nothing is
+  /// read from the storage until the queue is first used.
+  DeadlineQueue(Storage& _storage,
+                const std::string& parentKey,
+                const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
+  }
+
+  ~DeadlineQueue()
+  {
+    if (!storage.shouldFlush() || !isChanged)
+      return;
+
+    storage.put(baseKey.str(),
+                Buffer::serialize(std::make_pair(mSize, nextSeq)));
+    for (uint64_t idx : dirty) {
+      if (idx < mSize) {
+        DEBUG(log, "PUT {}", baseKey + std::to_string(idx));
+        storage.put(baseKey + std::to_string(idx),
+                    Buffer::serialize(cache.at(idx)));
+      }
+    }
+    // Slots past the new end were stored before but are no longer part of
+    // the heap.
+    for (uint64_t idx = mSize; idx < storedSize; ++idx) {
+      DEBUG(log, "DEL {}", baseKey + std::to_string(idx));
+      storage.del(baseKey + std::to_string(idx));
+    }
+  }
+
+  /// Schedule the given id at the given deadline.
+  void push(uint64_t deadline, const T& id)
+  {
+    loadHeader();
+    set(mSize, Entry{deadline, nextSeq++, id});
+    ++mSize;
+    siftUp(mSize - 1);
+  }
+
+  /// Remove and return, earliest first, at most limit ids whose deadline is
+  /// not after now.
+  std::vector<T> popDue(uint64_t now, size_t limit)
+  {
+    loadHeader();
+    std::vector<T> result;
+    while (mSize > 0 && result.size() < limit && get(0).deadline <= now) {
+      result.push_back(get(0).id);
+      --mSize;
+      if (mSize > 0) {
+        set(0, get(mSize));
+        siftDown(0);
+      }
+    }
+    return result;
+  }
+
+  /// Return the earliest deadline in this queue, or nullopt if it is empty.
+  nonstd::optional<uint64_t> nextDeadline() const
+  {
+    loadHeader();
+    if (mSize == 0)
+      return nonstd::nullopt;
+    return get(0).deadline;
+  }
+
+  /// Return the number of entries in this queue.
+  uint64_t size() const
+  {
+    loadHeader();
+    return mSize;
+  }
+
+private:
+  struct Entry {
+    uint64_t deadline;
+    uint64_t seq;
+    T id;
+
+    bool operator<(const Entry& rhs) const
+    {
+      return std::tie(deadline, seq) < std::tie(rhs.deadline, rhs.seq);
+    }
+
+    friend Buffer& operator<<(Buffer& buf, const Entry& entry)
+    {
+      return buf << entry.deadline << entry.seq << entry.id;
+    }
+
+    friend Buffer& operator>>(Buffer& buf, Entry& entry)
+    {
+      return buf >> entry.deadline >> entry.seq >> entry.id;
+    }
+  };
+
+  /// Load the size and the sequence number from the storage if not done yet.
+  void loadHeader() const
+  {
+    if (isHeaderLoaded)
+      return;
+
+    if (auto result = storage.get(baseKey.str()); result) {
+      std::tie(mSize, nextSeq) =
+          Buffer::deserialize<std::pair<uint64_t, uint64_t>>(*result);
+    }
+    storedSize = mSize;
+    isHeaderLoaded = true;
+  }
+
+  const Entry& get(uint64_t idx) const
+  {
+    if (auto it = cache.find(idx); it != cache.end())
+      return it->second;
+
+    auto result = storage.get(baseKey + std::to_string(idx));
+    if (!result)
+      throw Failure("DeadlineQueue: value missing at index {}", idx);
+
+    return cache.emplace(idx, Buffer::deserialize<Entry>(*result))
+        .first->second;
+  }
+
+  void set(uint64_t idx, const Entry& entry)
+  {
+    cache.insert_or_assign(idx, entry);
+    dirty.insert(idx);
+    isChanged = true;
+  }
+
+  void siftUp(uint64_t idx)
+  {
+    Entry entry = get(idx);
+    while (idx > 0) {
+      uint64_t parent = (idx - 1) / 2;
+      if (!(entry < get(parent)))
+        break;
+      set(idx, get(parent));
+      idx = parent;
+    }
+    set(idx, entry);
+  }
+
+  void siftDown(uint64_t idx)
+  {
+    Entry entry = get(idx);
+    while (true) {
+      uint64_t child = 2 * idx + 1;
+      if (child >= mSize)
+        break;
+      if (child + 1 < mSize && get(child + 1) < get(child))
+        ++child;
+      if (!(get(child) < entry))
+        break;
+      set(idx, get(child));
+      idx = child;
+    }
+    set(idx, entry);
+  }
+
+private:
+  /// Reference to the storage layer.
+  Storage& storage;
+
+  /// The key to which this DeadlineQueue use to access data. The header
+  /// (size, next sequence number) lives at the key itself and the slots at
+  /// the key followed by their indices.
+  const FieldKey baseKey;
+
+  /// The number of entries in the heap.
+  mutable uint64_t mSize = 0;
+
+  /// The number of entries in the heap as of the last flush.
+  mutable uint64_t storedSize = 0;
+
+  /// Sequence number for the next pushed entry. Break ties between deadlines.
+  mutable uint64_t nextSeq = 0;
+
+  /// Whether the three values above have been loaded from the storage.
+  mutable bool isHeaderLoaded = false;
+
+  /// The slots that have been read or written since this was loaded.
+  mutable std::unordered_map<uint64_t, Entry> cache;
+
+  /// The slots that have been written and must be saved on flush.
+  std::unordered_set<uint64_t> dirty;
+
+  /// True if anything has been pushed or popped since this was loaded.
+  bool isChanged = false;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("deadline_queue");
+};
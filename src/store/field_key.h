@@ -0,0 +1,69 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include "inc/essential.h"
+
+/// FieldKey is the storage key of a contract field. A field declared with one
+/// of the field macros (DATA, SET, ...) refers to the key of its contract and a
+/// literal suffix, and the full key string is only built the first time it is
+/// needed. This way instantiating a contract does not allocate anything for the
+/// fields that are never used.
+class FieldKey
+{
+public:
+  /// Create a key that is already materialized.
+  FieldKey(const std::string& key)
+      : parent(nullptr)
+      , suffix(nullptr)
+      , full(key)
+  {
+  }
+
+  /// Create a key made of the given parent key, which must outlive this, and
+  /// the given literal suffix.
+  FieldKey(const std::string& _parent, const char* _suffix)
+      : parent(&_parent)
+      , suffix(_suffix)
+  {
+  }
+
+  /// Return the full key string, building it on first use.
+  const std::string& str() const
+  {
+    if (parent != nullptr) {
+      full = *parent + suffix;
+      parent = nullptr;
+    }
+    return full;
+  }
+
+  /// Return the full key string followed by the given extension.
+  std::string operator+(const std::string& extension) const
+  {
+    return str() + extension;
+  }
+
+private:
+  /// The parent key and the suffix, until the full key is built.
+  mutable const std::string* parent;
+  const char* suffix;
+
+  /// The full key. Only valid once parent is nullptr.
+  mutable std::string full;
+};
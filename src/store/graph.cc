@@ -0,0 +1,41 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "store/graph.h"
+
+Quad GraphStore::intern(const NodeID& subject,
+                        const NodeID& predicate,
+                        const NodeID& object,
+                        const NodeID& label)
+{
+  return {nodes.intern(subject), nodes.intern(predicate), nodes.intern(object),
+          nodes.intern(label)};
+}
+
+nonstd::optional<Quad> GraphStore::find(const NodeID& subject,
+                                        const NodeID& predicate,
+                                        const NodeID& object,
+                                        const NodeID& label) const
+{
+  auto subjectID = nodes.find(subject);
+  auto predicateID = nodes.find(predicate);
+  auto objectID = nodes.find(object);
+  auto labelID = nodes.find(label);
+  if (!subjectID || !predicateID || !objectID || !labelID)
+    return nonstd::nullopt;
+  return Quad{*subjectID, *predicateID, *objectID, *labelID};
+}
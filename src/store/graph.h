@@ -17,23 +17,63 @@
 
 #pragma once
 
-#include <string>
+#include <nonstd/optional.hpp>
+#include <tuple>
 
 #include "inc/essential.h"
-#include "util/json.h"
+#include "store/node_interner.h"
+#include "util/string.h"
+
+/// Quad is an edge of the graph with each of its four nodes replaced by the
+/// ID it was interned to. Comparing quads is a handful of integer compares.
+struct Quad {
+  NodeInterner::ID subject;
+  NodeInterner::ID predicate;
+  NodeInterner::ID object;
+  NodeInterner::ID label;
+
+  bool operator<(const Quad& quad) const
+  {
+    return std::tie(subject, predicate, object, label) <
+           std::tie(quad.subject, quad.predicate, quad.object, quad.label);
+  }
+
+  bool operator==(const Quad& quad) const
+  {
+    return subject == quad.subject && predicate == quad.predicate &&
+           object == quad.object && label == quad.label;
+  }
+};
 
 class GraphStore
 {
 public:
   virtual ~GraphStore() {}
 
-  virtual void add_edge(const std::string& subject,
-                        const std::string& predicate,
-                        const std::string& object,
-                        const std::string& label) = 0;
+  /// Intern the four nodes of an edge and return the quad that identifies it
+  /// in this store.
+  Quad intern(const NodeID& subject,
+              const NodeID& predicate,
+              const NodeID& object,
+              const NodeID& label);
+
+  /// Return the quad of the edge with the given nodes, or nullopt if any of
+  /// them has never been interned, in which case the edge cannot exist.
+  nonstd::optional<Quad> find(const NodeID& subject,
+                              const NodeID& predicate,
+                              const NodeID& object,
+                              const NodeID& label) const;
+
+  /// Return the table of nodes interned by this store.
+  const NodeInterner& get_nodes() const
+  {
+    return nodes;
+  }
+
+  virtual void add_edge(const Quad& edge) = 0;
+
+  virtual void delete_edge(const Quad& edge) = 0;
 
-  virtual void delete_edge(const std::string& subject,
-                           const std::string& predicate,
-                           const std::string& object,
-                           const std::string& label) = 0;
+protected:
+  NodeInterner nodes;
 };
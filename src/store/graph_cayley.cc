@@ -30,34 +30,23 @@ GraphStoreCayley::GraphStoreCayley(boost::asio::io_service& _service,
 {
 }
 
-void GraphStoreCayley::add_edge(const std::string& subject,
-                                const std::string& predicate,
-                                const std::string& object,
-                                const std::string& label)
+void GraphStoreCayley::add_edge(const Quad& edge)
 {
-  send_request_and_get_response(
-      "/api/v2/write", create_body_msg(subject, predicate, object, label));
+  send_request_and_get_response("/api/v2/write", create_body_msg(edge));
 }
 
-void GraphStoreCayley::delete_edge(const std::string& subject,
-                                   const std::string& predicate,
-                                   const std::string& object,
-                                   const std::string& label)
+void GraphStoreCayley::delete_edge(const Quad& edge)
 {
-  send_request_and_get_response(
-      "/api/v2/delete", create_body_msg(subject, predicate, object, label));
+  send_request_and_get_response("/api/v2/delete", create_body_msg(edge));
 }
 
-std::string GraphStoreCayley::create_body_msg(const std::string& subject,
-                                              const std::string& predicate,
-                                              const std::string& object,
-                                              const std::string& label)
+std::string GraphStoreCayley::create_body_msg(const Quad& edge) const
 {
   json j;
-  j["subject"] = subject;
-  j["predicate"] = predicate;
-  j["object"] = object;
-  j["label"] = label;
+  j["subject"] = nodes.get(edge.subject).to_string();
+  j["predicate"] = nodes.get(edge.predicate).to_string();
+  j["object"] = nodes.get(edge.object).to_string();
+  j["label"] = nodes.get(edge.label).to_string();
   return "[" + j.dump() + "]";
 }
 
@@ -29,20 +29,13 @@ public:
                    const std::string& _hostname,
                    uint16_t _port);
 
-  void add_edge(const std::string& subject,
-                const std::string& predicate,
-                const std::string& object,
-                const std::string& label) final;
-  void delete_edge(const std::string& subject,
-                   const std::string& predicate,
-                   const std::string& object,
-                   const std::string& label) final;
+  void add_edge(const Quad& edge) final;
+  void delete_edge(const Quad& edge) final;
 
 private:
-  std::string create_body_msg(const std::string& subject,
-                              const std::string& predicate,
-                              const std::string& object,
-                              const std::string& label);
+  /// Build the JSON body for the given edge, resolving its nodes back to the
+  /// names Cayley knows them by.
+  std::string create_body_msg(const Quad& edge) const;
 
   void send_request_and_get_response(const std::string& path,
                                      const std::string& data);
@@ -17,18 +17,17 @@
 
 #include "store/graph_set.h"
 
-void GraphStoreSet::add_edge(const std::string& subject,
-                             const std::string& predicate,
-                             const std::string& object,
-                             const std::string& label)
+void GraphStoreSet::add_edge(const Quad& edge)
 {
-  edges.insert({subject, predicate, object, label});
+  edges.insert(edge);
 }
 
-void GraphStoreSet::delete_edge(const std::string& subject,
-                                const std::string& predicate,
-                                const std::string& object,
-                                const std::string& label)
+void GraphStoreSet::delete_edge(const Quad& edge)
 {
-  edges.erase({subject, predicate, object, label});
+  edges.erase(edge);
+}
+
+bool GraphStoreSet::has_edge(const Quad& edge) const
+{
+  return edges.count(edge) > 0;
 }
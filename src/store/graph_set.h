@@ -24,29 +24,18 @@
 class GraphStoreSet : public GraphStore
 {
 public:
-  void add_edge(const std::string& subject,
-                const std::string& predicate,
-                const std::string& object,
-                const std::string& label) final;
-  void delete_edge(const std::string& subject,
-                   const std::string& predicate,
-                   const std::string& object,
-                   const std::string& label) final;
+  void add_edge(const Quad& edge) final;
+  void delete_edge(const Quad& edge) final;
 
-private:
-  struct Edge {
-    std::string subject;
-    std::string predicate;
-    std::string object;
-    std::string label;
+  /// Return true if the given edge is currently in the graph.
+  bool has_edge(const Quad& edge) const;
 
-    bool operator<(const Edge& edge) const
-    {
-      return std::make_tuple(subject, predicate, object, label) <
-             std::make_tuple(edge.subject, edge.predicate, edge.subject,
-                             edge.label);
-    }
-  };
+  /// Return the number of edges in the graph.
+  size_t size() const
+  {
+    return edges.size();
+  }
 
-  std::set<Edge> edges;
+private:
+  std::set<Quad> edges;
 };
@@ -0,0 +1,547 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <nonstd/optional.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/field_key.h"
+#include "store/storage.h"
+#include "util/buffer.h"
+
+/// Shorthand macro to define iterable map field inside of contract.
+#define ITERABLE_MAP(KEY, VAL, NAME)                                           \
+  IterableMap<KEY, VAL> NAME{storage, key, "/" #NAME "/"};
+
+/// IterableMap maps keys of type K to values of type V, and can enumerate its
+/// keys in order. Each value lives at its own point key. Next to the values,
+/// the keys are kept sorted in pages of up to PageCapacity keys. The pages are
+/// listed in order by a two-level directory: segments of up to PageCapacity
+/// entries hold the first key and the ID of each page, and the root holds the
+/// first key and the ID of each segment. Adding or removing a key rewrites its
+/// page and at most one segment, while the root only changes as segments split
+/// or go away. Since the order is maintained by the map itself, any Storage
+/// backend works, ordered or not. K must be serializable and ordered by
+/// operator<.
+///
+/// The layout under the base key is "n" for the number of keys, "d" for the
+/// root of the directory, "s/<id>" for the directory segments, "p/<id>" for
+/// the key pages and "v/<key>" for the values.
+template <typename K, typename V, uint32_t PageCapacity = 64>
+class IterableMap
+{
+  /// The first key and the ID of every page of a segment, or of every segment
+  /// of the root, in order.
+  using Index = std::vector<std::pair<K, uint64_t>>;
+
+public:
+  /// Cursor over the keys in order. Moving a cursor loads the pages and the
+  /// directory segments it walks through. Cursors are invalidated by any
+  /// change to the map.
+  class Iterator
+  {
+  public:
+    /// Return the key under this cursor.
+    K key() const
+    {
+      return page().keys[offset];
+    }
+
+    /// Return the value mapped to the key under this cursor.
+    V value() const
+    {
+      return *map.get(key());
+    }
+
+    /// Move to the next key, or to end.
+    Iterator& operator++()
+    {
+      if (segmentIdx == map.root.size())
+        throw Error("IterableMap::Iterator: cannot move past the end");
+      if (++offset == page().keys.size()) {
+        offset = 0;
+        if (++pageIdx == segment().entries.size()) {
+          pageIdx = 0;
+          ++segmentIdx;
+        }
+      }
+      return *this;
+    }
+
+    /// Move to the previous key.
+    Iterator& operator--()
+    {
+      if (offset > 0) {
+        --offset;
+        return *this;
+      }
+
+      if (pageIdx > 0) {
+        --pageIdx;
+      } else if (segmentIdx > 0) {
+        --segmentIdx;
+        pageIdx = segment().entries.size() - 1;
+      } else {
+        throw Error("IterableMap::Iterator: cannot move before the beginning");
+      }
+      offset = page().keys.size() - 1;
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return segmentIdx == other.segmentIdx && pageIdx == other.pageIdx &&
+             offset == other.offset;
+    }
+
+    bool operator!=(const Iterator& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    friend class IterableMap;
+
+    Iterator(const IterableMap& _map,
+             size_t _segmentIdx,
+             size_t _pageIdx,
+             size_t _offset)
+        : map(_map)
+        , segmentIdx(_segmentIdx)
+        , pageIdx(_pageIdx)
+        , offset(_offset)
+    {
+    }
+
+    const auto& segment() const
+    {
+      return map.getSegment(map.root[segmentIdx].second);
+    }
+
+    const auto& page() const
+    {
+      return map.getPage(segment().entries[pageIdx].second);
+    }
+
+    const IterableMap& map;
+
+    /// The position of the segment in the root, of the page in the segment
+    /// and of the key in the page. End is one segment past the last segment.
+    size_t segmentIdx;
+    size_t pageIdx;
+    size_t offset;
+  };
+
+public:
+  IterableMap(Storage& _storage, const std::string& _key)
+      : storage(_storage)
+      , baseKey(_key)
+  {
+  }
+
+  /// Create this map for the field of the contract at parentKey.
+  IterableMap(Storage& _storage,
+              const std::string& parentKey,
+              const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
+  }
+
+  /// Copy and move don't make much sense here and can lead to weird bugs.
+  /// Better to just disable them both.
+  IterableMap(const IterableMap& iterableMap) = delete;
+  IterableMap(IterableMap&& iterableMap) = delete;
+
+  /// Write back the size, the directory, the pages and the values whose bytes
+  /// differ from the ones loaded.
+  ~IterableMap()
+  {
+    if (!storage.shouldFlush())
+      return;
+
+    if (isSizeLoaded && mapSize != loadedSize)
+      storage.put(baseKey + "n", Buffer::serialize(mapSize));
+
+    if (isRootLoaded) {
+      Buffer buf;
+      buf << nextPageID << nextSegmentID << root;
+      const std::string raw = buf.to_raw_string();
+      if (loadedRoot ? raw != *loadedRoot : nextPageID != 0)
+        storage.put(baseKey + "d", raw);
+    }
+
+    for (auto& [segmentID, segment] : segments) {
+      if (!segment.isChanged)
+        continue;
+      if (segment.entries.empty()) {
+        if (segment.loaded)
+          storage.del(segmentKey(segmentID));
+        continue;
+      }
+      std::string raw = Buffer::serialize(segment.entries);
+      if (segment.loaded != raw)
+        storage.put(segmentKey(segmentID), raw);
+    }
+
+    for (auto& [pageID, page] : pages) {
+      if (!page.isChanged)
+        continue;
+      if (page.keys.empty()) {
+        if (page.loaded)
+          storage.del(pageKey(pageID));
+        continue;
+      }
+      std::string raw = Buffer::serialize(page.keys);
+      if (page.loaded != raw)
+        storage.put(pageKey(pageID), raw);
+    }
+
+    for (auto& [rawKey, entry] : values) {
+      if (!entry.isChanged)
+        continue;
+      if (!entry.value) {
+        if (entry.loaded)
+          storage.del(baseKey + "v/" + rawKey);
+        continue;
+      }
+      std::string raw = Buffer::serialize(*entry.value);
+      if (entry.loaded != raw)
+        storage.put(baseKey + "v/" + rawKey, raw);
+    }
+  }
+
+  /// Return the value mapped to the key, or nullopt if there is none. Only
+  /// reads the value itself.
+  nonstd::optional<V> get(const K& key) const
+  {
+    return getEntry(key).value;
+  }
+
+  /// Return whether the key is in the map.
+  bool contains(const K& key) const
+  {
+    return get(key).has_value();
+  }
+
+  /// Map the key to the value. Adding a key also updates the key pages, while
+  /// updating the value of an existing key only touches the value.
+  void set(const K& key, const V& val)
+  {
+    Entry& entry = getEntry(key);
+    if (!entry.value) {
+      insertKey(key);
+      loadSize();
+      ++mapSize;
+    }
+    entry.value = val;
+    entry.isChanged = true;
+  }
+
+  /// Remove the key from the map. Return false if the key was not there.
+  bool erase(const K& key)
+  {
+    Entry& entry = getEntry(key);
+    if (!entry.value)
+      return false;
+
+    eraseKey(key);
+    loadSize();
+    --mapSize;
+    entry.value = nonstd::nullopt;
+    entry.isChanged = true;
+    return true;
+  }
+
+  /// Return the number of keys in the map.
+  uint64_t size() const
+  {
+    loadSize();
+    return mapSize;
+  }
+
+  /// Return a cursor at the smallest key.
+  Iterator begin() const
+  {
+    loadRoot();
+    return Iterator(*this, 0, 0, 0);
+  }
+
+  /// Return a cursor past the largest key.
+  Iterator end() const
+  {
+    loadRoot();
+    return Iterator(*this, root.size(), 0, 0);
+  }
+
+  /// Return a cursor at the smallest key not less than the given key.
+  Iterator lowerBound(const K& key) const
+  {
+    loadRoot();
+    if (root.empty())
+      return end();
+
+    const size_t segmentIdx = locate(root, key);
+    const auto& entries = getSegment(root[segmentIdx].second).entries;
+    const size_t pageIdx = locate(entries, key);
+    const auto& keys = getPage(entries[pageIdx].second).keys;
+    const size_t offset =
+        std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+    if (offset < keys.size())
+      return Iterator(*this, segmentIdx, pageIdx, offset);
+
+    // All keys of the page are smaller. Start from the next page.
+    Iterator it(*this, segmentIdx, pageIdx, keys.size() - 1);
+    return ++it;
+  }
+
+private:
+  struct Entry {
+    nonstd::optional<V> value;
+    nonstd::optional<std::string> loaded;
+    bool isChanged = false;
+  };
+
+  struct Page {
+    std::vector<K> keys;
+    nonstd::optional<std::string> loaded;
+    bool isChanged = false;
+  };
+
+  struct Segment {
+    Index entries;
+    nonstd::optional<std::string> loaded;
+    bool isChanged = false;
+  };
+
+  std::string pageKey(uint64_t pageID) const
+  {
+    return baseKey + "p/" + std::to_string(pageID);
+  }
+
+  std::string segmentKey(uint64_t segmentID) const
+  {
+    return baseKey + "s/" + std::to_string(segmentID);
+  }
+
+  const Entry& getEntry(const K& key) const
+  {
+    std::string rawKey = Buffer::serialize(key);
+    if (auto it = values.find(rawKey); it != values.end())
+      return it->second;
+
+    Entry entry;
+    entry.loaded = storage.get(baseKey + "v/" + rawKey);
+    if (entry.loaded)
+      entry.value = Buffer::deserialize<V>(*entry.loaded);
+    return values.emplace(std::move(rawKey), std::move(entry)).first->second;
+  }
+
+  Entry& getEntry(const K& key)
+  {
+    return const_cast<Entry&>(
+        static_cast<const IterableMap*>(this)->getEntry(key));
+  }
+
+  const Page& getPage(uint64_t pageID) const
+  {
+    if (auto it = pages.find(pageID); it != pages.end())
+      return it->second;
+
+    Page page;
+    page.loaded = storage.get(pageKey(pageID));
+    if (!page.loaded)
+      throw Failure("IterableMap: key page {} is missing", pageID);
+    page.keys = Buffer::deserialize<std::vector<K>>(*page.loaded);
+    return pages.emplace(pageID, std::move(page)).first->second;
+  }
+
+  Page& getPage(uint64_t pageID)
+  {
+    return const_cast<Page&>(
+        static_cast<const IterableMap*>(this)->getPage(pageID));
+  }
+
+  const Segment& getSegment(uint64_t segmentID) const
+  {
+    if (auto it = segments.find(segmentID); it != segments.end())
+      return it->second;
+
+    Segment segment;
+    segment.loaded = storage.get(segmentKey(segmentID));
+    if (!segment.loaded)
+      throw Failure("IterableMap: directory segment {} is missing", segmentID);
+    segment.entries = Buffer::deserialize<Index>(*segment.loaded);
+    return segments.emplace(segmentID, std::move(segment)).first->second;
+  }
+
+  Segment& getSegment(uint64_t segmentID)
+  {
+    return const_cast<Segment&>(
+        static_cast<const IterableMap*>(this)->getSegment(segmentID));
+  }
+
+  void loadSize() const
+  {
+    if (isSizeLoaded)
+      return;
+
+    if (auto raw = storage.get(baseKey + "n"); raw)
+      loadedSize = Buffer::deserialize<uint64_t>(*raw);
+    mapSize = loadedSize;
+    isSizeLoaded = true;
+  }
+
+  void loadRoot() const
+  {
+    if (isRootLoaded)
+      return;
+
+    loadedRoot = storage.get(baseKey + "d");
+    if (loadedRoot) {
+      Buffer buf = Buffer::view(gsl::as_bytes(gsl::make_span(*loadedRoot)));
+      buf >> nextPageID >> nextSegmentID >> root;
+    }
+    isRootLoaded = true;
+  }
+
+  /// Return the position in the index of the page or the segment that holds
+  /// the key if it is in the map. The index must not be empty.
+  static size_t locate(const Index& index, const K& key)
+  {
+    auto it = std::upper_bound(
+        index.begin(), index.end(), key,
+        [](const K& lhs, const auto& rhs) { return lhs < rhs.first; });
+    return it == index.begin() ? 0 : it - index.begin() - 1;
+  }
+
+  /// Add the key, which must not be in the map, to its page. Split the page
+  /// in two if it grows beyond PageCapacity, and likewise its segment.
+  void insertKey(const K& key)
+  {
+    loadRoot();
+    if (root.empty()) {
+      const uint64_t pageID = nextPageID++;
+      const uint64_t segmentID = nextSegmentID++;
+      pages[pageID] = Page{{key}, nonstd::nullopt, true};
+      segments[segmentID] = Segment{{{key, pageID}}, nonstd::nullopt, true};
+      root.emplace_back(key, segmentID);
+      return;
+    }
+
+    const size_t segmentIdx = locate(root, key);
+    Segment& segment = getSegment(root[segmentIdx].second);
+    const size_t pageIdx = locate(segment.entries, key);
+    Page& page = getPage(segment.entries[pageIdx].second);
+    page.keys.insert(std::lower_bound(page.keys.begin(), page.keys.end(), key),
+                     key);
+    page.isChanged = true;
+    if (key < segment.entries[pageIdx].first) {
+      segment.entries[pageIdx].first = key;
+      segment.isChanged = true;
+    }
+    if (key < root[segmentIdx].first)
+      root[segmentIdx].first = key;
+
+    if (page.keys.size() > PageCapacity) {
+      const size_t half = page.keys.size() / 2;
+      const uint64_t pageID = nextPageID++;
+      Page right{{page.keys.begin() + half, page.keys.end()},
+                 nonstd::nullopt,
+                 true};
+      page.keys.erase(page.keys.begin() + half, page.keys.end());
+      segment.entries.emplace(segment.entries.begin() + pageIdx + 1,
+                              right.keys.front(), pageID);
+      segment.isChanged = true;
+      pages[pageID] = std::move(right);
+    }
+
+    if (segment.entries.size() > PageCapacity) {
+      const size_t half = segment.entries.size() / 2;
+      const uint64_t segmentID = nextSegmentID++;
+      Segment right{{segment.entries.begin() + half, segment.entries.end()},
+                    nonstd::nullopt,
+                    true};
+      segment.entries.erase(segment.entries.begin() + half,
+                            segment.entries.end());
+      root.emplace(root.begin() + segmentIdx + 1, right.entries.front().first,
+                   segmentID);
+      segments[segmentID] = std::move(right);
+    }
+  }
+
+  /// Remove the key, which must be in the map, from its page. Drop the page
+  /// once it becomes empty, and likewise its segment.
+  void eraseKey(const K& key)
+  {
+    loadRoot();
+    const size_t segmentIdx = locate(root, key);
+    Segment& segment = getSegment(root[segmentIdx].second);
+    const size_t pageIdx = locate(segment.entries, key);
+    Page& page = getPage(segment.entries[pageIdx].second);
+    auto it = std::lower_bound(page.keys.begin(), page.keys.end(), key);
+    if (it == page.keys.end() || key < *it)
+      throw Failure("IterableMap: key is missing from its page");
+
+    page.keys.erase(it);
+    page.isChanged = true;
+    if (page.keys.empty()) {
+      segment.entries.erase(segment.entries.begin() + pageIdx);
+      segment.isChanged = true;
+    } else if (segment.entries[pageIdx].first < page.keys.front()) {
+      segment.entries[pageIdx].first = page.keys.front();
+      segment.isChanged = true;
+    }
+
+    if (segment.entries.empty())
+      root.erase(root.begin() + segmentIdx);
+    else
+      root[segmentIdx].first = segment.entries.front().first;
+  }
+
+private:
+  /// Reference to the storage layer.
+  Storage& storage;
+
+  /// The key under which this map keeps its data.
+  const FieldKey baseKey;
+
+  /// The number of keys, and the number stored. Only valid once isSizeLoaded
+  /// is true.
+  mutable uint64_t mapSize = 0;
+  mutable uint64_t loadedSize = 0;
+  mutable bool isSizeLoaded = false;
+
+  /// The first key and the ID of every directory segment in order, and the IDs
+  /// of the next page and the next segment to create. Only valid once
+  /// isRootLoaded is true.
+  mutable Index root;
+  mutable uint64_t nextPageID = 0;
+  mutable uint64_t nextSegmentID = 0;
+  mutable nonstd::optional<std::string> loadedRoot;
+  mutable bool isRootLoaded = false;
+
+  /// The directory segments, the key pages and the values that have been
+  /// accessed.
+  mutable std::unordered_map<uint64_t, Segment> segments;
+  mutable std::unordered_map<uint64_t, Page> pages;
+  mutable std::unordered_map<std::string, Entry> values;
+};
@@ -21,9 +21,10 @@
 #include <unordered_map>
 
 #include "inc/essential.h"
+#include "store/field_key.h"
 
 /// Shorthand marcro to define data mapping field inside of contract.
-#define DATAMAP(VAL, NAME) DataMap<VAL> NAME{storage, key + "/" + #NAME + "/"};
+#define DATAMAP(VAL, NAME) DataMap<VAL> NAME{storage, key, "/" #NAME "/"};
 
 /// DataMap is a wrapper over a key-value like lookup interface. It does not
 /// maintain any data on its own, but rather facilitate key-generation for the
@@ -39,6 +40,14 @@ public:
   {
   }
 
+  /// Create this data wrapper for the field of the contract at parentKey. The
+  /// key is only built when the first mapping is accessed.
+  DataMap(Storage& _storage, const std::string& parentKey, const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
+  }
+
   /// Copy and move don't make much sense here and can lead to weird bugs.
   /// Better to just disable them both.
   DataMap(const DataMap& dataMap) = delete;
@@ -74,7 +83,7 @@ private:
   Storage& storage;
 
   /// The key to which this wrapper use to access data.
-  const std::string baseKey;
+  const FieldKey baseKey;
 
   /// The map to keep track of 'active' data values. Storing it in the map means
   /// their destructors won't get called until this DataMap is destructed.
@@ -0,0 +1,50 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "store/node_interner.h"
+
+#include <limits>
+
+NodeInterner::ID NodeInterner::intern(const NodeID& node)
+{
+  auto it = ids.find(node);
+  if (it != ids.end())
+    return it->second;
+
+  if (nodes.size() > std::numeric_limits<ID>::max())
+    throw Failure("NodeInterner: out of node IDs");
+
+  const ID id = ID(nodes.size());
+  ids.emplace(node, id);
+  nodes.push_back(node);
+  return id;
+}
+
+nonstd::optional<NodeInterner::ID> NodeInterner::find(const NodeID& node) const
+{
+  auto it = ids.find(node);
+  if (it == ids.end())
+    return nonstd::nullopt;
+  return it->second;
+}
+
+const NodeID& NodeInterner::get(ID id) const
+{
+  if (id >= nodes.size())
+    throw Error("NodeInterner: unknown node ID {}", id);
+  return nodes[id];
+}
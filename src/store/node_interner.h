@@ -0,0 +1,55 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <nonstd/optional.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+#include "util/string.h"
+
+/// NodeInterner maps every NodeID seen by a graph store to a dense 32-bit ID.
+/// Subjects and predicates repeat heavily across edges, so stores keep edges
+/// as quads of IDs and only go back to the names when they have to leave the
+/// process. IDs are handed out in first-seen order and are never reused.
+class NodeInterner
+{
+public:
+  using ID = uint32_t;
+
+  /// Return the ID of the given node, assigning the next free one if the node
+  /// has not been seen before.
+  ID intern(const NodeID& node);
+
+  /// Return the ID of the given node if it has been interned.
+  nonstd::optional<ID> find(const NodeID& node) const;
+
+  /// Return the node that was assigned the given ID.
+  const NodeID& get(ID id) const;
+
+  /// Return the number of distinct nodes interned so far.
+  size_t size() const
+  {
+    return nodes.size();
+  }
+
+private:
+  std::unordered_map<NodeID, ID> ids;
+  std::vector<NodeID> nodes;
+};
@@ -0,0 +1,221 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <nonstd/optional.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/field_key.h"
+#include "store/storage.h"
+#include "util/buffer.h"
+
+#define PAGED_ARRAY(VAL, NAME)                                                 \
+  PagedArray<VAL> NAME{storage, key, "/" #NAME "/"};
+
+/// PagedArray is an unbounded array of T indexed by dense 32-bit numbers. The
+/// elements are grouped into fixed-size pages, each stored as one key-value
+/// entry, so neighbouring elements are loaded and written together and a
+/// whole-array scan reads the pages sequentially. Elements never written read
+/// as T{}.
+template <typename T, uint32_t PageSize = 64>
+class PagedArray : private FlushHook
+{
+public:
+  PagedArray(Storage& _storage, const std::string& _key)
+      : storage(_storage)
+      , baseKey(_key)
+  {
+  }
+
+  /// Create this array for the field of the contract at parentKey.
+  PagedArray(Storage& _storage,
+             const std::string& parentKey,
+             const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
+  }
+
+  /// Copy and move don't make much sense here and can lead to weird bugs.
+  /// Better to just disable them both.
+  PagedArray(const PagedArray& pagedArray) = delete;
+  PagedArray(PagedArray&& pagedArray) = delete;
+
+  /// Write back the modified pages whose bytes differ from the ones loaded.
+  ~PagedArray()
+  {
+    if (isHooked)
+      storage.removeFlushHook(this);
+
+    if (!storage.shouldFlush())
+      return;
+
+    if (!deltas.empty()) {
+      // Only reached if the flush hook did not run.
+      try {
+        prepareFlush();
+      } catch (const std::exception& err) {
+        WARN(log, "Failed to fold deltas into {}: {}", baseKey.str(),
+             err.what());
+        return;
+      }
+    }
+
+    for (auto& [pageIdx, page] : cache) {
+      if (!page.isChanged)
+        continue;
+
+      std::string raw = encodePage(page.values);
+      if (page.loaded ? *page.loaded == raw : raw == emptyPage())
+        continue;
+
+      DEBUG(log, "PUT {}", pageKey(baseKey.str(), pageIdx));
+      storage.put(pageKey(baseKey.str(), pageIdx), raw);
+    }
+  }
+
+  /// Return the element at the given index.
+  T get(uint32_t idx) const
+  {
+    return getPage(idx / PageSize).values[idx % PageSize];
+  }
+
+  /// Set the element at the given index. Note that it does not actually make
+  /// the change into the store until the flush occurs.
+  void set(uint32_t idx, const T& value)
+  {
+    auto& page = getPage(idx / PageSize);
+    page.values[idx % PageSize] = value;
+    page.isChanged = true;
+  }
+
+  /// Add delta to the element at the given index. If the page has not been
+  /// loaded, the delta is recorded without reading the storage and is folded
+  /// into the page at the start of the flush, so hot elements such as the
+  /// balance of a popular recipient are free of read dependencies.
+  void add(uint32_t idx, const T& delta)
+  {
+    if (auto it = cache.find(idx / PageSize); it != cache.end()) {
+      it->second.values[idx % PageSize] += delta;
+      it->second.isChanged = true;
+      return;
+    }
+
+    deltas[idx] += delta;
+    if (!isHooked) {
+      storage.addFlushHook(this);
+      isHooked = true;
+    }
+  }
+
+  /// Return the storage key of the given page of the array at baseKey.
+  static std::string pageKey(const std::string& baseKey, uint32_t pageIdx)
+  {
+    return baseKey + std::to_string(pageIdx);
+  }
+
+  /// Return the stored representation of a page holding the given values.
+  static std::string encodePage(const std::vector<T>& values)
+  {
+    return Buffer::serialize(values);
+  }
+
+public:
+  static constexpr uint32_t ElementsPerPage = PageSize;
+
+private:
+  struct Page {
+    std::vector<T> values;
+    nonstd::optional<std::string> loaded;
+    bool isChanged = false;
+  };
+
+  /// Load every page with a pending delta, which folds the deltas in. Throw
+  /// if a sum overflows.
+  void prepareFlush() final
+  {
+    isHooked = false;
+    while (!deltas.empty())
+      getPage(deltas.begin()->first / PageSize);
+  }
+
+  /// Return the given page, loading it and folding its pending deltas if it
+  /// has not been accessed yet.
+  const Page& getPage(uint32_t pageIdx) const
+  {
+    if (auto it = cache.find(pageIdx); it != cache.end())
+      return it->second;
+
+    Page page;
+    page.loaded = storage.get(pageKey(baseKey.str(), pageIdx));
+    if (page.loaded) {
+      page.values = Buffer::deserialize<std::vector<T>>(*page.loaded);
+      if (page.values.size() != PageSize)
+        throw Failure("PagedArray: page {} has {} elements", pageIdx,
+                      page.values.size());
+    } else {
+      page.values.resize(PageSize, T{});
+    }
+
+    for (auto it = deltas.begin(); it != deltas.end();) {
+      if (it->first / PageSize != pageIdx) {
+        ++it;
+        continue;
+      }
+      page.values[it->first % PageSize] += it->second;
+      page.isChanged = true;
+      it = deltas.erase(it);
+    }
+    return cache.emplace(pageIdx, std::move(page)).first->second;
+  }
+
+  Page& getPage(uint32_t pageIdx)
+  {
+    return const_cast<Page&>(
+        static_cast<const PagedArray*>(this)->getPage(pageIdx));
+  }
+
+  static const std::string& emptyPage()
+  {
+    static const std::string raw = encodePage(std::vector<T>(PageSize, T{}));
+    return raw;
+  }
+
+private:
+  /// Reference to the storage layer.
+  Storage& storage;
+
+  /// The key to which this array use to access data. Each page lives at the
+  /// key followed by its index.
+  const FieldKey baseKey;
+
+  /// The pages that have been accessed since this was loaded.
+  mutable std::unordered_map<uint32_t, Page> cache;
+
+  /// The sums of the deltas added to the elements of pages not loaded yet,
+  /// indexed by element.
+  mutable std::unordered_map<uint32_t, T> deltas;
+
+  /// Whether this is registered to fold its deltas at the next flush.
+  bool isHooked = false;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("paged_array");
+};
@@ -17,15 +17,20 @@
 
 #pragma once
 
+#include <algorithm>
 #include <enum/enum.h>
+#include <iterator>
+#include <nonstd/optional.hpp>
+#include <vector>
 
 #include "inc/essential.h"
+#include "store/field_key.h"
 #include "store/storage.h"
 #include "util/buffer.h"
 #include "util/bytes.h"
 
 /// Shorthand macro to define Set field inside of contract.
-#define SET(VAL, NAME) Set<VAL> NAME{storage, key + "/" + #NAME + "/"};
+#define SET(VAL, NAME) Set<VAL> NAME{storage, key, "/" #NAME "/"};
 
 ENUM(SetCacheStatus, uint8_t, Unchanged, Changed, Erased)
 
@@ -141,35 +146,41 @@ public:
 
 public:
   /// Create this data structure based on the given key and the storage
-  /// reference. Get details of this graph using baseKey as key in storage.
+  /// reference. Details of this graph are loaded from baseKey in storage on
+  /// first use.
   Set(Storage& _storage, const std::string& _key)
       : storage(_storage)
       , baseKey(_key)
   {
+  }
 
-    auto result = storage.get(baseKey);
-    if (result) {
-      Buffer buf(gsl::as_bytes(gsl::make_span(*result)));
-      buf >> nonceNode >> nonceRoot >> setSize;
-    } else {
-      nonceNode = 0;
-      nonceRoot = 0;
-      setSize = 0;
-    }
+  /// Create this data structure for the field of the contract at parentKey.
+  Set(Storage& _storage, const std::string& parentKey, const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
   }
 
   /// Deconstructor response in save detail of tree and updated node on tree.
+  /// The header and the nodes are only written if their bytes differ from the
+  /// ones loaded from the storage.
   ~Set()
   {
-    if (storage.shouldFlush()) {
+    if (storage.shouldFlush() && isHeaderLoaded) {
       Buffer buf;
       buf << nonceNode << nonceRoot << setSize;
-      storage.put(baseKey, buf.to_raw_string());
+      const std::string header = buf.to_raw_string();
+      if (loadedHeader ? header != *loadedHeader : nonceNode != 0)
+        storage.put(baseKey.str(), header);
+      std::string raw;
       for (auto& [id, node] : cache) {
         if (node.status == SetCacheStatus::Changed) {
+          Buffer::serializeInto<Node>(node, raw);
+          if (auto it = loadedNodes.find(id);
+              it != loadedNodes.end() && it->second == raw)
+            continue;
           DEBUG(log, "PUT {} -> {}", baseKey + std::to_string(id), node.val);
-          storage.put(baseKey + std::to_string(id),
-                      Buffer::serialize<Node>(node));
+          storage.put(baseKey + std::to_string(id), raw);
         } else if (node.status == SetCacheStatus::Erased) {
           DEBUG(log, "DEL {}", baseKey + std::to_string(id));
           storage.del(baseKey + std::to_string(id));
@@ -181,6 +192,7 @@ public:
   /// Insert new element to tree. If it has existed, return false.
   bool insert(const T& val)
   {
+    loadHeader();
     uint64_t beforeInsertSize = setSize;
     nonceRoot = insertNode(nonceRoot, val);
     return beforeInsertSize != setSize;
@@ -189,15 +201,66 @@ public:
   /// Erase element on tree. If it doesn't exist, return false.
   bool erase(const T& val)
   {
+    loadHeader();
     uint64_t beforeInsertSize = setSize;
     nonceRoot = deleteNode(nonceRoot, val);
     return beforeInsertSize != setSize;
     return 0;
   }
 
+  /// Replace the content of this set with the given values, which must be
+  /// strictly increasing. The tree is built perfectly balanced in linear time
+  /// and each node is written once, instead of going through n insertions.
+  /// The nodes of the previous content are reused, and erased if left over.
+  template <typename Range>
+  void buildFromSorted(const Range& values)
+  {
+    loadHeader();
+    std::vector<T> sorted(std::begin(values), std::end(values));
+    for (size_t idx = 1; idx < sorted.size(); ++idx) {
+      if (!(sorted[idx - 1] < sorted[idx]))
+        throw Error("Set::buildFromSorted: values are not strictly increasing");
+    }
+
+    // Hand out the IDs of the current nodes first, then fresh ones.
+    std::vector<uint64_t> nodeIDs;
+    nodeIDs.reserve(sorted.size());
+    for (auto& [nodeID, val] : collect()) {
+      if (nodeIDs.size() < sorted.size())
+        nodeIDs.push_back(nodeID);
+      else
+        getNode(nodeID).status = SetCacheStatus::Erased;
+    }
+    while (nodeIDs.size() < sorted.size())
+      nodeIDs.push_back(++nonceNode);
+
+    nonceRoot = buildNode(sorted, nodeIDs, 0, sorted.size(), 0);
+    setSize = sorted.size();
+  }
+
+  /// Merge the given strictly increasing values into this set, then rebuild it
+  /// balanced as buildFromSorted does. Linear in the sizes of both.
+  template <typename Range>
+  void mergeFromSorted(const Range& values)
+  {
+    loadHeader();
+    std::vector<T> current;
+    current.reserve(setSize);
+    for (auto& [nodeID, val] : collect())
+      current.push_back(std::move(val));
+
+    std::vector<T> merged;
+    merged.reserve(current.size() + std::distance(std::begin(values),
+                                                  std::end(values)));
+    std::set_union(current.begin(), current.end(), std::begin(values),
+                   std::end(values), std::back_inserter(merged));
+    buildFromSorted(merged);
+  }
+
   /// Check val exist in tree. Return true if exist.
   bool contains(const T& val)
   {
+    loadHeader();
     uint64_t currentNonceNode = nonceRoot;
     while (true) {
       if (currentNonceNode == 0)
@@ -219,6 +282,7 @@ public:
   /// Get the max value on tree.
   T maxValue()
   {
+    loadHeader();
     if (setSize == 0)
       return T{};
     uint64_t currentNonceNode = nonceRoot;
@@ -234,6 +298,7 @@ public:
   /// Get size of tree.
   uint64_t size() const
   {
+    loadHeader();
     return setSize;
   }
 
@@ -241,6 +306,7 @@ public:
   /// id = 0
   Iterator find(const T& val)
   {
+    loadHeader();
     uint64_t currentNonceNode = nonceRoot;
     while (true) {
       if (currentNonceNode == 0)
@@ -262,6 +328,7 @@ public:
   /// Return iterator that points to first element.
   Iterator begin()
   {
+    loadHeader();
     uint64_t currentNonceNode = nonceRoot;
     while (true) {
       Node& currentNode = getNode(currentNonceNode);
@@ -276,6 +343,7 @@ public:
   // Return iterator that points to last element.
   Iterator last() const
   {
+    loadHeader();
     uint64_t currentNonceNode = nonceRoot;
     while (true) {
       const Node& currentNode = getNode(currentNonceNode);
@@ -290,6 +358,24 @@ public:
 private:
   struct Node;
 
+  /// Load the details of the tree from the storage if not done yet.
+  void loadHeader() const
+  {
+    if (isHeaderLoaded)
+      return;
+
+    loadedHeader = storage.get(baseKey.str());
+    if (loadedHeader) {
+      Buffer buf = Buffer::view(gsl::as_bytes(gsl::make_span(*loadedHeader)));
+      buf >> nonceNode >> nonceRoot >> setSize;
+    } else {
+      nonceNode = 0;
+      nonceRoot = 0;
+      setSize = 0;
+    }
+    isHeaderLoaded = true;
+  }
+
   /// Return reference of Node struct.
   const Node& getNode(uint64_t nodeID) const
   {
@@ -300,8 +386,10 @@ private:
     auto result = storage.get(baseKey + std::to_string(nodeID));
     if (!result)
       throw Error("Node not found.");
-    return cache.emplace(nodeID, Buffer::deserialize<Node>(*result))
-        .first->second;
+    auto& node = cache.emplace(nodeID, Buffer::deserialize<Node>(*result))
+                     .first->second;
+    loadedNodes.emplace(nodeID, std::move(*result));
+    return node;
   }
 
   Node& getNode(uint64_t nodeID)
@@ -309,6 +397,48 @@ private:
     return const_cast<Node&>(static_cast<const Set*>(this)->getNode(nodeID));
   }
 
+  /// Return the ID and the value of every node in order.
+  std::vector<std::pair<uint64_t, T>> collect() const
+  {
+    std::vector<std::pair<uint64_t, T>> result;
+    result.reserve(setSize);
+    std::vector<uint64_t> stack;
+    uint64_t currentNonce = nonceRoot;
+    while (currentNonce != 0 || !stack.empty()) {
+      while (currentNonce != 0) {
+        stack.push_back(currentNonce);
+        currentNonce = getNode(currentNonce).left;
+      }
+      const uint64_t nodeID = stack.back();
+      stack.pop_back();
+      const Node& node = getNode(nodeID);
+      result.emplace_back(nodeID, node.val);
+      currentNonce = node.right;
+    }
+    return result;
+  }
+
+  /// Build the balanced subtree holding sorted[begin, end) under the given
+  /// parent. The node of sorted[idx] gets nodeIDs[idx]. Return its root.
+  uint64_t buildNode(const std::vector<T>& sorted,
+                     const std::vector<uint64_t>& nodeIDs,
+                     size_t begin,
+                     size_t end,
+                     uint64_t parent)
+  {
+    if (begin == end)
+      return 0;
+
+    const size_t mid = begin + (end - begin) / 2;
+    const uint64_t nodeID = nodeIDs[mid];
+    const uint64_t left = buildNode(sorted, nodeIDs, begin, mid, nodeID);
+    const uint64_t right = buildNode(sorted, nodeIDs, mid + 1, end, nodeID);
+    const uint64_t height = std::max(getHeight(left), getHeight(right)) + 1;
+    cache.insert_or_assign(nodeID, Node{left, right, height, parent,
+                                        sorted[mid], SetCacheStatus::Changed});
+    return nodeID;
+  }
+
   /// Create new node save only value other attribute will be updated by other
   /// function.
   uint64_t newNode(const T& val)
@@ -588,17 +718,23 @@ private:
   Storage& storage;
 
   /// The key to which this set use to access data.
-  const std::string baseKey;
+  const FieldKey baseKey;
 
-  /// Detail about avl-tree
-  uint64_t nonceNode;
-  uint64_t nonceRoot;
-  uint64_t setSize;
+  /// Detail about avl-tree. Only valid once isHeaderLoaded is true.
+  mutable uint64_t nonceNode = 0;
+  mutable uint64_t nonceRoot = 0;
+  mutable uint64_t setSize = 0;
+  mutable bool isHeaderLoaded = false;
 
   /// The cache value containing changed/erased node in tree that need to
   /// save.
   mutable std::unordered_map<uint64_t, Node> cache;
 
+  /// The raw bytes of the header and of the nodes as loaded from the storage.
+  /// Used to skip writing back what did not actually change.
+  mutable nonstd::optional<std::string> loadedHeader;
+  mutable std::unordered_map<uint64_t, std::string> loadedNodes;
+
   /// Static logger for this class.
   static inline auto log = logger::get("set");
 };
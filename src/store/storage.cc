@@ -17,11 +17,16 @@
 
 #include "storage.h"
 
+#include <algorithm>
 #include <boost/scope_exit.hpp>
 
+#include "util/buffer.h"
+
 void Storage::reset()
 {
+  flushHooks.clear();
   cache.clear();
+  created.clear();
 }
 
 void Storage::flush()
@@ -32,12 +37,46 @@ void Storage::flush()
   }
   BOOST_SCOPE_EXIT_END
 
+  // The hooks may still fail the flush, so they run before anything is put.
+  // They stay registered until they all succeed.
+  for (auto* hook : flushHooks)
+    hook->prepareFlush();
+  flushHooks.clear();
+
   isFlushing = true;
+  for (const auto& key : created)
+    put(key, key);
+  created.clear();
   cache.clear();
-  commit();
 }
 
 bool Storage::shouldFlush() const
 {
   return isFlushing;
 }
+
+void Storage::addFlushHook(FlushHook* hook)
+{
+  flushHooks.push_back(hook);
+}
+
+void Storage::removeFlushHook(FlushHook* hook)
+{
+  flushHooks.erase(std::remove(flushHooks.begin(), flushHooks.end(), hook),
+                   flushHooks.end());
+}
+
+void Storage::bulkLoad(std::vector<std::pair<std::string, std::string>> entries)
+{
+  for (auto& [key, val] : entries)
+    put(key, val);
+}
+
+void Storage::add(const std::string& key, const uint256_t& delta)
+{
+  uint256_t value = 0;
+  if (auto raw = get(key); raw.has_value())
+    value = Buffer::deserialize<uint256_t>(*raw);
+
+  put(key, Buffer::serialize<uint256_t>(value + delta));
+}
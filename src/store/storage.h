@@ -19,10 +19,24 @@
 
 #include <nonstd/optional.hpp>
 #include <unordered_map>
+#include <vector>
 
 #include "inc/essential.h"
 #include "store/contract.h"
 
+/// FlushHook is implemented by fields that defer work until the flush and must
+/// do it while the flush can still fail. The hooks run at the start of flush,
+/// before any contract is written, so that a throwing hook fails the flush
+/// like any other error of the transaction.
+class FlushHook
+{
+public:
+  virtual ~FlushHook() {}
+
+  /// Finish the deferred work. May throw to abort the flush.
+  virtual void prepareFlush() = 0;
+};
+
 /// Storage is an interface for connecting to key-value undelying store. As of
 /// current, there are two implementations: one is backed by memory (C++
 /// std::unordered_map) and one is backed by RocksDB.
@@ -32,13 +46,21 @@ public:
   /// Clear all the pending cache, discarding all the changes.
   void reset();
 
-  /// Flush all the cached information into the storage. Call commit under the
-  /// hood, while ensuring that shouldFlush returns true during the process.
+  /// Flush all the cached information into the storage, while ensuring that
+  /// shouldFlush returns true during the process. The changes stay pending in
+  /// the current mode until commit is called.
   void flush();
 
   /// Return a boolean indicating whether the storage is currently flushing.
   bool shouldFlush() const;
 
+  /// Run the given hook at the start of the next flush. The hook must be
+  /// removed if it is destroyed before that.
+  void addFlushHook(FlushHook* hook);
+
+  /// Remove the given hook if it has not run yet.
+  void removeFlushHook(FlushHook* hook);
+
   /// Load the contract of type T and location key. Throw if key does not exists
   /// or if the contract there is not of type T.
   template <typename T, typename KEY>
@@ -52,6 +74,13 @@ public:
     throw Error("Storage::load: contract key {} does not exist", prefixedKey);
   }
 
+  /// Similar to load, but return nullptr if key does not exist.
+  template <typename T, typename KEY>
+  T* find(const KEY& key)
+  {
+    return getContract<T>(T::KeyPrefix + key.to_string());
+  }
+
   /// Create a new contract of type T at location key. Also initialize the
   /// contract by calling its init function with the provided arguments.
   template <typename T, typename KEY, typename... Args>
@@ -67,7 +96,7 @@ public:
     auto raw = uniq.get();
 
     cache[prefixedKey] = std::move(uniq);
-    put(prefixedKey, prefixedKey);
+    created.push_back(prefixedKey);
 
     raw->init(std::forward<Args>(args)...);
     return *raw;
@@ -83,7 +112,19 @@ public:
   /// Delete the given key from the storage. May throw if key does not exist.
   virtual void del(const std::string& key) = 0;
 
-  /// Issue commit command to the storage.
+  /// Add delta to the uint256_t value mapped to the key, treating a missing key
+  /// as zero. Backends with native merge support can record the delta without
+  /// reading the old value. By default, perform a read-modify-write.
+  virtual void add(const std::string& key, const uint256_t& delta);
+
+  /// Write a large batch of new key-value pairs at once, e.g. the initial
+  /// state at genesis. The entries are sorted by key. Backends may ingest them
+  /// faster than individual puts. By default, put them one by one.
+  virtual void
+  bulkLoad(std::vector<std::pair<std::string, std::string>> entries);
+
+  /// Issue commit command to the storage. Called once per block, so that the
+  /// changes of all its transactions become the committed state at once.
   virtual void commit() = 0;
 
   /// Switch to check mode. Changes in this mode are discarded at commit.
@@ -92,6 +133,32 @@ public:
   /// Switch to apply mode. Changes in this mode are REAL.
   virtual void switchToApply() = 0;
 
+  /// Hint that the given keys are likely to be read soon. Backends with a read
+  /// cache may load them ahead of time. By default, do nothing.
+  virtual void prefetch(const std::vector<std::string>& keys) {}
+
+  /// Return the committed value of the key if it is already in the read cache,
+  /// without reading the backend or the uncommitted changes. Unlike get, this
+  /// is safe to call from any thread. By default, nothing is cached.
+  virtual nonstd::optional<std::string> peek(const std::string& key) const
+  {
+    return nonstd::nullopt;
+  }
+
+  /// Return the value mapped to the key as of the last commit, ignoring the
+  /// uncommitted changes of both modes. Unlike get, this is safe to call while
+  /// another thread executes a block. By default, committed reads are not
+  /// supported and this throws.
+  virtual nonstd::optional<std::string>
+  getCommitted(const std::string& key) const
+  {
+    throw Failure("Storage::getCommitted: not supported by this storage");
+  }
+
+  /// Warm up the read cache before serving traffic, e.g. from the access
+  /// profile of the previous run. By default, do nothing.
+  virtual void warmup() {}
+
 private:
   template <typename T>
   T* getContract(const std::string& prefixedKey)
@@ -123,4 +190,11 @@ private:
   /// A map keeping all the pending contracts. The changes made in those
   /// contracts are put to the storage after the contracts are destructed.
   std::unordered_map<std::string, std::unique_ptr<Contract>> cache;
+
+  /// The keys of the contracts created since the last flush or reset. Their
+  /// markers are only put at flush, so that a reset leaves no trace of them.
+  std::vector<std::string> created;
+
+  /// The hooks to run at the start of the next flush.
+  std::vector<FlushHook*> flushHooks;
 };
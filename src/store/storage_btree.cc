@@ -0,0 +1,865 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "storage_btree.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+/// Node pages start with a header holding the node type at byte 0, the
+/// number of entries at byte 2 and, for branches, the first child at byte 8.
+/// The header is followed by the 16-bit offsets of the entries, sorted by
+/// key. A leaf entry holds the key length (16 bits), whether the value is in
+/// overflow pages (8 bits), the value length (32 bits), the key, and then
+/// either the value or its first overflow page. A branch entry holds the key
+/// length, the key and the child whose keys are not smaller than it. Numbers
+/// are stored in native byte order.
+constexpr size_t HeaderSize = 16;
+constexpr size_t LeafEntryHeaderSize = 7;
+constexpr size_t BranchEntryHeaderSize = 2;
+constexpr uint8_t LeafType = 1;
+constexpr uint8_t BranchType = 2;
+
+/// Meta pages are the first two pages of the file. Transaction txid writes
+/// page txid % 2.
+struct Meta {
+  uint64_t magic;
+  uint64_t txid;
+  uint64_t root;
+  uint64_t pageCount;
+  uint64_t checksum;
+};
+constexpr uint64_t Magic = 0x6572746254646e42; // "BndTbtre"
+
+template <typename T>
+T loadRaw(const char* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void storeRaw(char* data, const T& value)
+{
+  std::memcpy(data, &value, sizeof(T));
+}
+
+/// Return the FNV-1a hash of the meta page fields before the checksum.
+uint64_t checksum(const Meta& meta)
+{
+  uint64_t hash = 0xcbf29ce484222325;
+  const char* data = reinterpret_cast<const char*>(&meta);
+  for (size_t idx = 0; idx < offsetof(Meta, checksum); ++idx) {
+    hash ^= uint8_t(data[idx]);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+uint64_t overflowPages(uint64_t size)
+{
+  return (size + StorageBTree::PageSize - 1) / StorageBTree::PageSize;
+}
+
+bool isInline(uint64_t overflow, uint64_t size)
+{
+  return overflow == 0 && size <= StorageBTree::MaxInlineValueSize;
+}
+
+size_t leafEntrySize(const std::string& key, uint64_t overflow, uint64_t size)
+{
+  return 2 + LeafEntryHeaderSize + key.size() +
+         (isInline(overflow, size) ? size : sizeof(uint64_t));
+}
+
+size_t branchEntrySize(const std::string& key)
+{
+  return 2 + BranchEntryHeaderSize + key.size() + sizeof(uint64_t);
+}
+
+/// Return the entry at the given index of the node page.
+const char* entryAt(const char* data, size_t idx)
+{
+  return data + loadRaw<uint16_t>(data + HeaderSize + 2 * idx);
+}
+
+/// Return the key of the entry at the given index of the node page.
+std::string_view entryKey(const char* data, size_t idx, bool isLeaf)
+{
+  const char* entry = entryAt(data, idx);
+  const size_t keyOffset = isLeaf ? LeafEntryHeaderSize : BranchEntryHeaderSize;
+  return std::string_view(entry + keyOffset, loadRaw<uint16_t>(entry));
+}
+} // namespace
+
+StorageBTree::Snapshot::Snapshot(const StorageBTree& _tree,
+                                 uint64_t _txid,
+                                 uint64_t _root)
+    : tree(_tree)
+    , txid(_txid)
+    , root(_root)
+{
+}
+
+StorageBTree::Snapshot::~Snapshot()
+{
+  std::lock_guard<std::mutex> lock(tree.snapshotMutex);
+  if (--tree.snapshots[txid] == 0)
+    tree.snapshots.erase(txid);
+}
+
+nonstd::optional<std::string>
+StorageBTree::Snapshot::get(const std::string& key) const
+{
+  return tree.search(root, key);
+}
+
+StorageBTree::StorageBTree(const std::string& path, size_t _mapSize)
+    : mapSize(_mapSize)
+{
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    throw Failure("StorageBTree: cannot open {}: {}", path,
+                  std::strerror(errno));
+
+  try {
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+      throw Failure("StorageBTree: cannot stat {}: {}", path,
+                    std::strerror(errno));
+
+    if (st.st_size == 0) {
+      // A new file starts with an empty tree at transaction 0.
+      if (::ftruncate(fd, 2 * PageSize) != 0)
+        throw Failure("StorageBTree: cannot extend {}: {}", path,
+                      std::strerror(errno));
+      writeMeta(0, 0, 2);
+      if (::fdatasync(fd) != 0)
+        throw Failure("StorageBTree: cannot sync {}: {}", path,
+                      std::strerror(errno));
+      filePages = 2;
+    } else if (size_t(st.st_size) < 2 * PageSize) {
+      throw Failure("StorageBTree: {} is not a B+tree file", path);
+    } else {
+      filePages = overflowPages(st.st_size);
+    }
+
+    void* addr = ::mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+      throw Failure("StorageBTree: cannot map {}: {}", path,
+                    std::strerror(errno));
+    map = static_cast<const char*>(addr);
+
+    // Pick the latest intact meta page. The other one, if intact, still
+    // describes a complete tree whose pages must not be reused.
+    bool found = false;
+    std::vector<uint64_t> roots;
+    for (uint64_t slot = 0; slot < 2; ++slot) {
+      const Meta meta = loadRaw<Meta>(map + slot * PageSize);
+      if (meta.magic != Magic || meta.checksum != checksum(meta))
+        continue;
+
+      roots.push_back(meta.root);
+      pageCount = std::max(pageCount, meta.pageCount);
+      if (!found || meta.txid > committedTxid) {
+        committedTxid = meta.txid;
+        committedRoot = meta.root;
+        found = true;
+      }
+    }
+    if (!found)
+      throw Failure("StorageBTree: {} has no intact meta page", path);
+    if (pageCount > filePages || pageCount * PageSize > mapSize)
+      throw Failure("StorageBTree: {} uses {} pages but only {} are in the "
+                    "file",
+                    path, pageCount, filePages.load());
+
+    root.page = committedRoot;
+    rebuildFreeList(roots);
+  } catch (...) {
+    if (map != nullptr)
+      ::munmap(const_cast<char*>(map), mapSize);
+    ::close(fd);
+    throw;
+  }
+
+  INFO(log, "Opened {} at transaction {} with {} pages ({} free)", path,
+       committedTxid, pageCount, freeList.size());
+}
+
+StorageBTree::~StorageBTree()
+{
+  ::munmap(const_cast<char*>(map), mapSize);
+  ::close(fd);
+}
+
+nonstd::optional<std::string> StorageBTree::get(const std::string& key) const
+{
+  switch (mode) {
+    case Mode::Check:
+      if (auto it = checkWrites.find(key); it != checkWrites.end())
+        return it->second;
+      return search(committedRoot, key);
+    case Mode::Apply:
+      return search(root, key);
+    case Mode::None:
+      break;
+  }
+  throw Failure("<StorageBTree::get> called before switching mode");
+}
+
+void StorageBTree::put(const std::string& key, const std::string& val)
+{
+  checkSize(key, val.size());
+  switch (mode) {
+    case Mode::Check:
+      checkWrites.insert_or_assign(key, val);
+      return;
+    case Mode::Apply:
+      if (auto result = insert(root, key, Value{val, 0, val.size()}); result) {
+        auto node = std::make_unique<Node>();
+        node->isLeaf = false;
+        node->keys.push_back(std::move(result->first));
+        node->children.push_back(std::move(root));
+        node->children.push_back(std::move(result->second));
+        root = Child{0, std::move(node)};
+      }
+      return;
+    case Mode::None:
+      break;
+  }
+  throw Failure("<StorageBTree::put> called before switching mode");
+}
+
+void StorageBTree::del(const std::string& key)
+{
+  switch (mode) {
+    case Mode::Check:
+      checkWrites.insert_or_assign(key, nonstd::nullopt);
+      return;
+    case Mode::Apply:
+      // Avoid copying the path to a key that does not exist.
+      if (!search(root, key))
+        return;
+      if (erase(root, key)) {
+        root = Child{};
+        return;
+      }
+      // Collapse the branches left with a single child.
+      while (root.node && !root.node->isLeaf &&
+             root.node->children.size() == 1) {
+        Child only = std::move(root.node->children.front());
+        root = std::move(only);
+      }
+      return;
+    case Mode::None:
+      break;
+  }
+  throw Failure("<StorageBTree::del> called before switching mode");
+}
+
+void StorageBTree::bulkLoad(
+    std::vector<std::pair<std::string, std::string>> entries)
+{
+  if (mode != Mode::Apply)
+    throw Failure("<StorageBTree::bulkLoad> must be called in apply mode");
+
+  if (root.node || root.page != 0) {
+    Storage::bulkLoad(std::move(entries));
+    return;
+  }
+  if (entries.empty())
+    return;
+
+  // Pack the sorted entries into full leaves, each paired with its smallest
+  // key, then build every branch level over the one below.
+  std::vector<std::pair<std::string, Child>> level;
+  auto leaf = std::make_unique<Node>();
+  size_t size = HeaderSize;
+  for (auto& [key, val] : entries) {
+    checkSize(key, val.size());
+    const size_t entrySize = leafEntrySize(key, 0, val.size());
+    if (!leaf->keys.empty() && size + entrySize > PageSize) {
+      std::string firstKey = leaf->keys.front();
+      level.emplace_back(std::move(firstKey), Child{0, std::move(leaf)});
+      leaf = std::make_unique<Node>();
+      size = HeaderSize;
+    }
+    const uint64_t valSize = val.size();
+    leaf->keys.push_back(std::move(key));
+    leaf->values.push_back(Value{std::move(val), 0, valSize});
+    size += entrySize;
+  }
+  std::string firstKey = leaf->keys.front();
+  level.emplace_back(std::move(firstKey), Child{0, std::move(leaf)});
+
+  while (level.size() > 1) {
+    std::vector<std::pair<std::string, Child>> parents;
+    std::unique_ptr<Node> branch;
+    for (auto& [key, child] : level) {
+      const size_t entrySize = branchEntrySize(key);
+      if (branch && size + entrySize > PageSize) {
+        parents.emplace_back(std::move(firstKey),
+                             Child{0, std::move(branch)});
+      }
+      if (!branch) {
+        branch = std::make_unique<Node>();
+        branch->isLeaf = false;
+        branch->children.push_back(std::move(child));
+        firstKey = std::move(key);
+        size = HeaderSize;
+        continue;
+      }
+      branch->keys.push_back(std::move(key));
+      branch->children.push_back(std::move(child));
+      size += entrySize;
+    }
+    parents.emplace_back(std::move(firstKey), Child{0, std::move(branch)});
+    level = std::move(parents);
+  }
+  root = std::move(level.front().second);
+}
+
+void StorageBTree::commit()
+{
+  reclaim();
+
+  if (root.node || !released.empty()) {
+    write(root);
+    if (::fdatasync(fd) != 0)
+      throw Failure("StorageBTree: cannot sync the pages: {}",
+                    std::strerror(errno));
+
+    const uint64_t txid = committedTxid + 1;
+    writeMeta(txid, root.page, pageCount);
+    if (::fdatasync(fd) != 0)
+      throw Failure("StorageBTree: cannot sync the meta page: {}",
+                    std::strerror(errno));
+
+    {
+      std::lock_guard<std::mutex> lock(snapshotMutex);
+      committedTxid = txid;
+      committedRoot = root.page;
+    }
+    pendingFree.emplace_back(txid, std::move(released));
+    released.clear();
+  }
+
+  checkWrites.clear();
+  mode = Mode::None;
+}
+
+void StorageBTree::switchToCheck()
+{
+  mode = Mode::Check;
+}
+
+void StorageBTree::switchToApply()
+{
+  mode = Mode::Apply;
+}
+
+std::unique_ptr<StorageBTree::Snapshot> StorageBTree::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(snapshotMutex);
+  ++snapshots[committedTxid];
+  return std::unique_ptr<Snapshot>(
+      new Snapshot(*this, committedTxid, committedRoot));
+}
+
+nonstd::optional<std::string>
+StorageBTree::getCommitted(const std::string& key) const
+{
+  return snapshot()->get(key);
+}
+
+const char* StorageBTree::pageData(uint64_t page, uint64_t count) const
+{
+  const uint64_t pages = filePages.load(std::memory_order_acquire);
+  if (page >= pages || count > pages - page)
+    throw Failure("StorageBTree: page {} is out of the file", page);
+  return map + page * PageSize;
+}
+
+nonstd::optional<std::string> StorageBTree::search(uint64_t page,
+                                                   std::string_view key) const
+{
+  while (page != 0) {
+    const char* data = pageData(page);
+    const bool isLeaf = data[0] == LeafType;
+    const uint16_t count = loadRaw<uint16_t>(data + 2);
+
+    // Find the number of entries whose key is not greater than the key.
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+      const size_t mid = (lo + hi) / 2;
+      if (entryKey(data, mid, isLeaf) <= key)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    if (isLeaf) {
+      if (lo == 0 || entryKey(data, lo - 1, true) != key)
+        return nonstd::nullopt;
+      return readValue(entryAt(data, lo - 1));
+    }
+
+    if (lo == 0) {
+      page = loadRaw<uint64_t>(data + 8);
+    } else {
+      const char* entry = entryAt(data, lo - 1);
+      page = loadRaw<uint64_t>(entry + BranchEntryHeaderSize +
+                            loadRaw<uint16_t>(entry));
+    }
+  }
+  return nonstd::nullopt;
+}
+
+nonstd::optional<std::string> StorageBTree::search(const Child& child,
+                                                   std::string_view key) const
+{
+  const Child* current = &child;
+  while (current->node) {
+    const Node& node = *current->node;
+    if (node.isLeaf) {
+      auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+      if (it == node.keys.end() || *it != key)
+        return nonstd::nullopt;
+
+      const Value& value = node.values[it - node.keys.begin()];
+      if (value.overflow != 0)
+        return std::string(pageData(value.overflow, overflowPages(value.size)),
+                           value.size);
+      return value.data;
+    }
+    auto it = std::upper_bound(node.keys.begin(), node.keys.end(), key);
+    current = &node.children[it - node.keys.begin()];
+  }
+  return search(current->page, key);
+}
+
+std::string StorageBTree::readValue(const char* entry) const
+{
+  const uint16_t keySize = loadRaw<uint16_t>(entry);
+  const bool isOverflow = entry[2] != 0;
+  const uint32_t size = loadRaw<uint32_t>(entry + 3);
+  const char* value = entry + LeafEntryHeaderSize + keySize;
+  if (isOverflow)
+    return std::string(pageData(loadRaw<uint64_t>(value), overflowPages(size)),
+                       size);
+  return std::string(value, size);
+}
+
+StorageBTree::Node& StorageBTree::touch(Child& child)
+{
+  if (!child.node) {
+    if (child.page == 0) {
+      child.node = std::make_unique<Node>();
+    } else {
+      child.node = std::make_unique<Node>(decode(child.page));
+      released.push_back(child.page);
+      child.page = 0;
+    }
+  }
+  return *child.node;
+}
+
+StorageBTree::Node StorageBTree::decode(uint64_t page) const
+{
+  const char* data = pageData(page);
+  const uint16_t count = loadRaw<uint16_t>(data + 2);
+
+  Node node;
+  node.isLeaf = data[0] == LeafType;
+  node.keys.reserve(count);
+  if (node.isLeaf) {
+    node.values.reserve(count);
+  } else {
+    node.children.reserve(count + 1);
+    node.children.push_back(Child{loadRaw<uint64_t>(data + 8), nullptr});
+  }
+
+  for (size_t idx = 0; idx < count; ++idx) {
+    const char* entry = entryAt(data, idx);
+    const uint16_t keySize = loadRaw<uint16_t>(entry);
+    if (node.isLeaf) {
+      const char* key = entry + LeafEntryHeaderSize;
+      node.keys.emplace_back(key, keySize);
+      const char* payload = key + keySize;
+      const uint32_t size = loadRaw<uint32_t>(entry + 3);
+      if (entry[2] != 0)
+        node.values.push_back(Value{"", loadRaw<uint64_t>(payload), size});
+      else
+        node.values.push_back(Value{std::string(payload, size), 0, size});
+    } else {
+      const char* key = entry + BranchEntryHeaderSize;
+      node.keys.emplace_back(key, keySize);
+      node.children.push_back(Child{loadRaw<uint64_t>(key + keySize), nullptr});
+    }
+  }
+  return node;
+}
+
+StorageBTree::Split
+StorageBTree::insert(Child& child, const std::string& key, Value value)
+{
+  Node& node = touch(child);
+  if (node.isLeaf) {
+    auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+    const size_t idx = it - node.keys.begin();
+    if (it != node.keys.end() && *it == key) {
+      release(node.values[idx]);
+      node.values[idx] = std::move(value);
+    } else {
+      node.keys.insert(it, key);
+      node.values.insert(node.values.begin() + idx, std::move(value));
+    }
+  } else {
+    auto it = std::upper_bound(node.keys.begin(), node.keys.end(), key);
+    const size_t idx = it - node.keys.begin();
+    if (auto result = insert(node.children[idx], key, std::move(value));
+        result) {
+      node.keys.insert(node.keys.begin() + idx, std::move(result->first));
+      node.children.insert(node.children.begin() + idx + 1,
+                           std::move(result->second));
+    }
+  }
+
+  if (encodedSize(node) > PageSize)
+    return split(node);
+  return nonstd::nullopt;
+}
+
+bool StorageBTree::erase(Child& child, const std::string& key)
+{
+  Node& node = touch(child);
+  if (node.isLeaf) {
+    auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+    const size_t idx = it - node.keys.begin();
+    release(node.values[idx]);
+    node.keys.erase(it);
+    node.values.erase(node.values.begin() + idx);
+    return node.keys.empty();
+  }
+
+  auto it = std::upper_bound(node.keys.begin(), node.keys.end(), key);
+  const size_t idx = it - node.keys.begin();
+  if (erase(node.children[idx], key)) {
+    // The first child has no key of its own. If it goes, the key of the
+    // second child goes with it.
+    node.children.erase(node.children.begin() + idx);
+    if (!node.keys.empty())
+      node.keys.erase(node.keys.begin() + (idx == 0 ? 0 : idx - 1));
+  } else {
+    merge(node, idx);
+  }
+  return node.children.empty();
+}
+
+void StorageBTree::merge(Node& branch, size_t idx)
+{
+  if (branch.children.size() < 2 ||
+      encodedSize(branch.children[idx]) >= MinNodeSize)
+    return;
+
+  // Merge with the right sibling, or with the left one for the last child.
+  const size_t left = idx + 1 < branch.children.size() ? idx : idx - 1;
+  Child& lhsChild = branch.children[left];
+  Child& rhsChild = branch.children[left + 1];
+  const bool isLeaf = lhsChild.node ? lhsChild.node->isLeaf
+                                    : pageData(lhsChild.page)[0] == LeafType;
+  // In a branch, the separator moves down between the two halves.
+  const size_t separatorSize = isLeaf ? 0 : branchEntrySize(branch.keys[left]);
+  if (encodedSize(lhsChild) + encodedSize(rhsChild) - HeaderSize +
+          separatorSize >
+      PageSize)
+    return;
+
+  Node& lhs = touch(lhsChild);
+  Node& rhs = touch(rhsChild);
+  if (isLeaf) {
+    lhs.values.insert(lhs.values.end(),
+                      std::make_move_iterator(rhs.values.begin()),
+                      std::make_move_iterator(rhs.values.end()));
+  } else {
+    lhs.keys.push_back(std::move(branch.keys[left]));
+    lhs.children.insert(lhs.children.end(),
+                        std::make_move_iterator(rhs.children.begin()),
+                        std::make_move_iterator(rhs.children.end()));
+  }
+  lhs.keys.insert(lhs.keys.end(), std::make_move_iterator(rhs.keys.begin()),
+                  std::make_move_iterator(rhs.keys.end()));
+  branch.keys.erase(branch.keys.begin() + left);
+  branch.children.erase(branch.children.begin() + left + 1);
+}
+
+size_t StorageBTree::encodedSize(const Node& node)
+{
+  size_t size = HeaderSize;
+  for (size_t idx = 0; idx < node.keys.size(); ++idx)
+    size += node.isLeaf
+                ? leafEntrySize(node.keys[idx], node.values[idx].overflow,
+                                node.values[idx].size)
+                : branchEntrySize(node.keys[idx]);
+  return size;
+}
+
+size_t StorageBTree::encodedSize(const Child& child) const
+{
+  if (child.node)
+    return encodedSize(*child.node);
+  return encodedSize(decode(child.page));
+}
+
+StorageBTree::Split StorageBTree::split(Node& node)
+{
+  // Split at the entry that balances the encoded sizes of both halves.
+  const size_t count = node.keys.size();
+  std::vector<size_t> sizes(count);
+  size_t total = 0;
+  for (size_t idx = 0; idx < count; ++idx) {
+    sizes[idx] = node.isLeaf
+                     ? leafEntrySize(node.keys[idx], node.values[idx].overflow,
+                                     node.values[idx].size)
+                     : branchEntrySize(node.keys[idx]);
+    total += sizes[idx];
+  }
+  size_t mid = 1;
+  for (size_t acc = sizes[0]; mid < count - 1 && acc < total / 2; ++mid)
+    acc += sizes[mid];
+
+  auto right = std::make_unique<Node>();
+  right->isLeaf = node.isLeaf;
+  std::string separator;
+  if (node.isLeaf) {
+    right->keys.assign(std::make_move_iterator(node.keys.begin() + mid),
+                       std::make_move_iterator(node.keys.end()));
+    right->values.assign(std::make_move_iterator(node.values.begin() + mid),
+                         std::make_move_iterator(node.values.end()));
+    node.keys.resize(mid);
+    node.values.resize(mid);
+    separator = right->keys.front();
+  } else {
+    // The middle key moves up to the parent.
+    separator = std::move(node.keys[mid]);
+    right->keys.assign(std::make_move_iterator(node.keys.begin() + mid + 1),
+                       std::make_move_iterator(node.keys.end()));
+    right->children.assign(
+        std::make_move_iterator(node.children.begin() + mid + 1),
+        std::make_move_iterator(node.children.end()));
+    node.keys.resize(mid);
+    node.children.resize(mid + 1);
+  }
+  return std::make_pair(std::move(separator), Child{0, std::move(right)});
+}
+
+void StorageBTree::release(const Value& value)
+{
+  if (value.overflow == 0)
+    return;
+  for (uint64_t idx = 0; idx < overflowPages(value.size); ++idx)
+    released.push_back(value.overflow + idx);
+}
+
+void StorageBTree::write(Child& child)
+{
+  if (!child.node)
+    return;
+
+  Node& node = *child.node;
+  std::string page(PageSize, '\0');
+  char* data = page.data();
+  data[0] = node.isLeaf ? LeafType : BranchType;
+  storeRaw<uint16_t>(data + 2, node.keys.size());
+
+  size_t offset = HeaderSize + 2 * node.keys.size();
+  if (node.isLeaf) {
+    for (size_t idx = 0; idx < node.keys.size(); ++idx) {
+      const std::string& key = node.keys[idx];
+      Value& value = node.values[idx];
+      if (!isInline(value.overflow, value.size)) {
+        if (value.overflow == 0) {
+          value.overflow = allocate(overflowPages(value.size));
+          writePages(value.overflow, value.data.data(), value.data.size());
+        }
+      }
+
+      char* entry = data + offset;
+      storeRaw<uint16_t>(data + HeaderSize + 2 * idx, offset);
+      storeRaw<uint16_t>(entry, key.size());
+      entry[2] = value.overflow != 0;
+      storeRaw<uint32_t>(entry + 3, value.size);
+      std::memcpy(entry + LeafEntryHeaderSize, key.data(), key.size());
+      char* payload = entry + LeafEntryHeaderSize + key.size();
+      if (value.overflow != 0)
+        storeRaw<uint64_t>(payload, value.overflow);
+      else
+        std::memcpy(payload, value.data.data(), value.size);
+      offset += leafEntrySize(key, value.overflow, value.size) - 2;
+    }
+  } else {
+    for (auto& grandchild : node.children)
+      write(grandchild);
+
+    storeRaw<uint64_t>(data + 8, node.children.front().page);
+    for (size_t idx = 0; idx < node.keys.size(); ++idx) {
+      const std::string& key = node.keys[idx];
+      char* entry = data + offset;
+      storeRaw<uint16_t>(data + HeaderSize + 2 * idx, offset);
+      storeRaw<uint16_t>(entry, key.size());
+      std::memcpy(entry + BranchEntryHeaderSize, key.data(), key.size());
+      storeRaw<uint64_t>(entry + BranchEntryHeaderSize + key.size(),
+                      node.children[idx + 1].page);
+      offset += branchEntrySize(key) - 2;
+    }
+  }
+
+  child.page = allocate(1);
+  writePages(child.page, data, PageSize);
+  child.node.reset();
+}
+
+uint64_t StorageBTree::allocate(uint64_t count)
+{
+  if (count == 1 && !freeList.empty()) {
+    const uint64_t page = freeList.back();
+    freeList.pop_back();
+    return page;
+  }
+
+  if ((pageCount + count) * PageSize > mapSize)
+    throw Failure("StorageBTree: the file outgrows its map of {} bytes",
+                  mapSize);
+  const uint64_t page = pageCount;
+  pageCount += count;
+  return page;
+}
+
+void StorageBTree::writePages(uint64_t page, const char* data, size_t size)
+{
+  off_t offset = page * PageSize;
+  while (size > 0) {
+    const ssize_t written = ::pwrite(fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw Failure("StorageBTree: cannot write page {}: {}", page,
+                    std::strerror(errno));
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+
+  // Only commit writes pages, so there is no concurrent update to race with.
+  const uint64_t end = overflowPages(offset);
+  if (end > filePages.load(std::memory_order_relaxed))
+    filePages.store(end, std::memory_order_release);
+}
+
+void StorageBTree::writeMeta(uint64_t txid,
+                             uint64_t rootPage,
+                             uint64_t pages)
+{
+  Meta meta{Magic, txid, rootPage, pages, 0};
+  meta.checksum = checksum(meta);
+  writePages(txid % 2, reinterpret_cast<const char*>(&meta), sizeof(Meta));
+}
+
+void StorageBTree::reclaim()
+{
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    if (!snapshots.empty())
+      oldest = snapshots.begin()->first;
+  }
+
+  // Pages released by transaction T belong to the tree of T - 1. The meta
+  // page of T - 1 is overwritten by T + 1, so the pages are only safe to
+  // write from T + 2 on, and only once no snapshot older than T is alive.
+  const uint64_t txid = committedTxid + 1;
+  auto it = pendingFree.begin();
+  while (it != pendingFree.end() && it->first + 2 <= txid &&
+         it->first <= oldest) {
+    freeList.insert(freeList.end(), it->second.begin(), it->second.end());
+    ++it;
+  }
+  pendingFree.erase(pendingFree.begin(), it);
+}
+
+void StorageBTree::rebuildFreeList(const std::vector<uint64_t>& roots)
+{
+  std::vector<bool> used(pageCount, false);
+  used[0] = used[1] = true;
+
+  auto markRange = [&](uint64_t page, uint64_t count) {
+    if (page + count > pageCount)
+      throw Failure("StorageBTree: page {} is out of the file", page);
+    std::fill(used.begin() + page, used.begin() + page + count, true);
+  };
+
+  std::function<void(uint64_t)> mark = [&](uint64_t page) {
+    if (page == 0 || (page < pageCount && used[page]))
+      return;
+    markRange(page, 1);
+
+    const char* data = pageData(page);
+    const bool isLeaf = data[0] == LeafType;
+    const uint16_t count = loadRaw<uint16_t>(data + 2);
+    if (!isLeaf)
+      mark(loadRaw<uint64_t>(data + 8));
+    for (size_t idx = 0; idx < count; ++idx) {
+      const char* entry = entryAt(data, idx);
+      const uint16_t keySize = loadRaw<uint16_t>(entry);
+      if (!isLeaf) {
+        mark(loadRaw<uint64_t>(entry + BranchEntryHeaderSize + keySize));
+      } else if (entry[2] != 0) {
+        const uint64_t overflow =
+            loadRaw<uint64_t>(entry + LeafEntryHeaderSize + keySize);
+        markRange(overflow, overflowPages(loadRaw<uint32_t>(entry + 3)));
+      }
+    }
+  };
+  for (uint64_t treeRoot : roots)
+    mark(treeRoot);
+
+  for (uint64_t page = 2; page < pageCount; ++page)
+    if (!used[page])
+      freeList.push_back(page);
+}
+
+void StorageBTree::checkSize(const std::string& key, size_t valueSize)
+{
+  if (key.size() > MaxKeySize)
+    throw Error("StorageBTree: key of {} bytes exceeds the limit of {}",
+                key.size(), MaxKeySize);
+  if (valueSize > std::numeric_limits<uint32_t>::max())
+    throw Error("StorageBTree: value of {} bytes is too large", valueSize);
+}
@@ -0,0 +1,263 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nonstd/optional.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "store/storage.h"
+
+/// StorageBTree is a persistent storage kept in a single file that holds a
+/// copy-on-write B+tree. Every node takes one page of the file, which is
+/// mapped into memory so that lookups read the pages in place.
+///
+/// A node modified in apply mode is copied to memory and written to a fresh
+/// page at commit. Pages reachable from a committed root are never written
+/// again while that root may still be read, so commit only needs to write
+/// the new pages and then one of the two meta pages, alternately. A crash at
+/// any point leaves the last intact meta page, and thus the last fully
+/// committed tree. The free pages are not stored. They are found again by
+/// walking the trees of both meta pages when the file is opened.
+///
+/// A node left small by deletes is merged into a sibling when both fit in one
+/// page, so that a delete-heavy workload does not leave the tree sparse.
+///
+/// Check mode keeps its changes in memory on top of the last committed tree.
+/// Snapshots read a committed tree from any thread without taking a lock.
+class StorageBTree : public Storage
+{
+public:
+  /// A read-only view of the state committed when the snapshot was taken. The
+  /// pages of that state are not reused until the snapshot is destroyed.
+  class Snapshot
+  {
+  public:
+    ~Snapshot();
+
+    Snapshot(const Snapshot& snapshot) = delete;
+    Snapshot& operator=(const Snapshot& snapshot) = delete;
+
+    /// Return the value mapped to the key at the time of the snapshot.
+    nonstd::optional<std::string> get(const std::string& key) const;
+
+  private:
+    friend class StorageBTree;
+    Snapshot(const StorageBTree& tree, uint64_t txid, uint64_t root);
+
+    const StorageBTree& tree;
+    const uint64_t txid;
+    const uint64_t root;
+  };
+
+  /// Open the B+tree file at the given path, creating it if it does not exist.
+  /// The file may grow up to mapSize bytes.
+  StorageBTree(const std::string& path, size_t mapSize = DefaultMapSize);
+
+  /// Close the file. Changes that are not committed are discarded.
+  ~StorageBTree();
+
+  StorageBTree(const StorageBTree& tree) = delete;
+  StorageBTree& operator=(const StorageBTree& tree) = delete;
+
+  nonstd::optional<std::string> get(const std::string& key) const final;
+  void put(const std::string& key, const std::string& val) final;
+  void del(const std::string& key) final;
+
+  /// Build the tree bottom up if it is empty. Otherwise, put the entries one
+  /// by one. Only valid in apply mode.
+  void bulkLoad(std::vector<std::pair<std::string, std::string>> entries) final;
+
+  /// Write the apply-mode changes to new pages and switch the meta page to the
+  /// new root. Durable once this returns. Check-mode changes are discarded.
+  void commit() final;
+  void switchToCheck() final;
+  void switchToApply() final;
+
+  /// Take a snapshot of the last committed state. Safe to call from any
+  /// thread.
+  std::unique_ptr<Snapshot> snapshot() const;
+
+  /// Read the key from a snapshot of the last committed state.
+  nonstd::optional<std::string>
+  getCommitted(const std::string& key) const final;
+
+public:
+  /// The size of a page, and thus of a node, in bytes.
+  static constexpr size_t PageSize = 4096;
+
+  /// A node encoded in fewer bytes after a delete is merged into a sibling,
+  /// as long as both fit in one page.
+  static constexpr size_t MinNodeSize = PageSize / 4;
+
+  /// Longer keys are rejected. Longer values are kept in separate pages.
+  static constexpr size_t MaxKeySize = 512;
+  static constexpr size_t MaxInlineValueSize = 512;
+
+  /// The default size of the address space reserved for the file.
+  static constexpr size_t DefaultMapSize = size_t(1) << 36;
+
+private:
+  struct Node;
+
+  /// Reference to a child node, either unmodified in a page of the file or
+  /// modified in memory since the last commit. Page 0 means none.
+  struct Child {
+    uint64_t page = 0;
+    std::unique_ptr<Node> node;
+  };
+
+  /// A leaf value. Values longer than MaxInlineValueSize are written to a run
+  /// of overflow pages at commit. An overflow page of 0 means data holds the
+  /// value.
+  struct Value {
+    std::string data;
+    uint64_t overflow = 0;
+    uint64_t size = 0;
+  };
+
+  /// A node copied to memory to be modified. Branches have one more child
+  /// than keys, and keys[idx] is the smallest key under children[idx + 1].
+  struct Node {
+    bool isLeaf = true;
+    std::vector<std::string> keys;
+    std::vector<Value> values;
+    std::vector<Child> children;
+  };
+
+  /// The result of splitting an oversized node: the separator key and the new
+  /// right sibling.
+  using Split = nonstd::optional<std::pair<std::string, Child>>;
+
+  enum class Mode { None, Check, Apply };
+
+  /// Return the address of the given page in the mapping. Throw unless the
+  /// page and the count - 1 pages after it are all in the file.
+  const char* pageData(uint64_t page, uint64_t count = 1) const;
+
+  /// Look the key up in the tree under the given page or child.
+  nonstd::optional<std::string> search(uint64_t page,
+                                       std::string_view key) const;
+  nonstd::optional<std::string> search(const Child& child,
+                                       std::string_view key) const;
+
+  /// Return the value stored in the given leaf page entry.
+  std::string readValue(const char* entry) const;
+
+  /// Copy the node of the child to memory if it is not already, releasing its
+  /// page. Return the node.
+  Node& touch(Child& child);
+
+  /// Decode the node in the given page.
+  Node decode(uint64_t page) const;
+
+  /// Insert or replace the key under the child. Return the split if the node
+  /// of the child grew beyond a page.
+  Split insert(Child& child, const std::string& key, Value value);
+
+  /// Erase the key under the child, which must exist. Return true if the node
+  /// of the child became empty.
+  bool erase(Child& child, const std::string& key);
+
+  /// Merge the child at the given index of the branch into a sibling if it is
+  /// smaller than MinNodeSize and both fit in one page.
+  void merge(Node& branch, size_t idx);
+
+  /// Return the size of the given node, or of the node of the child, once
+  /// written to a page.
+  static size_t encodedSize(const Node& node);
+  size_t encodedSize(const Child& child) const;
+
+  /// Split the given oversized node in two.
+  Split split(Node& node);
+
+  /// Release the overflow pages of the value, if any.
+  void release(const Value& value);
+
+  /// Write the modified nodes under the child to new pages, bottom up.
+  void write(Child& child);
+
+  /// Allocate count consecutive pages.
+  uint64_t allocate(uint64_t count);
+
+  /// Write the given bytes at the given page.
+  void writePages(uint64_t page, const char* data, size_t size);
+
+  /// Write the meta page of the given transaction.
+  void writeMeta(uint64_t txid, uint64_t rootPage, uint64_t pages);
+
+  /// Move the pages released by old transactions to the free list, as long
+  /// as no on-disk meta page and no snapshot can reach them anymore.
+  void reclaim();
+
+  /// Rebuild the free list from the pages unreachable from the given roots.
+  void rebuildFreeList(const std::vector<uint64_t>& roots);
+
+  /// Throw if the key or the value cannot be stored.
+  static void checkSize(const std::string& key, size_t valueSize);
+
+private:
+  /// The file descriptor and the read-only mapping of the file.
+  int fd = -1;
+  const char* map = nullptr;
+  const size_t mapSize;
+
+  /// The number of pages in the file. Touching the mapping past the end of
+  /// the file raises SIGBUS, so a page id read from the file is checked
+  /// against it first. Grows as commit writes pages.
+  std::atomic<uint64_t> filePages{0};
+
+  /// The current mode, following the most recent switch call.
+  Mode mode = Mode::None;
+
+  /// The root of the tree being modified in apply mode.
+  Child root;
+
+  /// The last committed transaction, its root and the number of pages it
+  /// uses. Written by commit only, but read by snapshots under snapshotMutex.
+  uint64_t committedTxid = 0;
+  uint64_t committedRoot = 0;
+  uint64_t pageCount = 0;
+
+  /// Changes made in check mode. Deleted keys map to nullopt.
+  std::unordered_map<std::string, nonstd::optional<std::string>> checkWrites;
+
+  /// The pages released by the current apply-mode changes.
+  std::vector<uint64_t> released;
+
+  /// The pages released by each committed transaction, not yet reusable.
+  std::vector<std::pair<uint64_t, std::vector<uint64_t>>> pendingFree;
+
+  /// The pages that can be written again.
+  std::vector<uint64_t> freeList;
+
+  /// The number of live snapshots of each transaction.
+  mutable std::map<uint64_t, int> snapshots;
+
+  /// Protect snapshots and the committed transaction against concurrent
+  /// snapshot calls.
+  mutable std::mutex snapshotMutex;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("storage");
+};
@@ -0,0 +1,328 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "storage_cache.h"
+
+#include <utility>
+
+#include "util/parallel.h"
+
+StorageCache::StorageCache(Storage& _backend,
+                           bool _pipelined,
+                           const std::string& _profilePath)
+    : backend(_backend)
+    , pipelined(_pipelined)
+    , profilePath(_profilePath)
+{
+  backend.switchToApply();
+  if (pipelined)
+    writer = std::thread([this] { writerLoop(); });
+}
+
+StorageCache::~StorageCache()
+{
+  try {
+    sync();
+  } catch (const std::exception& err) {
+    WARN(log, "Failed to persist the last committed block: {}", err.what());
+  }
+  if (writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(writerMutex);
+      stopping = true;
+    }
+    writerWake.notify_one();
+    writer.join();
+  }
+  try {
+    saveProfile();
+  } catch (const std::exception& err) {
+    WARN(log, "Failed to save the access profile: {}", err.what());
+  }
+}
+
+nonstd::optional<std::string> StorageCache::get(const std::string& key) const
+{
+  if (currentWrites == nullptr) {
+    throw Failure("<StorageCache::get> currentWrites points to nullptr");
+  }
+  if (auto it = currentWrites->find(key); it != currentWrites->end()) {
+    return it->second;
+  }
+  if (!profilePath.empty() && ++profileReads % ProfileSampleRate == 0)
+    profile.record(key);
+  if (pendingWrites) {
+    if (auto it = pendingWrites->find(key); it != pendingWrites->end()) {
+      return it->second;
+    }
+  }
+  {
+    std::shared_lock<std::shared_mutex> lock(readCacheMutex);
+    if (auto it = readCache.find(key); it != readCache.end()) {
+      return it->second;
+    }
+  }
+  std::shared_lock<std::shared_mutex> lock(backendMutex);
+  return backend.get(key);
+}
+
+void StorageCache::put(const std::string& key, const std::string& val)
+{
+  if (currentWrites == nullptr) {
+    throw Failure("<StorageCache::put> currentWrites points to nullptr");
+  }
+  currentWrites->insert_or_assign(key, val);
+}
+
+void StorageCache::del(const std::string& key)
+{
+  if (currentWrites == nullptr) {
+    throw Failure("<StorageCache::del> currentWrites points to nullptr");
+  }
+  currentWrites->insert_or_assign(key, nonstd::nullopt);
+}
+
+void StorageCache::bulkLoad(
+    std::vector<std::pair<std::string, std::string>> entries)
+{
+  if (currentWrites != &applyWrites) {
+    throw Failure("<StorageCache::bulkLoad> must be called in apply mode");
+  }
+  sync();
+  {
+    std::unique_lock<std::shared_mutex> lock(readCacheMutex);
+    readCache.clear();
+    ++readCacheGeneration;
+  }
+  std::unique_lock<std::shared_mutex> lock(backendMutex);
+  backend.switchToApply();
+  backend.bulkLoad(std::move(entries));
+}
+
+void StorageCache::commit()
+{
+  // The previous block must be durable before this one is handed off.
+  sync();
+
+  {
+    std::unique_lock<std::shared_mutex> lock(commitMutex);
+    updateReadCache(applyWrites);
+    pendingWrites = std::make_shared<const WriteSet>(std::move(applyWrites));
+  }
+  applyWrites.clear();
+  checkWrites.clear();
+  currentWrites = nullptr;
+
+  if (pipelined) {
+    {
+      std::lock_guard<std::mutex> lock(writerMutex);
+      toPersist = pendingWrites;
+    }
+    writerWake.notify_one();
+  } else {
+    persist(*pendingWrites);
+    std::unique_lock<std::shared_mutex> lock(commitMutex);
+    pendingWrites.reset();
+  }
+
+  if (++commitsSinceProfileSave >= ProfileSaveInterval) {
+    commitsSinceProfileSave = 0;
+    try {
+      saveProfile();
+    } catch (const std::exception& err) {
+      WARN(log, "Failed to save the access profile: {}", err.what());
+    }
+  }
+}
+
+void StorageCache::switchToCheck()
+{
+  currentWrites = &checkWrites;
+}
+
+void StorageCache::switchToApply()
+{
+  currentWrites = &applyWrites;
+}
+
+void StorageCache::prefetch(const std::vector<std::string>& keys)
+{
+  if (keys.empty())
+    return;
+
+  uint64_t generation;
+  {
+    std::shared_lock<std::shared_mutex> lock(readCacheMutex);
+    generation = readCacheGeneration;
+  }
+
+  // Read the keys from the backend, concurrently if there are enough of them.
+  // Readers share the backend with each other but not with the background
+  // writer.
+  auto readChunk = [&](size_t begin, size_t end) {
+    WriteSet chunkValues;
+    std::shared_lock<std::shared_mutex> lock(backendMutex);
+    for (size_t idx = begin; idx < end; ++idx)
+      chunkValues.emplace(keys[idx], backend.get(keys[idx]));
+    return chunkValues;
+  };
+  std::vector<WriteSet> values;
+  if (keys.size() < ParallelPrefetchSize) {
+    values.push_back(readChunk(0, keys.size()));
+  } else {
+    values = parallelChunks(keys.size(), readChunk);
+  }
+
+  std::unique_lock<std::shared_mutex> lock(readCacheMutex);
+  if (generation != readCacheGeneration)
+    return;
+
+  for (auto& chunkValues : values) {
+    for (auto& [key, val] : chunkValues) {
+      if (readCache.size() >= ReadCacheCapacity)
+        return;
+      // Never replace an existing entry. It comes from a committed block and
+      // is at least as recent as what the backend returned.
+      readCache.emplace(key, std::move(val));
+    }
+  }
+}
+
+nonstd::optional<std::string> StorageCache::peek(const std::string& key) const
+{
+  std::shared_lock<std::shared_mutex> lock(readCacheMutex);
+  if (auto it = readCache.find(key); it != readCache.end())
+    return it->second;
+  return nonstd::nullopt;
+}
+
+nonstd::optional<std::string>
+StorageCache::getCommitted(const std::string& key) const
+{
+  std::shared_lock<std::shared_mutex> commitLock(commitMutex);
+  if (pendingWrites) {
+    if (auto it = pendingWrites->find(key); it != pendingWrites->end()) {
+      return it->second;
+    }
+  }
+  {
+    std::shared_lock<std::shared_mutex> lock(readCacheMutex);
+    if (auto it = readCache.find(key); it != readCache.end()) {
+      return it->second;
+    }
+  }
+  std::shared_lock<std::shared_mutex> lock(backendMutex);
+  return backend.get(key);
+}
+
+void StorageCache::warmup()
+{
+  if (profilePath.empty())
+    return;
+
+  // The profile is only a hint. Start cold rather than refuse to start if it
+  // cannot be read.
+  try {
+    profile.load(profilePath);
+  } catch (const Failure& err) {
+    WARN(log, "Failed to load the access profile: {}", err.what());
+    return;
+  }
+  auto keys = profile.hottest(ProfileCapacity);
+  prefetch(keys);
+  INFO(log, "Warmed up the read cache with {} keys", keys.size());
+}
+
+void StorageCache::sync()
+{
+  if (pipelined) {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    writerIdle.wait(lock, [this] { return !toPersist; });
+    if (persistError)
+      std::rethrow_exception(std::exchange(persistError, nullptr));
+  }
+
+  std::unique_lock<std::shared_mutex> lock(commitMutex);
+  pendingWrites.reset();
+}
+
+void StorageCache::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(writerMutex);
+  while (true) {
+    writerWake.wait(lock, [this] { return toPersist || stopping; });
+    if (!toPersist)
+      return;
+
+    auto writes = toPersist;
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      persist(*writes);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    toPersist.reset();
+    persistError = error;
+    writerIdle.notify_all();
+  }
+}
+
+void StorageCache::persist(const WriteSet& writes)
+{
+  // Write in bounded chunks, releasing the backend in between so that read
+  // misses of the executing block do not wait for the whole write set. The
+  // keys being written are served from pendingWrites until the persist is
+  // over, so readers never observe a half-written block.
+  auto it = writes.begin();
+  while (it != writes.end()) {
+    std::unique_lock<std::shared_mutex> lock(backendMutex);
+    for (size_t count = 0; count < PersistChunkSize && it != writes.end();
+         ++count, ++it) {
+      const auto& [key, val] = *it;
+      if (val.has_value()) {
+        backend.put(key, *val);
+      } else {
+        backend.del(key);
+      }
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(backendMutex);
+  backend.commit();
+  backend.switchToApply();
+}
+
+void StorageCache::updateReadCache(const WriteSet& writes)
+{
+  std::unique_lock<std::shared_mutex> lock(readCacheMutex);
+  if (readCache.size() + writes.size() > ReadCacheCapacity) {
+    readCache.clear();
+    ++readCacheGeneration;
+  }
+  for (auto& [key, val] : writes)
+    readCache.insert_or_assign(key, val);
+}
+
+void StorageCache::saveProfile() const
+{
+  if (profilePath.empty())
+    return;
+
+  profile.save(profilePath);
+}
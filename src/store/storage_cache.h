@@ -0,0 +1,185 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <nonstd/optional.hpp>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "store/access_profile.h"
+#include "store/storage.h"
+
+/// StorageCache keeps the uncommitted changes of both modes in memory on top
+/// of another storage backend. At commit, the block's write set becomes
+/// immutable and is written to the backend. In pipelined mode, that write runs
+/// on a long-lived writer thread while the next block executes, and the
+/// durability of a block is only awaited at the next commit or on destruction.
+///
+/// If a profile path is given, StorageCache also records how often each key is
+/// read. The profile is saved periodically and on destruction, and warmup
+/// loads the hottest keys of the previous run into the read cache.
+class StorageCache : public Storage
+{
+public:
+  StorageCache(Storage& backend,
+               bool pipelined,
+               const std::string& profilePath = "");
+
+  /// Wait for the pending background write (if any) to finish, stop the
+  /// writer thread and save the access profile.
+  ~StorageCache();
+
+  nonstd::optional<std::string> get(const std::string& key) const final;
+  void put(const std::string& key, const std::string& val) final;
+  void del(const std::string& key) final;
+
+  /// Write the entries straight to the backend, bypassing the write sets. Only
+  /// valid in apply mode. The entries become durable at the next commit.
+  void bulkLoad(std::vector<std::pair<std::string, std::string>> entries) final;
+
+  void commit() final;
+  void switchToCheck() final;
+  void switchToApply() final;
+
+  /// Read the given keys from the backend into the read cache. Large key sets
+  /// are read in parallel, small ones on the calling thread.
+  void prefetch(const std::vector<std::string>& keys) final;
+
+  /// Return the value of the key if the read cache holds it.
+  nonstd::optional<std::string> peek(const std::string& key) const final;
+
+  /// Return the committed value of the key from the pending write set, the
+  /// read cache or the backend.
+  nonstd::optional<std::string>
+  getCommitted(const std::string& key) const final;
+
+  /// Load the saved access profile and prefetch its hottest keys.
+  void warmup() final;
+
+  /// Block until every committed block is persisted in the backend. Rethrow
+  /// the error if the background write failed.
+  void sync();
+
+private:
+  /// Changes made on top of the committed state. Deleted keys map to nullopt.
+  using WriteSet =
+      std::unordered_map<std::string, nonstd::optional<std::string>>;
+
+  /// Persist the blocks handed over by commit until the cache is destroyed.
+  void writerLoop();
+
+  /// Apply the given write set to the backend and commit it.
+  void persist(const WriteSet& writes);
+
+  /// Keep the read cache consistent with the write set being committed.
+  void updateReadCache(const WriteSet& writes);
+
+  /// Save the access profile if profiling is enabled.
+  void saveProfile() const;
+
+public:
+  /// The maximum number of keys kept in the read cache and in the profile.
+  static constexpr size_t ReadCacheCapacity = 1 << 20;
+  static constexpr size_t ProfileCapacity = 1 << 16;
+
+  /// The number of writes the background persist makes before it lets the
+  /// readers waiting on the backend through.
+  static constexpr size_t PersistChunkSize = 256;
+
+  /// The smallest number of keys a prefetch spreads over several threads.
+  /// Below that, starting the threads costs more than the reads themselves.
+  static constexpr size_t ParallelPrefetchSize = 1024;
+
+  /// The number of block commits between two consecutive profile saves.
+  static constexpr uint64_t ProfileSaveInterval = 1000;
+
+  /// Only one in this many reads is recorded in the profile, which is enough
+  /// to tell the hot keys apart without hashing every key read.
+  static constexpr uint64_t ProfileSampleRate = 8;
+
+private:
+  /// Reference to the underlying storage. Only accessed in apply mode.
+  Storage& backend;
+
+  /// If true, committed blocks are persisted in the background.
+  const bool pipelined;
+
+  /// Two different write sets for each of the modes. Both are cleared at
+  /// commit, after the apply set is handed to the backend.
+  WriteSet checkWrites;
+  WriteSet applyWrites;
+
+  /// Pointer to the current write set, following the most recent switch call.
+  WriteSet* currentWrites = nullptr;
+
+  /// The most recently committed write set that may not be in the backend yet.
+  /// Reads consult it before falling back to the backend.
+  std::shared_ptr<const WriteSet> pendingWrites;
+
+  /// The writer thread persisting the committed blocks in pipelined mode.
+  /// commit hands it one block at a time through toPersist, and sync waits
+  /// until toPersist is empty again. Protected by writerMutex.
+  std::thread writer;
+  std::mutex writerMutex;
+  std::condition_variable writerWake;
+  std::condition_variable writerIdle;
+  std::shared_ptr<const WriteSet> toPersist;
+  std::exception_ptr persistError;
+  bool stopping = false;
+
+  /// Committed values read ahead of time by prefetch. Every key written by a
+  /// committed block is also kept here, so a concurrent prefetch can never
+  /// shadow a newer value with the one it read from the backend.
+  WriteSet readCache;
+
+  /// Incremented whenever readCache is cleared. A prefetch that started before
+  /// the clear discards its results.
+  uint64_t readCacheGeneration = 0;
+
+  /// Protect readCache and readCacheGeneration against concurrent prefetches.
+  mutable std::shared_mutex readCacheMutex;
+
+  /// Held exclusively while commit moves the applied write set into
+  /// pendingWrites and the read cache, and shared by committed reads, so that
+  /// those never see a block half committed.
+  mutable std::shared_mutex commitMutex;
+
+  /// Serialize the access to the backend between the background writer and
+  /// the readers. Readers may share the backend with each other.
+  mutable std::shared_mutex backendMutex;
+
+  /// The file to persist the access profile to, or empty if disabled.
+  const std::string profilePath;
+
+  /// The access frequency of the keys read through this storage.
+  mutable AccessProfile profile{ProfileCapacity};
+
+  /// The number of reads that could have been recorded in the profile.
+  mutable uint64_t profileReads = 0;
+
+  /// The number of commits since the profile was last saved.
+  uint64_t commitsSinceProfileSave = 0;
+
+  /// Static logger for this class.
+  static inline auto log = logger::get("storage");
+};
@@ -17,45 +17,102 @@
 
 #include "storage_map.h"
 
+StorageMap::StorageMap()
+    : committed(std::make_shared<const Map>())
+{
+}
+
 nonstd::optional<std::string> StorageMap::get(const std::string& key) const
 {
-  if (currentCache == nullptr) {
-    throw Failure("<StorageMap::get> currentCache points to nullptr");
-  }
-  if (auto it = currentCache->find(key); it != currentCache->end()) {
-    return it->second;
+  switch (mode) {
+    case Mode::Check:
+      if (auto it = checkWrites.find(key); it != checkWrites.end()) {
+        return it->second;
+      }
+      return getCommitted(key);
+    case Mode::Apply:
+      if (auto it = applyCache.find(key); it != applyCache.end()) {
+        return it->second;
+      }
+      return nonstd::nullopt;
+    default:
+      throw Failure("<StorageMap::get> no mode is selected");
   }
-  return nonstd::nullopt;
 }
 
 void StorageMap::put(const std::string& key, const std::string& val)
 {
-  if (currentCache == nullptr) {
-    throw Failure("<StorageMap::put> currentCache points to nullptr");
+  switch (mode) {
+    case Mode::Check:
+      checkWrites.insert_or_assign(key, val);
+      break;
+    case Mode::Apply:
+      applyCache.insert_or_assign(key, val);
+      break;
+    default:
+      throw Failure("<StorageMap::put> no mode is selected");
   }
-  currentCache->operator[](key) = val;
 }
 
 void StorageMap::del(const std::string& key)
 {
-  if (currentCache == nullptr) {
-    throw Failure("<StorageMap::del> currentCache points to nullptr");
+  switch (mode) {
+    case Mode::Check:
+      checkWrites.insert_or_assign(key, nonstd::nullopt);
+      break;
+    case Mode::Apply:
+      applyCache.erase(key);
+      break;
+    default:
+      throw Failure("<StorageMap::del> no mode is selected");
+  }
+}
+
+void StorageMap::bulkLoad(
+    std::vector<std::pair<std::string, std::string>> entries)
+{
+  if (mode != Mode::Apply) {
+    throw Failure("<StorageMap::bulkLoad> must be called in apply mode");
   }
-  currentCache->erase(key);
+  // Size the table once rather than rehashing repeatedly while inserting.
+  applyCache.reserve(applyCache.size() + entries.size());
+  for (auto& [key, val] : entries)
+    applyCache.insert_or_assign(std::move(key), std::move(val));
 }
 
 void StorageMap::commit()
 {
-  checkCache = applyCache;
-  currentCache = nullptr;
+  auto snapshot = std::make_shared<const Map>(applyCache);
+  {
+    std::lock_guard<std::mutex> lock(committedMutex);
+    committed = std::move(snapshot);
+  }
+  checkWrites.clear();
+  mode = Mode::None;
 }
 
 void StorageMap::switchToCheck()
 {
-  currentCache = &checkCache;
+  mode = Mode::Check;
 }
 
 void StorageMap::switchToApply()
 {
-  currentCache = &applyCache;
+  mode = Mode::Apply;
+}
+
+nonstd::optional<std::string>
+StorageMap::getCommitted(const std::string& key) const
+{
+  auto state = snapshot();
+  if (auto it = state->find(key); it != state->end()) {
+    return it->second;
+  }
+  return nonstd::nullopt;
+}
+
+std::shared_ptr<const StorageMap::Map> StorageMap::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(committedMutex);
+  return committed;
 }
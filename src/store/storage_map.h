@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <nonstd/optional.hpp>
 #include <unordered_map>
 
@@ -25,23 +27,47 @@
 /// StorageMap is a simple interface for store key-value data backed by
 /// std::unordered_map. Obviously, this is not persistent and will be purged
 /// after the program dies.
+///
+/// At commit, a copy of the applied state is published as an immutable
+/// snapshot. Check mode keeps its changes on top of that snapshot, and
+/// committed reads from other threads share it.
 class StorageMap : public Storage
 {
 public:
+  StorageMap();
+
   nonstd::optional<std::string> get(const std::string& key) const final;
   void put(const std::string& key, const std::string& val) final;
   void del(const std::string& key) final;
+  void bulkLoad(std::vector<std::pair<std::string, std::string>> entries) final;
   void commit() final;
   void switchToCheck() final;
   void switchToApply() final;
 
+  /// Return the value of the key in the snapshot taken at the last commit.
+  nonstd::optional<std::string>
+  getCommitted(const std::string& key) const final;
+
+private:
+  using Map = std::unordered_map<std::string, std::string>;
+
+  /// Return the snapshot published by the last commit.
+  std::shared_ptr<const Map> snapshot() const;
+
 public:
-  /// Two different maps for each of the modes. Note that checkCache will be a
-  /// copy of applyCache everytime commit is called.
-  std::unordered_map<std::string, std::string> checkCache;
-  std::unordered_map<std::string, std::string> applyCache;
-
-  /// Pointer to the current cache database, following the most recent switch
-  /// call.
-  std::unordered_map<std::string, std::string>* currentCache = nullptr;
+  /// The applied state, including the changes since the last commit.
+  Map applyCache;
+
+private:
+  /// Changes made in check mode on top of the committed snapshot. Deleted
+  /// keys map to nullopt. Cleared at commit.
+  std::unordered_map<std::string, nonstd::optional<std::string>> checkWrites;
+
+  /// The mode following the most recent switch call.
+  enum class Mode { None, Check, Apply } mode = Mode::None;
+
+  /// The state at the last commit. Never modified, only replaced by the next
+  /// commit. Protected by committedMutex, which only guards the pointer.
+  std::shared_ptr<const Map> committed;
+  mutable std::mutex committedMutex;
 };
@@ -0,0 +1,168 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "storage_trace.h"
+
+StorageTrace::StorageTrace(Storage& _backend, const std::string& path)
+    : backend(_backend)
+    , file(path, std::ios::binary | std::ios::trunc)
+{
+  if (!file)
+    throw Failure("StorageTrace: cannot open {}", path);
+}
+
+StorageTrace::~StorageTrace()
+{
+  writeFrame();
+}
+
+nonstd::optional<std::string> StorageTrace::get(const std::string& key) const
+{
+  auto val = backend.get(key);
+  record(TraceOp::Get, key, val ? val->size() : 0);
+  return val;
+}
+
+void StorageTrace::put(const std::string& key, const std::string& val)
+{
+  record(TraceOp::Put, key, val.size());
+  backend.put(key, val);
+}
+
+void StorageTrace::del(const std::string& key)
+{
+  record(TraceOp::Del, key, 0);
+  backend.del(key);
+}
+
+void StorageTrace::add(const std::string& key, const uint256_t& delta)
+{
+  record(TraceOp::Add, key, encoded_size(delta), delta);
+  backend.add(key, delta);
+}
+
+void StorageTrace::commit()
+{
+  record(TraceOp::Commit, "", 0);
+  writeFrame();
+  backend.commit();
+}
+
+void StorageTrace::switchToCheck()
+{
+  record(TraceOp::SwitchToCheck, "", 0);
+  backend.switchToCheck();
+}
+
+void StorageTrace::switchToApply()
+{
+  record(TraceOp::SwitchToApply, "", 0);
+  backend.switchToApply();
+}
+
+void StorageTrace::bulkLoad(
+    std::vector<std::pair<std::string, std::string>> entries)
+{
+  record(TraceOp::BulkLoad, "", entries.size());
+  for (const auto& [key, val] : entries)
+    record(TraceOp::Put, key, val.size());
+  backend.bulkLoad(std::move(entries));
+}
+
+void StorageTrace::prefetch(const std::vector<std::string>& keys)
+{
+  backend.prefetch(keys);
+}
+
+nonstd::optional<std::string> StorageTrace::peek(const std::string& key) const
+{
+  return backend.peek(key);
+}
+
+nonstd::optional<std::string>
+StorageTrace::getCommitted(const std::string& key) const
+{
+  return backend.getCommitted(key);
+}
+
+void StorageTrace::warmup()
+{
+  backend.warmup();
+}
+
+void StorageTrace::record(TraceOp op,
+                          const std::string& key,
+                          uint64_t valueSize,
+                          const uint256_t& delta) const
+{
+  frame << TraceRecord{op, key, valueSize, delta};
+  if (static_cast<size_t>(frame.size_bytes()) >= FrameSize)
+    writeFrame();
+}
+
+void StorageTrace::writeFrame() const
+{
+  if (frame.empty())
+    return;
+
+  Buffer header;
+  header << uint64_t(frame.size_bytes());
+  file << header.to_raw_string() << frame.to_raw_string();
+  file.flush();
+  frame.clear();
+}
+
+TraceReader::TraceReader(const std::string& path)
+    : file(path, std::ios::binary)
+{
+  if (!file)
+    throw Failure("TraceReader: cannot open {}", path);
+
+  file.seekg(0, std::ios::end);
+  fileSize = file.tellg();
+  file.seekg(0, std::ios::beg);
+}
+
+nonstd::optional<TraceRecord> TraceReader::next()
+{
+  if (frame.empty()) {
+    // Read the varint length prefix byte by byte, then the whole frame.
+    Buffer header;
+    char ch;
+    while (file.get(ch)) {
+      header << std::byte(ch);
+      if (!(ch & 0x80))
+        break;
+    }
+    if (header.empty())
+      return nonstd::nullopt;
+
+    // The length comes from the file, so check it against what is left before
+    // allocating the frame.
+    const uint64_t size = header.read<uint64_t>();
+    const uint64_t remaining = fileSize - uint64_t(file.tellg());
+    if (size > remaining)
+      throw Failure("TraceReader: frame of {} bytes exceeds the {} bytes left",
+                    size, remaining);
+
+    std::string raw(size, '\0');
+    if (!file.read(raw.data(), raw.size()))
+      throw Failure("TraceReader: truncated frame");
+    frame = Buffer(gsl::as_bytes(gsl::make_span(raw)));
+  }
+  return frame.read<TraceRecord>();
+}
@@ -0,0 +1,124 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <enum/enum.h>
+#include <fstream>
+#include <nonstd/optional.hpp>
+
+#include "inc/essential.h"
+#include "store/storage.h"
+#include "util/buffer.h"
+
+/// The operation recorded in one entry of a storage trace. A BulkLoad record
+/// is followed by one Put record for each of the entries it loads.
+ENUM(TraceOp, uint8_t, Get, Put, Del, Add, Commit, SwitchToCheck,
+     SwitchToApply, BulkLoad)
+
+/// A single recorded storage operation. Values are not kept, only their sizes,
+/// which is enough to replay the workload against another backend. The delta
+/// of an Add is kept, and the number of entries of a BulkLoad is stored as
+/// its value size.
+struct TraceRecord {
+  TraceOp op = TraceOp::Get;
+  std::string key;
+  uint64_t valueSize = 0;
+  uint256_t delta = 0;
+
+  friend Buffer& operator<<(Buffer& buf, const TraceRecord& record)
+  {
+    buf << record.op << record.key << record.valueSize;
+    if (record.op == +TraceOp::Add)
+      buf << record.delta;
+    return buf;
+  }
+
+  friend Buffer& operator>>(Buffer& buf, TraceRecord& record)
+  {
+    buf >> record.op >> record.key >> record.valueSize;
+    if (record.op == +TraceOp::Add)
+      buf >> record.delta;
+    return buf;
+  }
+};
+
+/// StorageTrace forwards every operation to another storage and appends it to
+/// a compact binary trace file. Records are written in length-prefixed frames
+/// of a few kilobytes, and the pending frame is written out at every commit.
+class StorageTrace : public Storage
+{
+public:
+  StorageTrace(Storage& backend, const std::string& path);
+
+  /// Write out the pending records.
+  ~StorageTrace();
+
+  nonstd::optional<std::string> get(const std::string& key) const final;
+  void put(const std::string& key, const std::string& val) final;
+  void del(const std::string& key) final;
+  void add(const std::string& key, const uint256_t& delta) final;
+  void commit() final;
+  void switchToCheck() final;
+  void switchToApply() final;
+  void bulkLoad(std::vector<std::pair<std::string, std::string>> entries) final;
+  void prefetch(const std::vector<std::string>& keys) final;
+  nonstd::optional<std::string> peek(const std::string& key) const final;
+  nonstd::optional<std::string>
+  getCommitted(const std::string& key) const final;
+  void warmup() final;
+
+private:
+  /// Append the given record to the pending frame, writing the frame out once
+  /// it is large enough.
+  void record(TraceOp op,
+              const std::string& key,
+              uint64_t valueSize,
+              const uint256_t& delta = 0) const;
+
+  /// Write the pending frame to the trace file.
+  void writeFrame() const;
+
+public:
+  /// The frame size above which records are written to the file.
+  static constexpr size_t FrameSize = 4096;
+
+private:
+  /// The storage to which all operations are forwarded.
+  Storage& backend;
+
+  /// The trace file and the records not written to it yet.
+  mutable std::ofstream file;
+  mutable Buffer frame;
+};
+
+/// TraceReader reads back the records of a trace written by StorageTrace.
+class TraceReader
+{
+public:
+  TraceReader(const std::string& path);
+
+  /// Return the next record, or nullopt at the end of the trace.
+  nonstd::optional<TraceRecord> next();
+
+private:
+  std::ifstream file;
+  Buffer frame;
+
+  /// The size of the trace file, which bounds the length of any frame.
+  uint64_t fileSize = 0;
+};
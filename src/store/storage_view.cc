@@ -0,0 +1,60 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "storage_view.h"
+
+StorageView::StorageView(const Storage& _base)
+    : base(_base)
+{
+}
+
+nonstd::optional<std::string> StorageView::get(const std::string& key) const
+{
+  if (auto it = writes.find(key); it != writes.end()) {
+    return it->second;
+  }
+  return base.getCommitted(key);
+}
+
+void StorageView::put(const std::string& key, const std::string& val)
+{
+  writes.insert_or_assign(key, val);
+}
+
+void StorageView::del(const std::string& key)
+{
+  writes.insert_or_assign(key, nonstd::nullopt);
+}
+
+void StorageView::commit()
+{
+  writes.clear();
+}
+
+void StorageView::switchToCheck()
+{
+}
+
+void StorageView::switchToApply()
+{
+}
+
+void StorageView::clear()
+{
+  reset();
+  commit();
+}
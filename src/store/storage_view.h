@@ -0,0 +1,58 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <nonstd/optional.hpp>
+#include <unordered_map>
+
+#include "inc/essential.h"
+#include "store/storage.h"
+
+/// StorageView is a scratch storage on top of the committed state of another
+/// storage. Its changes stay in a write set of its own and never reach the
+/// base, so transactions can be checked against it while the base executes a
+/// block on another thread. The view has a single mode.
+class StorageView : public Storage
+{
+public:
+  StorageView(const Storage& base);
+
+  nonstd::optional<std::string> get(const std::string& key) const final;
+  void put(const std::string& key, const std::string& val) final;
+  void del(const std::string& key) final;
+
+  /// Discard the flushed changes. The view has nowhere to persist them.
+  void commit() final;
+  void switchToCheck() final;
+  void switchToApply() final;
+
+  /// Discard the pending contracts and all the changes, so that the view reads
+  /// the committed state of the base again.
+  void clear();
+
+private:
+  /// Changes made on top of the committed state. Deleted keys map to nullopt.
+  using WriteSet =
+      std::unordered_map<std::string, nonstd::optional<std::string>>;
+
+  /// Reference to the storage whose committed state this view reads.
+  const Storage& base;
+
+  /// The changes flushed to this view since the last commit.
+  WriteSet writes;
+};
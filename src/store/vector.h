@@ -20,12 +20,13 @@
 #include <unordered_map>
 
 #include "inc/essential.h"
+#include "store/field_key.h"
 #include "store/storage.h"
 #include "util/buffer.h"
 #include "util/bytes.h"
 
 /// Shorthand macro to define Vector field inside of contract.
-#define VECTOR(VAL, NAME) Vector<VAL> NAME{storage, key + "/" + #NAME + "/"};
+#define VECTOR(VAL, NAME) Vector<VAL> NAME{storage, key, "/" #NAME "/"};
 
 template <typename T>
 class Vector
@@ -35,28 +36,33 @@ public:
       : storage(_storage)
       , baseKey(_key)
   {
-    auto result = storage.get(baseKey);
-    if (result) {
-      mSize = Buffer::deserialize<uint256_t>(*result);
-    } else {
-      mSize = 0;
-    }
+  }
+
+  /// Create this vector for the field of the contract at parentKey. Nothing is
+  /// read from the storage until the vector is first used.
+  Vector(Storage& _storage, const std::string& parentKey, const char* suffix)
+      : storage(_storage)
+      , baseKey(parentKey, suffix)
+  {
   }
 
   ~Vector()
   {
-    if (storage.shouldFlush()) {
+    if (storage.shouldFlush() && isSizeLoaded) {
       if (isDestroyed) {
-        DEBUG(log, "DELETE VECTOR {}", baseKey);
-        storage.del(baseKey);
+        DEBUG(log, "DELETE VECTOR {}", baseKey.str());
+        storage.del(baseKey.str());
         for (uint256_t i = 0; i < mSize; i++) {
           storage.del(baseKey + i.str());
         }
-      } else {
-        storage.put(baseKey, Buffer::serialize<uint256_t>(mSize));
+      } else if (mSize != storedSize) {
+        storage.put(baseKey.str(), Buffer::serialize<uint256_t>(mSize));
 
-        // Save every member in cache to storage.
+        // Existing members cannot be modified, so only the pushed ones need
+        // to be saved. The others in cache were only read.
         for (auto& [idx, value] : cache) {
+          if (idx < storedSize)
+            continue;
           storage.put(baseKey + idx.str(), Buffer::serialize<T>(value));
           DEBUG(log, "PUT {}", baseKey + idx.str());
         }
@@ -66,6 +72,7 @@ public:
 
   T operator[](const uint256_t& idx) const
   {
+    loadSize();
     if (isDestroyed) {
       throw Error("Vector has been destroyed.");
     }
@@ -86,6 +93,7 @@ public:
 
   void pushBack(const T& value)
   {
+    loadSize();
     if (isDestroyed) {
       throw Error("Vector has been destroyed.");
     }
@@ -95,16 +103,19 @@ public:
 
   void destroy()
   {
+    loadSize();
     isDestroyed = true;
   }
 
   uint256_t size() const
   {
+    loadSize();
     return mSize;
   }
 
   T back() const
   {
+    loadSize();
     if (mSize == 0)
       throw Error("Cannot get last element.");
     return operator[](mSize - 1);
@@ -112,6 +123,7 @@ public:
 
   uint256_t lowerBoundIndex(const T& value) const
   {
+    loadSize();
     uint256_t st = 0;
     uint256_t ed = mSize;
     while (st < ed) {
@@ -125,15 +137,38 @@ public:
     return st;
   }
 
+private:
+  /// Load the size of this vector from the storage if not done yet.
+  void loadSize() const
+  {
+    if (isSizeLoaded)
+      return;
+
+    auto result = storage.get(baseKey.str());
+    if (result) {
+      mSize = Buffer::deserialize<uint256_t>(*result);
+    } else {
+      mSize = 0;
+    }
+    storedSize = mSize;
+    isSizeLoaded = true;
+  }
+
 private:
   /// Reference to the storage layer.
   Storage& storage;
 
   /// The key to which this Vector use to access data.
-  const std::string baseKey;
+  const FieldKey baseKey;
+
+  /// Size of vector. Only valid once isSizeLoaded is true.
+  mutable uint256_t mSize = 0;
+
+  /// Size of vector as loaded from the storage.
+  mutable uint256_t storedSize = 0;
 
-  /// Size of vector
-  uint256_t mSize;
+  /// Whether the size has been loaded from the storage.
+  mutable bool isSizeLoaded = false;
 
   /// The map to keep track of 'active' member in Vector. All member in cache
   /// are saved when this Vector is deconstructed.
@@ -17,53 +17,373 @@
 
 #include "buffer.h"
 
-std::string bytes_to_hex(gsl::span<const byte> data)
+#if defined(__x86_64__) || defined(__i386__)
+#define BAND_HEX_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+constexpr char HexDigits[] = "0123456789abcdef";
+
+/// The two hex characters of every byte value, in output order.
+struct HexEncodeTable {
+  constexpr HexEncodeTable()
+      : chars()
+  {
+    for (int value = 0; value < 256; ++value) {
+      chars[2 * value] = HexDigits[value >> 4];
+      chars[2 * value + 1] = HexDigits[value & 0xF];
+    }
+  }
+
+  char chars[512];
+};
+
+/// The value of every hex digit character, or InvalidDigit.
+struct HexDecodeTable {
+  static constexpr uint8_t InvalidDigit = 0xFF;
+
+  constexpr HexDecodeTable()
+      : values()
+  {
+    for (int c = 0; c < 256; ++c)
+      values[c] = InvalidDigit;
+    for (int value = 0; value < 16; ++value) {
+      values[uint8_t(HexDigits[value])] = value;
+      values[uint8_t("0123456789ABCDEF"[value])] = value;
+    }
+  }
+
+  uint8_t values[256];
+};
+
+constexpr HexEncodeTable hexEncodeTable;
+constexpr HexDecodeTable hexDecodeTable;
+
+#ifdef BAND_HEX_X86
+/// Encode the 16-byte blocks of data from idx on, advancing idx past them.
+__attribute__((target("ssse3"))) void
+hex_encode_ssse3(const byte* data, size_t& idx, size_t size, char* out)
+{
+  const __m128i lut = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i mask = _mm_set1_epi8(0xF);
+  for (; idx + 16 <= size; idx += 16) {
+    const __m128i input = _mm_loadu_si128((const __m128i*)(data + idx));
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(input, 4), mask);
+    const __m128i lo = _mm_and_si128(input, mask);
+    const __m128i hiChars = _mm_shuffle_epi8(lut, hi);
+    const __m128i loChars = _mm_shuffle_epi8(lut, lo);
+    _mm_storeu_si128((__m128i*)(out + 2 * idx),
+                     _mm_unpacklo_epi8(hiChars, loChars));
+    _mm_storeu_si128((__m128i*)(out + 2 * idx + 16),
+                     _mm_unpackhi_epi8(hiChars, loChars));
+  }
+}
+
+/// Encode the 32-byte blocks of data from idx on, then the 16-byte ones.
+__attribute__((target("avx2"))) void
+hex_encode_avx2(const byte* data, size_t& idx, size_t size, char* out)
+{
+  const __m256i lut = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e',
+      'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+      'e', 'f');
+  const __m256i mask = _mm256_set1_epi8(0xF);
+  for (; idx + 32 <= size; idx += 32) {
+    const __m256i input = _mm256_loadu_si256((const __m256i*)(data + idx));
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(input, 4), mask);
+    const __m256i lo = _mm256_and_si256(input, mask);
+    const __m256i hiChars = _mm256_shuffle_epi8(lut, hi);
+    const __m256i loChars = _mm256_shuffle_epi8(lut, lo);
+    // Unpacking works within 128-bit lanes, so restore the byte order.
+    const __m256i first = _mm256_unpacklo_epi8(hiChars, loChars);
+    const __m256i second = _mm256_unpackhi_epi8(hiChars, loChars);
+    _mm256_storeu_si256((__m256i*)(out + 2 * idx),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 2 * idx + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  hex_encode_ssse3(data, idx, size, out);
+}
+
+/// Decode the 8-byte blocks of hex from idx on, advancing idx past them.
+/// Return false if any character is not a hex digit.
+__attribute__((target("ssse3"))) bool
+hex_decode_ssse3(const char* hex, size_t& idx, size_t size, byte* out)
+{
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i lowerA = _mm_set1_epi8('a');
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i five = _mm_set1_epi8(5);
+  const __m128i ten = _mm_set1_epi8(10);
+  const __m128i caseBit = _mm_set1_epi8(0x20);
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  for (; idx + 8 <= size; idx += 8) {
+    const __m128i input = _mm_loadu_si128((const __m128i*)(hex + 2 * idx));
+    // Digits map to 0-9, and letters of either case map to 0-5 after 'a'.
+    const __m128i digit = _mm_sub_epi8(input, zero);
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(input, caseBit), lowerA);
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit);
+    const __m128i isLetter =
+        _mm_cmpeq_epi8(_mm_min_epu8(letter, five), letter);
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF)
+      return false;
+    const __m128i values =
+        _mm_or_si128(_mm_and_si128(isDigit, digit),
+                     _mm_and_si128(isLetter, _mm_add_epi8(letter, ten)));
+    // Combine each pair of nibbles into hi * 16 + lo, then narrow to bytes.
+    const __m128i pairs = _mm_maddubs_epi16(values, weights);
+    _mm_storel_epi64((__m128i*)(out + idx), _mm_packus_epi16(pairs, pairs));
+  }
+  return true;
+}
+#endif
+
+/// Write the 2 * size hex characters of the given bytes into out, using the
+/// given code path for the leading blocks.
+void hex_encode(const byte* data, size_t size, char* out, HexPath path)
+{
+  size_t idx = 0;
+#ifdef BAND_HEX_X86
+  if (path == HexPath::AVX2) {
+    hex_encode_avx2(data, idx, size, out);
+  } else if (path == HexPath::SSSE3) {
+    hex_encode_ssse3(data, idx, size, out);
+  }
+#endif
+  for (; idx < size; ++idx) {
+    const char* chars = &hexEncodeTable.chars[2 * uint8_t(data[idx])];
+    out[2 * idx] = chars[0];
+    out[2 * idx + 1] = chars[1];
+  }
+}
+
+/// Decode the 2 * size hex characters at hex into out. Return false if any
+/// character is not a hex digit.
+bool hex_decode(const char* hex, size_t size, byte* out, HexPath path)
 {
-  std::string hex;
-  for (const byte b : data) {
-    hex += "{:02x}"_format(static_cast<unsigned char>(b));
+  size_t idx = 0;
+#ifdef BAND_HEX_X86
+  // Decoding has no wider blocks than SSSE3 ones.
+  if (path != HexPath::Scalar && !hex_decode_ssse3(hex, idx, size, out))
+    return false;
+#endif
+  for (; idx < size; ++idx) {
+    const uint8_t hi = hexDecodeTable.values[uint8_t(hex[2 * idx])];
+    const uint8_t lo = hexDecodeTable.values[uint8_t(hex[2 * idx + 1])];
+    if ((hi | lo) > 0xF)
+      return false;
+    out[idx] = byte((hi << 4) | lo);
   }
+  return true;
+}
+
+/// Throw unless the CPU supports the given code path.
+void checkHexPath(HexPath path)
+{
+  if (path > hex_best_path())
+    throw Error("Hex code path {} is not supported by this CPU", int(path));
+}
+} // namespace
+
+HexPath hex_best_path()
+{
+#ifdef BAND_HEX_X86
+  static const HexPath best = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return HexPath::AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+      return HexPath::SSSE3;
+    return HexPath::Scalar;
+  }();
+  return best;
+#else
+  return HexPath::Scalar;
+#endif
+}
+
+std::string bytes_to_hex(gsl::span<const byte> data)
+{
+  return bytes_to_hex(data, hex_best_path());
+}
+
+std::string bytes_to_hex(gsl::span<const byte> data, HexPath path)
+{
+  checkHexPath(path);
+  std::string hex(2 * data.size(), '\0');
+  hex_encode(data.data(), data.size(), hex.data(), path);
   return hex;
 }
 
-Buffer::Buffer()
-    : buf()
+void hex_to_bytes(const std::string& hex, gsl::span<byte> out)
+{
+  hex_to_bytes(hex, out, hex_best_path());
+}
+
+void hex_to_bytes(const std::string& hex, gsl::span<byte> out, HexPath path)
 {
-  // Reserve 128 bytes to the buffer to prevent unnecessarily resizing
-  buf.reserve(128);
+  checkHexPath(path);
+  if (hex.size() != 2 * size_t(out.size()))
+    throw Error("hex_to_bytes: Invalid hex string length {}", hex.size());
+  if (!hex_decode(hex.data(), out.size(), out.data(), path))
+    throw Error("hex_to_bytes: Invalid hex digit character");
 }
 
+namespace
+{
+/// Heap storage released by destroyed buffers on this thread, ready to be
+/// reused by buffers that outgrow their inline storage.
+struct BufferPool {
+  ~BufferPool()
+  {
+    alive = false;
+  }
+
+  std::vector<Buffer::Container> containers;
+
+  /// Buffers destroyed after the pool during thread exit must not touch it.
+  static inline thread_local bool alive = true;
+};
+
+thread_local BufferPool pool;
+} // namespace
+
 Buffer::Buffer(gsl::span<const byte> data)
 {
-  buf.resize(data.size_bytes());
-  std::memcpy(&(*buf.begin()), data.data(), data.size_bytes());
+  reserveFor(data.size_bytes());
+  buf.insert(buf.end(), data.begin(), data.end());
+}
+
+Buffer::~Buffer()
+{
+  if (buf.capacity() <= InlineCapacity || buf.capacity() > MaxPooledCapacity)
+    return;
+  if (!BufferPool::alive || pool.containers.size() >= MaxPooledBuffers)
+    return;
+  buf.clear();
+  pool.containers.push_back(std::move(buf));
+}
+
+void Buffer::own()
+{
+  const auto data = as_const_span();
+  viewData = nullptr;
+  viewSize = 0;
+  offset = 0;
+  reserveFor(data.size_bytes());
+  buf.insert(buf.end(), data.begin(), data.end());
+}
+
+void Buffer::grow(size_t needed)
+{
+  // Only inline buffers draw from the pool. Heap buffers grow as usual.
+  if (buf.capacity() <= InlineCapacity && BufferPool::alive &&
+      !pool.containers.empty()) {
+    Container pooled = std::move(pool.containers.back());
+    pool.containers.pop_back();
+    pooled.insert(pooled.end(), buf.begin(), buf.end());
+    buf = std::move(pooled);
+  }
+  if (needed > buf.capacity())
+    buf.reserve(std::max(needed, 2 * buf.capacity()));
 }
 
 Buffer& Buffer::operator<<(std::byte val)
 {
+  reserveFor(1);
   buf.push_back(val);
   return *this;
 }
 
 Buffer& Buffer::operator>>(std::byte& val)
 {
-  val = buf.front();
-  buf.erase(buf.begin());
+  if (empty())
+    throw Error("Buffer parse error");
+  val = readBegin()[offset];
+  consume(1);
   return *this;
 }
 
 Buffer& Buffer::operator<<(const Buffer& data)
 {
-  buf.insert(buf.end(), data.buf.begin(), data.buf.end());
+  auto data_bytes = data.as_const_span();
+  reserveFor(data_bytes.size());
+  buf.insert(buf.end(), data_bytes.begin(), data_bytes.end());
   return *this;
 }
 
 Buffer& Buffer::operator>>(Buffer& data)
 {
-  data.buf.insert(data.buf.end(), buf.begin(), buf.end());
+  data << *this;
   return *this;
 }
 
+namespace
+{
+constexpr size_t LimbBits = 64;
+constexpr size_t LimbCount = uint256_t::LimbCount;
+} // namespace
+
+size_t varint_write(std::byte* out, const uint256_t& val)
+{
+  const auto& valLimbs = val.limbs();
+  if ((valLimbs[1] | valLimbs[2] | valLimbs[3]) == 0)
+    return varint_write(out, valLimbs[0]);
+
+  uint64_t limbs[LimbCount + 1] = {};
+  std::copy(valLimbs.begin(), valLimbs.end(), limbs);
+
+  const size_t length = varint_size(val);
+  for (size_t idx = 0; idx < length; ++idx) {
+    const size_t pos = 7 * idx;
+    const size_t shift = pos % LimbBits;
+    uint64_t group = limbs[pos / LimbBits] >> shift;
+    if (shift > LimbBits - 7)
+      group |= limbs[pos / LimbBits + 1] << (LimbBits - shift);
+    group &= 0x7F;
+    if (idx + 1 < length)
+      group |= 0x80;
+    out[idx] = std::byte(uint8_t(group));
+  }
+  return length;
+}
+
+size_t varint_read(const std::byte* data,
+                   const std::byte* end,
+                   uint256_t& val)
+{
+  // Most values fit in 63 bits, which the 64-bit codec decodes exactly.
+  uint64_t small;
+  const size_t smallLength = varint_read(data, end, small);
+  if (smallLength != 0 && smallLength <= 9) {
+    val = small;
+    return smallLength;
+  }
+
+  uint64_t limbs[LimbCount + 1] = {};
+  const size_t limit =
+      std::min<size_t>(end - data, varint_max_size<uint256_t>());
+  for (size_t idx = 0; idx < limit; ++idx) {
+    const uint64_t group = std::to_integer<uint64_t>(data[idx]) & 0x7F;
+    const size_t pos = 7 * idx;
+    const size_t shift = pos % LimbBits;
+    limbs[pos / LimbBits] |= group << shift;
+    if (shift > LimbBits - 7)
+      limbs[pos / LimbBits + 1] |= group >> (LimbBits - shift);
+
+    if (!(std::to_integer<uint8_t>(data[idx]) & 0x80)) {
+      if (limbs[LimbCount] != 0)
+        throw Error("Varint decode overflows uint256_t");
+      val = uint256_t::fromLimbs({limbs[0], limbs[1], limbs[2], limbs[3]});
+      return idx + 1;
+    }
+  }
+  return 0;
+}
+
 Buffer& operator<<(Buffer& buf, uint8_t val)
 {
   varint_encode(buf, val);
@@ -149,6 +469,10 @@ Buffer& operator<<(Buffer& buf, const std::string& val)
 
 Buffer& operator>>(Buffer& buf, std::string& val)
 {
-  val.resize(buf.read<uint64_t>());
+  // Check the length against the data before allocating for it.
+  const uint64_t size = buf.read<uint64_t>();
+  if (size > uint64_t(buf.size_bytes()))
+    throw Error("Buffer parse error");
+  val.resize(size);
   return buf >> gsl::make_span(val);
 }
@@ -17,50 +17,114 @@
 
 #pragma once
 
+#include <boost/container/small_vector.hpp>
+#include <cstring>
 #include <deque>
+#include <limits>
 #include <type_traits>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 
 #include "inc/essential.h"
 
+/// The code paths of the hex codec, from the slowest to the fastest. All of
+/// them are compiled in, and the fastest one the CPU supports is picked at run
+/// time.
+enum class HexPath { Scalar, SSSE3, AVX2 };
+
+/// Return the fastest hex code path the CPU supports.
+HexPath hex_best_path();
+
 /// Converts the given span of raw data into its hex representation
 std::string bytes_to_hex(gsl::span<const byte> data);
 
+/// Decodes the given hex string into out, which must be half as long as the
+/// string. Accepts both lower and upper case digits.
+void hex_to_bytes(const std::string& hex, gsl::span<byte> out);
+
+/// Same as above, but force the given code path, e.g. to test each of them.
+/// Throw if the CPU does not support it.
+std::string bytes_to_hex(gsl::span<const byte> data, HexPath path);
+void hex_to_bytes(const std::string& hex, gsl::span<byte> out, HexPath path);
+
+/// Buffer is a byte sequence to serialize data into and deserialize data from.
+/// Small contents are stored inline. Larger storage is recycled through a
+/// thread-local pool so that temporary buffers do not allocate in steady state.
+/// A buffer may also read data it does not own, see view.
 class Buffer
 {
 public:
-  Buffer();
+  Buffer() = default;
   Buffer(gsl::span<const byte> data);
+  Buffer(const Buffer& other) = default;
+  Buffer& operator=(const Buffer& other) = default;
+
+  Buffer(Buffer&& other)
+      : buf(std::move(other.buf))
+      , offset(std::exchange(other.offset, 0))
+      , viewData(std::exchange(other.viewData, nullptr))
+      , viewSize(std::exchange(other.viewSize, 0))
+  {
+    other.buf.clear();
+  }
+
+  Buffer& operator=(Buffer&& other)
+  {
+    buf = std::move(other.buf);
+    offset = std::exchange(other.offset, 0);
+    viewData = std::exchange(other.viewData, nullptr);
+    viewSize = std::exchange(other.viewSize, 0);
+    other.buf.clear();
+    return *this;
+  }
+
+  /// Return the heap storage of this buffer, if any, to the thread-local pool.
+  ~Buffer();
+
+  /// Create a buffer that reads the given data in place rather than copying
+  /// it. The data must outlive the buffer and stay unchanged. Writing to the
+  /// buffer first copies the unread data into its own storage.
+  static Buffer view(gsl::span<const byte> data)
+  {
+    Buffer buf;
+    buf.viewData = data.data();
+    buf.viewSize = data.size_bytes();
+    return buf;
+  }
 
   template <typename T>
   static T deserialize(const std::string& raw_data)
   {
-    Buffer buf(gsl::as_bytes(gsl::make_span(raw_data)));
+    Buffer buf = view(gsl::as_bytes(gsl::make_span(raw_data)));
     return buf.read<T>();
   }
 
   /// Serialize the given data into raw string. Use operator<< internally.
   template <typename T>
-  static std::string serialize(const T& data)
-  {
-    Buffer buf;
-    buf << data;
-    return std::string((const char*)&buf.buf.front(), buf.buf.size());
-  }
+  static std::string serialize(const T& data);
+
+  /// Serialize the given data into the given string, reusing its capacity.
+  template <typename T>
+  static void serializeInto(const T& data, std::string& dest);
 
   /// Read this buffer as the given type.
   template <typename T>
   T read();
 
+  /// Expose the unread part of this buffer as a span.
   gsl::span<byte> as_span()
   {
-    return gsl::make_span(buf);
+    if (viewData != nullptr)
+      own();
+    return gsl::make_span(buf).subspan(offset);
   }
 
-  /// Expose this data as a read-only span. Note that if this is destroyed,
-  /// the span will become invalid.
+  /// Expose the unread part of this buffer as a read-only span. Note that if
+  /// this is destroyed or written to, the span will become invalid.
   gsl::span<const byte> as_const_span() const
   {
-    return gsl::make_span(buf);
+    return gsl::make_span(readBegin() + offset, readEnd());
   }
 
   Buffer& operator<<(std::byte val);
@@ -72,6 +136,7 @@ public:
   friend Buffer& operator<<(Buffer& buf, gsl::span<T> data)
   {
     auto data_bytes = gsl::as_bytes(data);
+    buf.reserveFor(data_bytes.size());
     buf.buf.insert(buf.buf.end(), data_bytes.begin(), data_bytes.end());
     return buf;
   }
@@ -81,34 +146,74 @@ public:
   {
     if (buf.size_bytes() < data.size_bytes())
       throw Error("Buffer parse error");
-    std::memcpy(data.data(), &buf.buf.front(), data.size_bytes());
+    std::memcpy(data.data(), buf.readBegin() + buf.offset, data.size_bytes());
     buf.consume(data.size_bytes());
     return buf;
   }
 
-  /// Return whether this buffer is empty
+  /// Return whether this buffer has no unread data
   bool empty() const
   {
-    return buf.empty();
+    return readBegin() + offset == readEnd();
   }
 
-  /// Return the size of this buffer in bytes.
+  /// Return the size of the unread data in this buffer in bytes.
   gsl::span<const std::byte>::size_type size_bytes() const
   {
     return as_const_span().size_bytes();
   }
 
+  /// Make room for length more bytes so that writing them does not grow the
+  /// storage again.
+  void reserve(size_t length)
+  {
+    reserveFor(length);
+  }
+
+  /// Return a writable span of length bytes past the end of the data, so that
+  /// a producer such as a socket read can fill it in place. The span is valid
+  /// until the next write to this buffer. Call commit with the number of bytes
+  /// actually filled to append them.
+  gsl::span<byte> prepare(size_t length)
+  {
+    reserveFor(length);
+    return gsl::make_span(buf.data() + buf.size(), length);
+  }
+
+  /// Append the first length bytes of the span returned by prepare.
+  void commit(size_t length)
+  {
+    if (buf.size() + length > buf.capacity())
+      throw Error("Buffer commit past the prepared space");
+    buf.resize(buf.size() + length, boost::container::default_init);
+  }
+
   /// Clear the content in this buffer.
   void clear()
   {
     buf.clear();
+    offset = 0;
+    viewData = nullptr;
+    viewSize = 0;
   }
 
-  /// Consume the first length bytes of this buffer.
+  /// Consume the first length bytes of this buffer. This only advances the
+  /// read offset. The consumed prefix is dropped once the buffer is drained,
+  /// or once it outgrows the unread data so that a long-lived stream buffer
+  /// stays bounded at an amortized constant cost per byte.
   void consume(size_t length)
   {
-    // TODO: Make this be more efficient
-    buf.erase(buf.begin(), buf.begin() + length);
+    const size_t size = readEnd() - readBegin();
+    if (length > size - offset)
+      throw Error("Buffer consume past the end");
+    offset += length;
+    if (offset == size) {
+      clear();
+    } else if (viewData == nullptr && offset >= CompactThreshold &&
+               offset > size - offset) {
+      buf.erase(buf.begin(), buf.begin() + offset);
+      offset = 0;
+    }
   }
 
   std::string to_string() const
@@ -118,11 +223,64 @@ public:
 
   std::string to_raw_string() const
   {
-    return std::string((const char*)&buf.front(), buf.size());
+    auto data = as_const_span();
+    return std::string((const char*)data.data(), data.size_bytes());
   }
 
+  /// Copy the unread data into the given string, replacing its content.
+  void serializeInto(std::string& dest) const
+  {
+    auto data = as_const_span();
+    dest.assign((const char*)data.data(), data.size_bytes());
+  }
+
+  /// The number of bytes stored inline before the buffer uses heap storage.
+  static constexpr size_t InlineCapacity = 128;
+
+  /// The limits of the thread-local pool of heap storage.
+  static constexpr size_t MaxPooledBuffers = 16;
+  static constexpr size_t MaxPooledCapacity = 1 << 16;
+
+  using Container = boost::container::small_vector<std::byte, InlineCapacity>;
+
 private:
-  std::vector<std::byte> buf;
+  /// Make room for length more bytes, taking storage from the pool if the
+  /// buffer is about to outgrow its inline storage.
+  void reserveFor(size_t length)
+  {
+    if (viewData != nullptr)
+      own();
+    if (buf.size() + length > buf.capacity())
+      grow(buf.size() + length);
+  }
+  void grow(size_t needed);
+
+  /// Copy the unread viewed data into the storage of this buffer.
+  void own();
+
+  /// The range of the data this buffer reads from, including the consumed
+  /// prefix: the viewed data if any, otherwise its own storage.
+  const byte* readBegin() const
+  {
+    return viewData != nullptr ? viewData : buf.data();
+  }
+
+  const byte* readEnd() const
+  {
+    return viewData != nullptr ? viewData + viewSize : buf.data() + buf.size();
+  }
+
+  /// The minimum number of consumed bytes before consume compacts the buffer.
+  static constexpr size_t CompactThreshold = 4096;
+
+  Container buf;
+
+  /// The position of the first unread byte, in buf or in the viewed data.
+  size_t offset = 0;
+
+  /// The data read in place by a buffer created with view, or nullptr.
+  const byte* viewData = nullptr;
+  size_t viewSize = 0;
 };
 
 template <typename T>
@@ -167,38 +325,259 @@ Buffer& operator>>(Buffer& buf, T& val)
   return buf;
 }
 
+/// Return the number of bytes varint_encode writes for the given value.
+template <typename T>
+constexpr size_t varint_size(T val)
+{
+  if constexpr (std::is_integral_v<T>) {
+    if (val == 0)
+      return 1;
+    const size_t bits = 64 - __builtin_clzll(val);
+    return (bits + 6) / 7;
+  } else {
+    if (!val)
+      return 1;
+    return (val.bitLength() + 6) / 7;
+  }
+}
+
+/// The largest number of bytes varint_encode writes for a value of type T.
 template <typename T>
-void varint_encode(Buffer& buf, T val)
+constexpr size_t varint_max_size()
 {
-  while (true) {
-    std::byte towrite{uint8_t(val & 0x7F)};
+  if constexpr (std::is_integral_v<T>) {
+    return (8 * sizeof(T) + 6) / 7;
+  } else {
+    return (std::numeric_limits<T>::digits + 6) / 7;
+  }
+}
+
+/// Write the varint encoding of the given 64-bit value into out, which must
+/// have room for 10 bytes. Return the number of bytes written.
+inline size_t varint_write(std::byte* out, uint64_t val)
+{
+  size_t length = 0;
+  while (val >= 0x80) {
+    out[length++] = std::byte(uint8_t(val | 0x80));
     val >>= 7;
-    if (val != 0) {
-      buf << (towrite | std::byte{0x80});
-    } else {
-      buf << towrite;
-      break;
+  }
+  out[length++] = std::byte(uint8_t(val));
+  return length;
+}
+
+/// Read a varint of at most 10 bytes from the range [data, end) into val.
+/// Return the number of bytes read, or 0 if the range does not hold a
+/// complete varint. When 8 bytes are available, the terminating byte is
+/// found with a single word load and the 7-bit groups are packed without a
+/// per-byte loop.
+inline size_t varint_read(const std::byte* data,
+                          const std::byte* end,
+                          uint64_t& val)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (end - data >= 8) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    const uint64_t stops = ~word & 0x8080808080808080ull;
+    if (stops != 0) {
+      const size_t length = __builtin_ctzll(stops) / 8 + 1;
+      if (length < 8)
+        word &= (uint64_t(1) << (8 * length)) - 1;
+#ifdef __BMI2__
+      val = _pext_u64(word, 0x7f7f7f7f7f7f7f7full);
+#else
+      word &= 0x7f7f7f7f7f7f7f7full;
+      word = (word & 0x007f007f007f007full) |
+             ((word & 0x7f007f007f007f00ull) >> 1);
+      word = (word & 0x00003fff00003fffull) |
+             ((word & 0x3fff00003fff0000ull) >> 2);
+      val = (word & 0x000000000fffffffull) |
+            ((word & 0x0fffffff00000000ull) >> 4);
+#endif
+      return length;
     }
   }
+#endif
+  const size_t limit = std::min<size_t>(end - data, 10);
+  val = 0;
+  for (size_t idx = 0; idx < limit; ++idx) {
+    const uint64_t byte = std::to_integer<uint64_t>(data[idx]);
+    val |= (byte & 0x7F) << (7 * idx);
+    if (!(byte & 0x80))
+      return idx + 1;
+  }
+  return 0;
+}
+
+/// Write the varint encoding of the given 256-bit value into out, which must
+/// have room for varint_max_size<uint256_t>() bytes. Values that fit in 64
+/// bits take the fast path. Larger ones are encoded from their 64-bit limbs
+/// without multiprecision arithmetic.
+size_t varint_write(std::byte* out, const uint256_t& val);
+
+/// Read a varint from the range [data, end) into the given 256-bit value.
+/// Return the number of bytes read, or 0 if the range does not hold a
+/// complete varint. Throw if the value does not fit in 256 bits.
+size_t varint_read(const std::byte* data,
+                   const std::byte* end,
+                   uint256_t& val);
+
+template <typename T>
+void varint_encode(Buffer& buf, const T& val)
+{
+  std::byte out[varint_max_size<T>()];
+  if constexpr (std::is_integral_v<T>) {
+    buf << gsl::make_span(out, varint_write(out, uint64_t(val)));
+  } else {
+    buf << gsl::make_span(out, varint_write(out, val));
+  }
 }
 
 template <typename T>
 void varint_decode(Buffer& buf, T& val)
 {
-  val = 0;
+  const auto data = buf.as_const_span();
+  size_t length;
+  if constexpr (std::is_integral_v<T>) {
+    uint64_t result;
+    length = varint_read(data.data(), data.data() + data.size(), result);
+    val = T(result);
+  } else {
+    length = varint_read(data.data(), data.data() + data.size(), val);
+  }
+  if (length == 0)
+    throw Error("Invalid varint decode");
+  buf.consume(length);
+}
 
-  int idx = 0;
-  for (const auto raw_byte : buf.as_span()) {
-    int byte = std::to_integer<int>(raw_byte);
-    val |= T(byte & 0x7F) << (7 * idx);
-    if (!(byte & 0x80)) {
-      buf.consume(1 + idx);
-      return;
+/// Decode a run of consecutive varints into the given values, consuming the
+/// buffer once at the end.
+template <typename T>
+void varint_decode_run(Buffer& buf, gsl::span<T> vals)
+{
+  const auto data = buf.as_const_span();
+  const std::byte* ptr = data.data();
+  const std::byte* end = ptr + data.size();
+  for (auto& val : vals) {
+    size_t length;
+    if constexpr (std::is_integral_v<T>) {
+      uint64_t result;
+      length = varint_read(ptr, end, result);
+      val = T(result);
+    } else {
+      length = varint_read(ptr, end, val);
     }
-
-    ++idx;
+    if (length == 0)
+      throw Error("Invalid varint decode");
+    ptr += length;
   }
-  throw Error("Invalid varint decode");
+  buf.consume(ptr - data.data());
+}
+
+/// Return the number of bytes operator<< writes for the given value. The size
+/// is constexpr for fixed-size types and cheap for varints and strings, so
+/// that writers can size their destinations before encoding.
+constexpr size_t encoded_size(std::byte val)
+{
+  return 1;
+}
+
+constexpr size_t encoded_size(bool val)
+{
+  return 1;
+}
+
+constexpr size_t encoded_size(uint8_t val)
+{
+  return varint_size(val);
+}
+
+constexpr size_t encoded_size(uint16_t val)
+{
+  return varint_size(val);
+}
+
+constexpr size_t encoded_size(uint32_t val)
+{
+  return varint_size(val);
+}
+
+constexpr size_t encoded_size(uint64_t val)
+{
+  return varint_size(val);
+}
+
+inline size_t encoded_size(const uint256_t& val)
+{
+  return varint_size(val);
+}
+
+inline size_t encoded_size(const std::string& val)
+{
+  return varint_size(val.size()) + val.size();
+}
+
+template <typename T, typename std::enable_if_t<std::is_enum_v<T>, int> = 0>
+constexpr size_t encoded_size(T val)
+{
+  return varint_size(static_cast<std::underlying_type_t<T>>(val));
+}
+
+template <typename T,
+          typename std::enable_if_t<std::is_integral_v<typename T::_integral>,
+                                    int> = 0>
+constexpr size_t encoded_size(T val)
+{
+  return varint_size(val._to_integral());
+}
+
+template <typename P1, typename P2>
+auto encoded_size(const std::pair<P1, P2>& val)
+    -> decltype(encoded_size(val.first) + encoded_size(val.second))
+{
+  return encoded_size(val.first) + encoded_size(val.second);
+}
+
+template <typename T>
+auto encoded_size(const std::vector<T>& val)
+    -> decltype(encoded_size(std::declval<const T&>()))
+{
+  size_t size = varint_size(val.size());
+  for (const auto& v : val)
+    size += encoded_size(v);
+  return size;
+}
+
+/// Whether encoded_size is available for the given type.
+template <typename T, typename = void>
+struct has_encoded_size : std::false_type {
+};
+
+template <typename T>
+struct has_encoded_size<
+    T,
+    std::void_t<decltype(encoded_size(std::declval<const T&>()))>>
+    : std::true_type {
+};
+
+template <typename T>
+std::string Buffer::serialize(const T& data)
+{
+  Buffer buf;
+  if constexpr (has_encoded_size<T>::value)
+    buf.reserve(encoded_size(data));
+  buf << data;
+  return buf.to_raw_string();
+}
+
+template <typename T>
+void Buffer::serializeInto(const T& data, std::string& dest)
+{
+  Buffer buf;
+  if constexpr (has_encoded_size<T>::value)
+    buf.reserve(encoded_size(data));
+  buf << data;
+  buf.serializeInto(dest);
 }
 
 template <typename T, typename... Args>
@@ -256,8 +635,13 @@ template <typename T>
 Buffer& operator>>(Buffer& buf, std::vector<T>& val)
 {
   val.resize(buf.read<uint64_t>());
-  for (auto& v : val) {
-    buf >> v;
+  if constexpr ((std::is_unsigned_v<T> && !std::is_same_v<T, bool>) ||
+                std::is_same_v<T, uint256_t>) {
+    varint_decode_run(buf, gsl::make_span(val));
+  } else {
+    for (auto& v : val) {
+      buf >> v;
+    }
   }
   return buf;
 }
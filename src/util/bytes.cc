@@ -19,22 +19,6 @@
 
 #include "crypto/random.h"
 
-namespace
-{
-inline byte hex_to_byte(char hex_digit)
-{
-  if ('0' <= hex_digit && hex_digit <= '9') {
-    return byte(hex_digit - '0');
-  } else if ('a' <= hex_digit && hex_digit <= 'f') {
-    return byte(hex_digit - 'a' + 10);
-  } else if ('A' <= hex_digit && hex_digit <= 'F') {
-    return byte(hex_digit - 'A' + 10);
-  } else {
-    throw Error("hex_to_bytes: Invalid hex digit character");
-  }
-}
-} // namespace
-
 template <int SIZE>
 Bytes<SIZE>::Bytes(gsl::span<const byte> data)
 {
@@ -66,10 +50,7 @@ Bytes<SIZE> Bytes<SIZE>::hex(const std::string& hex_string)
   }
 
   Bytes<SIZE> ret;
-  for (size_t i = 0; i < SIZE; ++i) {
-    ret.rawdata_[i] = (hex_to_byte(hex_string[2 * i + 0]) << 4) |
-                      (hex_to_byte(hex_string[2 * i + 1]) << 0);
-  }
+  hex_to_bytes(hex_string, ret.as_span());
   return ret;
 }
 
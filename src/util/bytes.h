@@ -73,6 +73,11 @@ public:
     return buf >> data.as_span();
   }
 
+  friend constexpr size_t encoded_size(const Bytes& data)
+  {
+    return SIZE;
+  }
+
 private:
   std::array<byte, SIZE> rawdata_{};
 
@@ -79,6 +79,14 @@ Buffer& operator<<(Buffer& buf, const Curve& curve)
   return buf;
 }
 
+size_t encoded_size(const Curve& curve)
+{
+  if (!curve.equation)
+    throw Failure("encoded_size(Curve): Equation does not exist");
+
+  return curve.equation->dump_size();
+}
+
 Buffer& operator>>(Buffer& buf, Curve& curve)
 {
   curve.equation = Eq::parse(buf);
@@ -146,6 +154,12 @@ void EqBinary<T, op, op_char>::dump(Buffer& buf) const
   right_expr->dump(buf);
 }
 
+template <typename T, OpCode::_enumerated op, char op_char>
+size_t EqBinary<T, op, op_char>::dump_size() const
+{
+  return encoded_size(op) + left_expr->dump_size() + right_expr->dump_size();
+}
+
 std::string EqConstant::to_string() const
 {
   return "{}"_format(constant);
@@ -223,3 +237,13 @@ void EqVar::dump(Buffer& buf) const
 {
   buf << OpCode::Variable;
 }
+
+size_t EqConstant::dump_size() const
+{
+  return encoded_size(OpCode::Constant) + encoded_size(constant);
+}
+
+size_t EqVar::dump_size() const
+{
+  return encoded_size(OpCode::Variable);
+}
@@ -61,6 +61,7 @@ public:
 
   friend Buffer& operator>>(Buffer& buf, Curve& curve);
   friend Buffer& operator<<(Buffer& buf, const Curve& curve);
+  friend size_t encoded_size(const Curve& curve);
 
   /// Return the y value at the given x value location
   uint256_t apply(const uint256_t& x_value) const;
@@ -93,6 +94,9 @@ public:
   /// Serialize this expression into the given buffer
   virtual void dump(Buffer& buf) const = 0;
 
+  /// Return the number of bytes dump writes
+  virtual size_t dump_size() const = 0;
+
   /// Return a deep copy of this expression
   virtual std::unique_ptr<Eq> clone() const = 0;
 
@@ -111,6 +115,7 @@ public:
 private:
   std::string to_string() const final;
   void dump(Buffer& buf) const final;
+  size_t dump_size() const final;
   std::unique_ptr<Eq> clone() const final;
 
 protected:
@@ -181,6 +186,7 @@ private:
   uint256_t apply(const uint256_t& x_value) const final;
   std::string to_string() const final;
   void dump(Buffer& buf) const final;
+  size_t dump_size() const final;
   std::unique_ptr<Eq> clone() const final;
 
 private:
@@ -193,5 +199,6 @@ private:
   uint256_t apply(const uint256_t& x_value) const final;
   std::string to_string() const final;
   void dump(Buffer& buf) const final;
+  size_t dump_size() const final;
   std::unique_ptr<Eq> clone() const final;
 };
@@ -20,7 +20,11 @@
 #include <boost/preprocessor/comparison/greater.hpp>
 #include <boost/preprocessor/logical/not.hpp>
 #include <boost/preprocessor/punctuation/comma_if.hpp>
+#include <boost/preprocessor/seq/for_each_i.hpp>
 #include <boost/preprocessor/variadic/size.hpp>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include "inc/essential.h"
 #include "util/equation.h"
@@ -57,8 +61,12 @@
 /// Convenient macro to suffix the given argument with "Response".
 #define BAND_MACRO_RESPONSE(NAME) BOOST_PP_CAT(NAME, Response)
 
-/// Declare ENUM to represent each of the message types.
-BAND_MACRO_MESSAGE_TYPES(ENUM, MsgType, uint16_t)
+/// Declare ENUM to represent each of the message types. Batch is not part of
+/// the list above since it only wraps the others. Its value is fixed so that
+/// it stays put as new message types are added.
+#define BAND_MACRO_MESSAGE_TYPE_ENUM(...) ENUM(__VA_ARGS__, Batch = 0x8000)
+BAND_MACRO_MESSAGE_TYPES(BAND_MACRO_MESSAGE_TYPE_ENUM, MsgType, uint16_t)
+#undef BAND_MACRO_MESSAGE_TYPE_ENUM
 
 STRUCT(
     /// Genesis Message is passed to the
@@ -68,6 +76,15 @@ STRUCT(
     (Ident, token)          //< First token native to the blockchain
 )
 
+STRUCT(
+    /// Genesis Account describes an account that exists from the first block,
+    /// together with its initial balance of the genesis token.
+    GenesisAccount,
+    (Ident, user),          //< Human-readable user identifier
+    (VerifyKey, verifyKey), //< Ed25519 verify key of the account
+    (uint256_t, balance)    //< Initial balance of the genesis token
+)
+
 STRUCT(
     /// Block Message gives the summary of a block. Each block contains one
     /// or more transactions.
@@ -188,3 +205,168 @@ RESPONSE(
 
 NO_RESPONSE(AddWikiEdge)
 NO_RESPONSE(RemoveWikiEdge)
+
+/// ResponseOf maps each message struct to the struct of its response.
+template <typename T>
+struct ResponseOf;
+
+#define BAND_MACRO_RESPONSE_OF(R, _, MSG)                                      \
+  template <>                                                                  \
+  struct ResponseOf<BAND_MACRO_MSG(MSG)> {                                     \
+    using type = BAND_MACRO_RESPONSE(MSG);                                     \
+  };
+
+BAND_MACRO_MESSAGE_FOR_EACH(BAND_MACRO_RESPONSE_OF)
+#undef BAND_MACRO_RESPONSE_OF
+
+////////////////////////////////////////////////////////////////////////////////
+/// Batch //////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// BatchItem holds one message, or one response, of any of the message types.
+/// On the wire it is the message type followed by the body, the same bytes
+/// that follow the header of a standalone transaction. Ts must be listed in
+/// the order of BAND_MACRO_MESSAGE_TYPES, so that the index of the held
+/// alternative is also its message type.
+template <typename... Ts>
+class BatchItem
+{
+public:
+  BatchItem() = default;
+
+  template <typename T,
+            typename = std::enable_if_t<
+                (std::is_same_v<std::decay_t<T>, Ts> || ...)>>
+  BatchItem(T&& _value)
+      : value(std::forward<T>(_value))
+  {
+  }
+
+  /// Return the message type of the held value.
+  MsgType type() const
+  {
+    return MsgType::_from_integral(value.index());
+  }
+
+  /// Call the given function with the held value.
+  template <typename F>
+  decltype(auto) visit(F&& func) const
+  {
+    return std::visit(std::forward<F>(func), value);
+  }
+
+  /// Return the held value if it is of type T, or nullptr otherwise.
+  template <typename T>
+  const T* get() const
+  {
+    return std::get_if<T>(&value);
+  }
+
+  /// Read the body of a value of the given type, whose type tag has already
+  /// been consumed. Batches do not nest, so Batch is rejected here.
+  void read(Buffer& buf, MsgType msgType)
+  {
+    const size_t idx = msgType._to_integral();
+    if (idx >= sizeof...(Ts))
+      throw Failure("BatchItem: message type {} cannot be batched",
+                    msgType._to_string());
+    readAt(buf, idx, std::index_sequence_for<Ts...>{});
+  }
+
+  friend Buffer& operator>>(Buffer& buf, BatchItem& item)
+  {
+    item.read(buf, buf.read<MsgType>());
+    return buf;
+  }
+
+  friend Buffer& operator<<(Buffer& buf, const BatchItem& item)
+  {
+    buf << item.type();
+    item.visit([&](const auto& val) { buf << val; });
+    return buf;
+  }
+
+  friend size_t encoded_size(const BatchItem& item)
+  {
+    return encoded_size(item.type()) +
+           item.visit([](const auto& val) { return encoded_size(val); });
+  }
+
+  std::string to_string() const
+  {
+    return visit([](const auto& val) { return val.to_string(); });
+  }
+
+private:
+  template <size_t... Is>
+  void readAt(Buffer& buf, size_t idx, std::index_sequence<Is...>)
+  {
+    ((idx == Is ? (void)(buf >> value.template emplace<Is>()) : (void)0), ...);
+  }
+
+private:
+  std::variant<Ts...> value;
+};
+
+/// The largest number of messages a single batch may carry.
+constexpr size_t MaxBatchSize = 1024;
+
+/// BatchList is the list of messages, or responses, carried by a batch. It is
+/// serialized like any vector, but its length is checked against MaxBatchSize
+/// before any item is allocated.
+template <typename T>
+struct BatchList : public std::vector<T> {
+  using std::vector<T>::vector;
+
+  friend Buffer& operator>>(Buffer& buf, BatchList& list)
+  {
+    const uint64_t count = buf.read<uint64_t>();
+    if (count == 0 || count > MaxBatchSize)
+      throw Failure("BatchList: invalid batch size {}", count);
+    list.resize(count);
+    for (auto& item : list)
+      buf >> item;
+    return buf;
+  }
+
+  std::string to_string() const
+  {
+    std::string ret = "[";
+    for (const auto& item : *this)
+      ret += " " + item.to_string() + ",";
+    if (!this->empty())
+      ret.pop_back();
+    return ret + " ]";
+  }
+};
+
+#define BAND_MACRO_BATCH_ALTERNATIVE(R, MACRO, IDX, NAME)                      \
+  BOOST_PP_COMMA_IF(IDX) MACRO(NAME)
+
+/// A message of any type but Batch, as carried by a batch.
+using BatchEntryMsg = BatchItem<BOOST_PP_SEQ_FOR_EACH_I(
+    BAND_MACRO_BATCH_ALTERNATIVE,
+    BAND_MACRO_MSG,
+    BAND_MACRO_MESSAGE_TYPES(BOOST_PP_VARIADIC_TO_SEQ))>;
+
+/// The response to a BatchEntryMsg.
+using BatchEntryResponse = BatchItem<BOOST_PP_SEQ_FOR_EACH_I(
+    BAND_MACRO_BATCH_ALTERNATIVE,
+    BAND_MACRO_RESPONSE,
+    BAND_MACRO_MESSAGE_TYPES(BOOST_PP_VARIADIC_TO_SEQ))>;
+
+#undef BAND_MACRO_BATCH_ALTERNATIVE
+
+MESSAGE(
+    /// Batch Message carries many messages under one header. They are
+    /// executed in order and either all of them take effect or none does.
+    Batch,                           //<
+    (BatchList<BatchEntryMsg>, msgs) //< The messages to execute
+)
+
+RESPONSE(
+    /// Batch Response holds the response of each message of the batch, in
+    /// the same order.
+    Batch,                                     //<
+    (BatchList<BatchEntryResponse>, responses) //< One response per message
+)
@@ -38,6 +38,9 @@
 #define BAND_MACRO_STRUCT_BUF_OUT(R, BUF, TYPE)                                \
   BUF << BOOST_PP_TUPLE_ELEM(1, TYPE);
 
+#define BAND_MACRO_STRUCT_SIZE(R, RET, TYPE)                                   \
+  RET += encoded_size(BOOST_PP_TUPLE_ELEM(1, TYPE));
+
 #define BAND_MACRO_STRUCT_TO_STRING(R, RET, TYPE)                              \
   RET += " {} = {},"_format(BOOST_PP_STRINGIZE(BOOST_PP_TUPLE_ELEM(1, TYPE)),  \
                             BOOST_PP_TUPLE_ELEM(1, TYPE));
@@ -69,6 +72,16 @@
     {                                                                          \
       return data._buffer_out(buf);                                            \
     }                                                                          \
+    size_t encodedSize() const                                                 \
+    {                                                                          \
+      size_t size = 0;                                                         \
+      BOOST_PP_SEQ_FOR_EACH(BAND_MACRO_STRUCT_SIZE, size, SEQ)                 \
+      return size;                                                             \
+    }                                                                          \
+    friend size_t encoded_size(const NAME& data)                               \
+    {                                                                          \
+      return data.encodedSize();                                               \
+    }                                                                          \
     std::string to_string() const                                              \
     {                                                                          \
       std::string ret;                                                         \
@@ -97,6 +110,14 @@
     {                                                                          \
       return buf;                                                              \
     }                                                                          \
+    static constexpr size_t encodedSize()                                      \
+    {                                                                          \
+      return 0;                                                                \
+    }                                                                          \
+    friend constexpr size_t encoded_size(const NAME& data)                     \
+    {                                                                          \
+      return 0;                                                                \
+    }                                                                          \
     std::string to_string() const                                              \
     {                                                                          \
       return "{{ {} }}"_format(BOOST_PP_STRINGIZE(NAME));                      \
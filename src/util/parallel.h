@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "inc/essential.h"
+
+/// Split the index range [0, count) into contiguous chunks, one per hardware
+/// thread, and call fn(begin, end) on each chunk concurrently. Return the
+/// results of the chunks in order. Rethrow the first exception raised by any
+/// of the chunks after all of them finish.
+template <typename Fn>
+auto parallelChunks(size_t count, Fn&& fn)
+{
+  using Result = decltype(fn(size_t{}, size_t{}));
+
+  std::vector<Result> results;
+  if (count == 0)
+    return results;
+
+  const size_t workers =
+      std::clamp<size_t>(std::thread::hardware_concurrency(), 1, count);
+  const size_t chunk = (count + workers - 1) / workers;
+
+  std::vector<std::future<Result>> futures;
+  for (size_t begin = 0; begin < count; begin += chunk) {
+    const size_t end = std::min(begin + chunk, count);
+    futures.push_back(std::async(std::launch::async,
+                                 [&fn, begin, end] { return fn(begin, end); }));
+  }
+
+  // Wait for every chunk before rethrowing, so that no worker outlives the
+  // references it captured.
+  std::exception_ptr error;
+  for (auto& future : futures) {
+    try {
+      results.push_back(future.get());
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+  if (error)
+    std::rethrow_exception(error);
+
+  return results;
+}
@@ -17,40 +17,107 @@
 
 #include "util/string.h"
 
-#include <boost/algorithm/string.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/// Return a mask with bit i set if character i of the 16-byte block is
+/// printable, i.e. within [0x20, 0x7e].
+inline uint32_t printable_mask(const char* block)
+{
+#ifdef __SSE2__
+  const __m128i chars = _mm_loadu_si128((const __m128i*)block);
+  // Adding one maps the printable range onto [0x21, 0x7f], the only bytes
+  // that compare greater than 0x20 as signed values.
+  const __m128i shifted = _mm_add_epi8(chars, _mm_set1_epi8(1));
+  return _mm_movemask_epi8(_mm_cmpgt_epi8(shifted, _mm_set1_epi8(0x20)));
+#else
+  uint32_t mask = 0;
+  for (int idx = 0; idx < 16; ++idx) {
+    const unsigned char c = block[idx];
+    if (c >= 0x20 && c <= 0x7e)
+      mask |= 1u << idx;
+  }
+  return mask;
+#endif
+}
+
+/// Lower the case of every ASCII letter in the 16-byte block.
+inline void to_lower_block(char* block)
+{
+#ifdef __SSE2__
+  const __m128i chars = _mm_loadu_si128((const __m128i*)block);
+  // Flipping the sign bit turns the unsigned range check c - 'A' < 26 into a
+  // signed comparison.
+  const __m128i offset = _mm_xor_si128(_mm_sub_epi8(chars, _mm_set1_epi8('A')),
+                                       _mm_set1_epi8(char(0x80)));
+  const __m128i isUpper = _mm_cmplt_epi8(offset, _mm_set1_epi8(-128 + 26));
+  _mm_storeu_si128(
+      (__m128i*)block,
+      _mm_or_si128(chars, _mm_and_si128(isUpper, _mm_set1_epi8(0x20))));
+#else
+  for (int idx = 0; idx < 16; ++idx) {
+    if (block[idx] >= 'A' && block[idx] <= 'Z')
+      block[idx] += 'a' - 'A';
+  }
+#endif
+}
+} // namespace
 
 template <int MAX_LENGTH, StringCase CASE>
 String<MAX_LENGTH, CASE>::String(const std::string& _string)
-    : rawdata(_string)
 {
+  setLength(_string.length());
+  std::memcpy(chars.data(), _string.data(), length);
   validate();
 }
 
 template <int MAX_LENGTH, StringCase CASE>
 std::string String<MAX_LENGTH, CASE>::to_string() const
 {
-  return rawdata;
+  return std::string(chars.data(), length);
 }
 
 template <int MAX_LENGTH, StringCase CASE>
-void String<MAX_LENGTH, CASE>::validate()
+void String<MAX_LENGTH, CASE>::setLength(size_t newLength)
 {
-  if (rawdata.length() > MAX_LENGTH) {
+  if (newLength > MAX_LENGTH) {
     throw Error(
         "String<{}, {}>::validate: String's length ({}) exceed maximum length.",
         MAX_LENGTH, CASE == StringCase::Sensitive ? "Sensitive" : "InSensitive",
-        rawdata.length());
+        newLength);
   }
-  if (std::any_of(rawdata.begin(), rawdata.end(),
-                  [](unsigned char c) { return !std::isprint(c); })) {
-    throw Error(
-        "String<{}, {}>::validate: rawdata contains unprintable characters",
-        MAX_LENGTH,
-        CASE == StringCase::Sensitive ? "Sensitive" : "InSensitive");
+  chars.fill(0);
+  length = newLength;
+}
+
+template <int MAX_LENGTH, StringCase CASE>
+void String<MAX_LENGTH, CASE>::validate()
+{
+  for (size_t idx = 0; idx < length; idx += 16) {
+    const size_t count = std::min<size_t>(length - idx, 16);
+    const uint32_t expected = (1u << count) - 1;
+    if ((printable_mask(chars.data() + idx) & expected) != expected) {
+      throw Error(
+          "String<{}, {}>::validate: rawdata contains unprintable characters",
+          MAX_LENGTH,
+          CASE == StringCase::Sensitive ? "Sensitive" : "InSensitive");
+    }
+    if (CASE == StringCase::InSensitive)
+      to_lower_block(chars.data() + idx);
   }
-  if (CASE == StringCase::InSensitive) {
-    boost::algorithm::to_lower(rawdata);
+
+  // Bytes past the length are zero, so the hash can consume whole words.
+  uint64_t hashState = HashSeed ^ length;
+  for (size_t idx = 0; idx < length; idx += 8) {
+    uint64_t word;
+    std::memcpy(&word, chars.data() + idx, sizeof(word));
+    hashState = (hashState ^ word) * 0x9e3779b97f4a7c15ull;
+    hashState ^= hashState >> 32;
   }
+  hashValue = hashState;
 }
 
 template class String<20, StringCase::InSensitive>;
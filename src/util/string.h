@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <array>
+#include <string_view>
+
 #include "inc/essential.h"
 #include "util/buffer.h"
 
@@ -28,7 +31,8 @@ enum class StringCase : uint8_t {
 
 // Class String is a custom string type containing maximum length. Every
 // character is readable. It changes string to lower case if it's not case
-// sensitive.
+// sensitive. The characters are stored inline together with the length and
+// the hash, so copying, comparing and hashing never touch the heap.
 template <int MAX_LENGTH, StringCase CASE>
 class String
 {
@@ -46,33 +50,89 @@ public:
 
   bool empty() const
   {
-    return rawdata.empty();
+    return length == 0;
+  }
+
+  /// Return the characters of this string. Only valid while this is alive.
+  std::string_view view() const
+  {
+    return std::string_view(chars.data(), length);
+  }
+
+  /// Return the hash of this string, computed once on construction.
+  size_t hash() const
+  {
+    return hashValue;
   }
 
   std::string to_string() const;
 
+  bool operator==(const String& rhs) const
+  {
+    return hashValue == rhs.hashValue && view() == rhs.view();
+  }
+
+  bool operator!=(const String& rhs) const
+  {
+    return !operator==(rhs);
+  }
+
   friend Buffer& operator<<(Buffer& buf, const String& data)
   {
-    return buf << data.rawdata;
+    return buf << (uint64_t)data.length
+               << gsl::make_span(data.chars.data(), data.length);
   }
 
   friend Buffer& operator>>(Buffer& buf, String& data)
   {
-    buf >> data.rawdata;
+    const uint64_t length = buf.read<uint64_t>();
+    data.setLength(length);
+    buf >> gsl::make_span(data.chars.data(), data.length);
     data.validate();
     return buf;
   }
 
+  friend size_t encoded_size(const String& data)
+  {
+    return varint_size(data.length) + data.length;
+  }
+
 private:
-  // Validate rawdata that size doesn't exceed max_length and every character
-  // is readable.
+  /// The capacity rounded up to whole 16-byte blocks, so that validation can
+  /// process the characters a block at a time.
+  static constexpr size_t Capacity = (MAX_LENGTH + 15) / 16 * 16;
+  static_assert(MAX_LENGTH <= 255, "String length must fit in a byte");
+
+  /// The hash of the empty string. See validate for the hash function.
+  static constexpr size_t HashSeed = 0xcbf29ce484222325ull;
+
+  // Clear the content and set the length. Throw if the length exceeds
+  // max_length.
+  void setLength(size_t newLength);
+
+  // Validate that every character is readable, lower the case if not case
+  // sensitive and compute the hash.
   void validate();
 
 private:
-  std::string rawdata{};
+  /// The characters of this string. Bytes past the length are always zero.
+  std::array<char, Capacity> chars{};
+  uint8_t length = 0;
+  size_t hashValue = HashSeed;
 };
 
 using Ident = String<20, StringCase::InSensitive>; //< 20-char readable ident
 using NodeID =
     String<128, StringCase::Sensitive>; //< 128-length string represent node in
                                         // graph database
+
+namespace std
+{
+template <int MAX_LENGTH, StringCase CASE>
+struct hash<String<MAX_LENGTH, CASE>> {
+  inline size_t operator()(const String<MAX_LENGTH, CASE>& obj) const
+  {
+    return obj.hash();
+  }
+};
+} // namespace std
@@ -0,0 +1,152 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "inc/essential.h"
+#include "listener/base.h"
+#include "listener/manager.h"
+#include "listener/primary.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
+#include "util/msg.h"
+
+class RecordingListener : public BaseListener
+{
+public:
+  RecordingListener(std::vector<std::string>& _seen)
+      : seen(_seen)
+  {
+  }
+
+  void handleCreateAccount(const BlockMsg& blk,
+                           const HeaderMsg& hdr,
+                           const CreateAccountMsg& msg,
+                           const CreateAccountResponse& res) final
+  {
+    seen.push_back("create " + msg.user.to_string());
+  }
+
+  void handleTransferToken(const BlockMsg& blk,
+                           const HeaderMsg& hdr,
+                           const TransferTokenMsg& msg,
+                           const TransferTokenResponse& res) final
+  {
+    seen.push_back("transfer " + msg.dest.to_string());
+  }
+
+private:
+  std::vector<std::string>& seen;
+};
+
+class BatchTest : public CxxTest::TestSuite
+{
+public:
+  void testEncodeRoundTrip()
+  {
+    BatchMsg batch;
+    batch.msgs.push_back(MintTokenMsg{Ident("Band"), 100});
+    batch.msgs.push_back(TransferTokenMsg{Ident("Band"), Ident("bob"), 7});
+
+    const std::string raw = Buffer::serialize(batch);
+    TS_ASSERT_EQUALS(raw.size(), encoded_size(batch));
+
+    auto decoded = Buffer::deserialize<BatchMsg>(raw);
+    TS_ASSERT_EQUALS(2, decoded.msgs.size());
+    TS_ASSERT_EQUALS(+MsgType::MintToken, decoded.msgs[0].type());
+    TS_ASSERT_EQUALS(+MsgType::TransferToken, decoded.msgs[1].type());
+    const auto* transfer = decoded.msgs[1].get<TransferTokenMsg>();
+    TS_ASSERT(transfer != nullptr);
+    TS_ASSERT_EQUALS(7, transfer->value);
+    TS_ASSERT_EQUALS(Ident("bob"), transfer->dest);
+  }
+
+  void testNestedBatchIsRejected()
+  {
+    Buffer buf;
+    buf << uint64_t(1) << MsgType(MsgType::Batch) << uint64_t(0);
+    TS_ASSERT_THROWS(buf.read<BatchMsg>(), const Failure&);
+  }
+
+  void testBatchSizeIsCheckedBeforeDecoding()
+  {
+    // A huge count must be rejected before the list is allocated.
+    Buffer huge;
+    huge << (uint64_t(1) << 40);
+    TS_ASSERT_THROWS(huge.read<BatchMsg>(), const Failure&);
+
+    Buffer empty;
+    empty << uint64_t(0);
+    TS_ASSERT_THROWS(empty.read<BatchMsg>(), const Failure&);
+
+    Buffer tooMany;
+    tooMany << uint64_t(MaxBatchSize + 1);
+    TS_ASSERT_THROWS(tooMany.read<BatchMsg>(), const Failure&);
+  }
+
+  void testApplyBatch()
+  {
+    StorageMap storage;
+    std::vector<std::string> seen;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.addListener(std::make_unique<RecordingListener>(seen));
+    manager.initChain({});
+    manager.beginBlock(0, Address());
+
+    BatchMsg batch;
+    batch.msgs.push_back(CreateAccountMsg{VerifyKey(), Ident("alice")});
+    batch.msgs.push_back(MintTokenMsg{Ident("Band"), 100});
+    batch.msgs.push_back(TransferTokenMsg{Ident("Band"), Ident("alice"), 60});
+    const std::string raw = transaction(1, batch);
+    auto res = Buffer::deserialize<BatchResponse>(
+        manager.applyTransaction(gsl::as_bytes(gsl::make_span(raw))));
+
+    TS_ASSERT_EQUALS(3, res.responses.size());
+    TS_ASSERT_EQUALS(+MsgType::CreateAccount, res.responses[0].type());
+    TS_ASSERT_EQUALS(+MsgType::TransferToken, res.responses[2].type());
+    TS_ASSERT_EQUALS(2, seen.size());
+    TS_ASSERT_EQUALS("create alice", seen[0]);
+    TS_ASSERT_EQUALS("transfer alice", seen[1]);
+
+    // The last transfer exceeds the balance, so the whole batch is reverted
+    // and no listener hears about any of it.
+    batch.msgs.clear();
+    batch.msgs.push_back(CreateAccountMsg{VerifyKey(), Ident("bob")});
+    batch.msgs.push_back(TransferTokenMsg{Ident("Band"), Ident("bob"), 10});
+    batch.msgs.push_back(TransferTokenMsg{Ident("Band"), Ident("bob"), 50});
+    const std::string rawFailing = transaction(2, batch);
+    TS_ASSERT_THROWS(
+        manager.applyTransaction(gsl::as_bytes(gsl::make_span(rawFailing))),
+        const Error&);
+    TS_ASSERT_EQUALS(2, seen.size());
+
+    storage.switchToApply();
+    TS_ASSERT(storage.get("u/alice").has_value());
+    TS_ASSERT(!storage.get("u/bob").has_value());
+    storage.reset();
+  }
+
+private:
+  static std::string transaction(uint64_t nonce, const BatchMsg& batch)
+  {
+    Buffer buf;
+    buf << Ident("BandGod") << Signature() << nonce;
+    buf << MsgType(MsgType::Batch) << batch;
+    return buf.to_raw_string();
+  }
+};
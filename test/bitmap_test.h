@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include <vector>
+
+#include "inc/essential.h"
+#include "counting_storage.h"
+#include "store/bitmap.h"
+#include "store/contract.h"
+#include "store/storage_map.h"
+#include "util/string.h"
+
+class TestBitmapContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+  BITMAP(flags)
+};
+
+class BitmapTest : public CxxTest::TestSuite
+{
+public:
+  void testSetClearAndIterate()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestBitmapContract>(Ident{"bitmap"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+      TS_ASSERT(flags.set(3));
+      TS_ASSERT(flags.set(70000));
+      TS_ASSERT(flags.set(1));
+      TS_ASSERT(!flags.set(3));
+      TS_ASSERT(flags.set(4000000000));
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+      TS_ASSERT(flags.test(3));
+      TS_ASSERT(!flags.test(2));
+      TS_ASSERT(flags.test(70000));
+      TS_ASSERT_EQUALS(4, flags.count());
+
+      std::vector<uint32_t> ids;
+      flags.forEach([&](uint32_t id) { ids.push_back(id); });
+      TS_ASSERT(ids == std::vector<uint32_t>({1, 3, 70000, 4000000000}));
+
+      TS_ASSERT(flags.clear(70000));
+      TS_ASSERT(!flags.clear(70000));
+      storage.flush();
+    }
+
+    // The emptied chunk is deleted. The contract, the chunk list and two
+    // chunks remain.
+    TS_ASSERT_EQUALS(4, storage.applyCache.size());
+  }
+
+  void testDenseChunk()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestBitmapContract>(Ident{"bitmap"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+      for (uint32_t id = 0; id < 20000; id += 2)
+        flags.set(id);
+      storage.flush();
+    }
+
+    // 10000 IDs in one chunk are kept as a bitset.
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(1 + 8 * Bitmap::WordsPerBitset,
+                     storage.get("test/bitmap/flags/0")->size());
+    {
+      storage.switchToApply();
+      auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+      TS_ASSERT_EQUALS(10000, flags.count());
+      TS_ASSERT(flags.test(19998));
+      TS_ASSERT(!flags.test(19999));
+      for (uint32_t id = 0; id < 12000; id += 2)
+        flags.clear(id);
+      storage.flush();
+    }
+
+    // Back to an array once it gets sparse.
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(1 + 2 * 4000, storage.get("test/bitmap/flags/0")->size());
+    {
+      storage.switchToApply();
+      auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+      TS_ASSERT_EQUALS(4000, flags.count());
+      uint32_t expected = 12000;
+      flags.forEach([&](uint32_t id) {
+        TS_ASSERT_EQUALS(expected, id);
+        expected += 2;
+      });
+    }
+  }
+
+  void testUnchangedChunkIsNotWritten()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestBitmapContract>(Ident{"bitmap"});
+    backend.load<TestBitmapContract>(Ident{"bitmap"}).flags.set(5);
+    backend.flush();
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    auto& flags = storage.load<TestBitmapContract>(Ident{"bitmap"}).flags;
+    flags.set(5);
+    flags.set(6);
+    flags.clear(6);
+    storage.flush();
+    TS_ASSERT_EQUALS(0, storage.writes());
+  }
+};
@@ -120,6 +120,170 @@ public:
     TS_ASSERT_EQUALS(0, buf.size_bytes());
   }
 
+  void testStreamReadWrite(void)
+  {
+    // Interleave writes and reads on a long-lived buffer, as a session does.
+    Buffer buf;
+    uint64_t next = 0;
+    for (uint64_t idx = 0; idx < 20000; ++idx) {
+      buf << idx << std::string(idx % 7, 'x');
+      if (idx % 3 == 2) {
+        while (!buf.empty()) {
+          TS_ASSERT_EQUALS(next, buf.read<uint64_t>());
+          TS_ASSERT_EQUALS(next % 7, buf.read<std::string>().size());
+          ++next;
+        }
+      }
+    }
+    TS_ASSERT_EQUALS(next, 19998);
+    TS_ASSERT_EQUALS(19998, buf.read<uint64_t>());
+
+    std::byte b;
+    buf.clear();
+    TS_ASSERT_THROWS_ANYTHING(buf >> b);
+    TS_ASSERT_THROWS_ANYTHING(buf.consume(1));
+  }
+
+  void testGrowBeyondInlineStorage(void)
+  {
+    // Alternate small and large buffers so that heap storage is recycled.
+    for (int round = 0; round < 40; ++round) {
+      Buffer buf;
+      buf << std::byte{0x01};
+      std::string large(Buffer::InlineCapacity * (round % 5 + 1), 'a' + round);
+      buf << large;
+      TS_ASSERT_EQUALS(std::byte{0x01}, buf.read<std::byte>());
+
+      Buffer moved(std::move(buf));
+      TS_ASSERT(buf.empty());
+      TS_ASSERT_EQUALS(large, moved.read<std::string>());
+      TS_ASSERT(moved.empty());
+    }
+  }
+
+  void testSerializeInto(void)
+  {
+    std::string dest(300, 'z');
+    Buffer::serializeInto(std::string("band"), dest);
+    TS_ASSERT_EQUALS(Buffer::serialize(std::string("band")), dest);
+    TS_ASSERT_EQUALS("band", Buffer::deserialize<std::string>(dest));
+
+    Buffer buf;
+    buf << uint64_t(300) << uint64_t(5);
+    buf.consume(2);
+    buf.serializeInto(dest);
+    TS_ASSERT_EQUALS(1, dest.size());
+    TS_ASSERT_EQUALS(5, Buffer::deserialize<uint64_t>(dest));
+  }
+
+  void testPrepareCommit(void)
+  {
+    Buffer buf;
+    buf << std::byte(1) << std::byte(2);
+    buf.consume(1);
+
+    // Fill part of the prepared space in place, as a socket read would.
+    auto tail = buf.prepare(1000);
+    TS_ASSERT_EQUALS(1000, tail.size());
+    for (size_t idx = 0; idx < 300; ++idx)
+      tail[idx] = std::byte(idx);
+    buf.commit(300);
+
+    TS_ASSERT_EQUALS(301, buf.size_bytes());
+    TS_ASSERT_EQUALS(std::byte(2), buf.read<std::byte>());
+    for (size_t idx = 0; idx < 300; ++idx)
+      TS_ASSERT_EQUALS(std::byte(idx), buf.read<std::byte>());
+    TS_ASSERT(buf.empty());
+
+    buf.prepare(10);
+    buf.commit(0);
+    TS_ASSERT(buf.empty());
+  }
+
+  void testView(void)
+  {
+    std::string raw = Buffer::serialize(std::string("band")) +
+                      Buffer::serialize(uint64_t(300));
+    Buffer view = Buffer::view(gsl::as_bytes(gsl::make_span(raw)));
+    TS_ASSERT_EQUALS(raw.size(), size_t(view.size_bytes()));
+    // The view reads the data in place.
+    TS_ASSERT_EQUALS((const void*)raw.data(),
+                     (const void*)view.as_const_span().data());
+    TS_ASSERT_EQUALS("band", view.read<std::string>());
+
+    // Moving a view keeps reading the same data.
+    Buffer moved(std::move(view));
+    TS_ASSERT(view.empty());
+    TS_ASSERT_EQUALS(300, moved.read<uint64_t>());
+    TS_ASSERT(moved.empty());
+    TS_ASSERT_THROWS_ANYTHING(moved.read<std::byte>());
+
+    // Writing copies the unread data first, so the source may then change.
+    Buffer written = Buffer::view(gsl::as_bytes(gsl::make_span(raw)));
+    written.consume(1);
+    written << std::byte(7);
+    raw.assign(raw.size(), 'x');
+    TS_ASSERT_EQUALS("band", std::string((const char*)written.as_span().data(),
+                                         4));
+    written.consume(6);
+    TS_ASSERT_EQUALS(std::byte(7), written.read<std::byte>());
+    TS_ASSERT(written.empty());
+  }
+
+  void testStringLengthIsChecked(void)
+  {
+    // A length beyond the data is rejected before allocating for it.
+    Buffer buf;
+    buf << (uint64_t(1) << 40) << std::string("band");
+    TS_ASSERT_THROWS(buf.read<std::string>(), const Error&);
+  }
+
+  void testHexRoundTrip(void)
+  {
+    // Cover every code path the CPU supports, both the vectorized blocks and
+    // the byte-wise tails.
+    const HexPath best = hex_best_path();
+    for (HexPath path : {HexPath::Scalar, HexPath::SSSE3, HexPath::AVX2}) {
+      if (path > best) {
+        TS_ASSERT_THROWS_ANYTHING(bytes_to_hex({}, path));
+        continue;
+      }
+
+      std::vector<std::byte> data;
+      std::string expected;
+      for (int idx = 0; idx < 77; ++idx) {
+        const int value = (idx * 37 + 11) % 256;
+        data.push_back(std::byte(value));
+        expected += "0123456789abcdef"[value >> 4];
+        expected += "0123456789abcdef"[value & 0xF];
+
+        TS_ASSERT_EQUALS(expected, bytes_to_hex(gsl::make_span(data), path));
+        std::vector<std::byte> decoded(data.size());
+        hex_to_bytes(expected, gsl::make_span(decoded), path);
+        TS_ASSERT_EQUALS(data, decoded);
+      }
+
+      std::vector<std::byte> out(16);
+      for (char bad : {'g', 'G', ' ', '/', ':', '@', '`', '\xc1'}) {
+        std::string hex(32, 'a');
+        hex[5] = bad;
+        TS_ASSERT_THROWS_ANYTHING(
+            hex_to_bytes(hex, gsl::make_span(out), path));
+        hex[5] = 'a';
+        hex[31] = bad;
+        TS_ASSERT_THROWS_ANYTHING(
+            hex_to_bytes(hex, gsl::make_span(out), path));
+      }
+    }
+
+    const auto hash = Hash::hex(
+        "6D6A7A8B9CADBEEF00112233445566778899AABBCCDDEEFF0123456789abcdef");
+    TS_ASSERT_EQUALS(
+        "6d6a7a8b9cadbeef00112233445566778899aabbccddeeff0123456789abcdef",
+        hash.to_string());
+    TS_ASSERT_THROWS_ANYTHING(Hash::hex("abcd"));
+  }
+
   // void testAddOtherSpanToBuffer(void)
   // {
   //   std::vector<Bytes<17>> address;
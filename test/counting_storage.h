@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include "inc/essential.h"
+#include "store/storage.h"
+
+/// CountingStorage forwards every operation to another storage and counts the
+/// reads and writes that reach it. Tests use it to check how many times a
+/// field touches the storage.
+class CountingStorage : public Storage
+{
+public:
+  CountingStorage(Storage& _backend)
+      : backend(_backend)
+  {
+  }
+
+  nonstd::optional<std::string> get(const std::string& key) const final
+  {
+    ++gets;
+    return backend.get(key);
+  }
+
+  void put(const std::string& key, const std::string& val) final
+  {
+    ++puts;
+    backend.put(key, val);
+  }
+
+  void del(const std::string& key) final
+  {
+    ++dels;
+    backend.del(key);
+  }
+
+  void add(const std::string& key, const uint256_t& delta) final
+  {
+    ++adds;
+    backend.add(key, delta);
+  }
+
+  void commit() final
+  {
+    backend.commit();
+  }
+
+  void switchToCheck() final
+  {
+    backend.switchToCheck();
+  }
+
+  void switchToApply() final
+  {
+    backend.switchToApply();
+  }
+
+  /// The number of writes of any kind.
+  int writes() const
+  {
+    return puts + dels + adds;
+  }
+
+public:
+  mutable int gets = 0;
+  int puts = 0;
+  int dels = 0;
+  int adds = 0;
+
+private:
+  /// The storage to which all operations are forwarded.
+  Storage& backend;
+};
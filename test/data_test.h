@@ -0,0 +1,178 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "counting_storage.h"
+#include "inc/essential.h"
+#include "listener/primary.h"
+#include "store/contract.h"
+#include "store/data.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
+#include "util/string.h"
+
+class TestDataContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+  DATA(uint256_t, counter)
+};
+
+class DataTest : public CxxTest::TestSuite
+{
+public:
+  void testAddWithoutRead()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestDataContract>(Ident{"data"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter.add(5);
+      dataContract.counter.add(7);
+      TS_ASSERT(dataContract.counter.exist());
+      storage.flush();
+    }
+    // The delta must reach the storage without ever reading the value.
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(12, Buffer::deserialize<uint256_t>(
+                             *storage.get("test/data/counter")));
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter.add(30);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      TS_ASSERT_EQUALS(42, +dataContract.counter);
+    }
+  }
+
+  void testAddAfterRead()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestDataContract>(Ident{"data"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter = 10;
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter.add(3);
+      // Reading folds the pending delta into the loaded value.
+      TS_ASSERT_EQUALS(13, +dataContract.counter);
+      dataContract.counter.add(4);
+      TS_ASSERT_EQUALS(17, +dataContract.counter);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      TS_ASSERT_EQUALS(17, +dataContract.counter);
+      dataContract.counter.erase();
+      dataContract.counter.add(2);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      TS_ASSERT_EQUALS(2, +dataContract.counter);
+    }
+  }
+
+  void testUnchangedValueIsNotWritten()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestDataContract>(Ident{"data"});
+    backend.load<TestDataContract>(Ident{"data"}).counter = 10;
+    backend.flush();
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+    dataContract.counter = +dataContract.counter;
+    dataContract.counter.add(0);
+    storage.flush();
+    TS_ASSERT_EQUALS(0, storage.writes());
+  }
+
+  void testMergedOverflowFailsFlush()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestDataContract>(Ident{"data"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter.add(std::numeric_limits<uint256_t>::max());
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& dataContract = storage.load<TestDataContract>(Ident{"data"});
+      dataContract.counter.add(1);
+      // The overflow surfaces from flush, where the transaction can still
+      // fail, instead of from the destructor writing the value back.
+      TS_ASSERT_THROWS(storage.flush(), const std::overflow_error&);
+      storage.reset();
+    }
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(std::numeric_limits<uint256_t>::max(),
+                     Buffer::deserialize<uint256_t>(
+                         *storage.get("test/data/counter")));
+  }
+
+  void testMintPastLimit()
+  {
+    StorageMap storage;
+    PrimaryListener primary(storage);
+    primary.init({Ident("BandGod"), VerifyKey(), Ident("Band")},
+                 {{Ident("alice"), VerifyKey(), 0}});
+    const BlockMsg blk{};
+    HeaderMsg hdr{};
+    hdr.user = Ident("BandGod");
+    primary.process(blk, hdr,
+                    MintTokenMsg{Ident("Band"),
+                                 std::numeric_limits<uint256_t>::max()});
+
+    // Alice holds nothing, so only the supply overflows. The mint fails like
+    // any other transaction and the supply is left as it was.
+    hdr.user = Ident("alice");
+    TS_ASSERT_THROWS(primary.process(blk, hdr, MintTokenMsg{Ident("Band"), 1}),
+                     const std::overflow_error&);
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(std::numeric_limits<uint256_t>::max(),
+                     Buffer::deserialize<uint256_t>(
+                         *storage.get("t/band/currentSupply")));
+    storage.reset();
+  }
+};
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "inc/essential.h"
+#include "store/contract.h"
+#include "store/deadline_queue.h"
+#include "store/storage_map.h"
+#include "util/string.h"
+
+class TestDeadlineQueueContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+  DEADLINE_QUEUE(uint64_t, queue)
+};
+
+class DeadlineQueueTest : public CxxTest::TestSuite
+{
+public:
+  void testPopDueInOrder()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestDeadlineQueueContract>(Ident{"queue"});
+    storage.flush();
+
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<uint64_t, uint64_t>> expected;
+    std::vector<uint64_t> deadlines;
+    {
+      storage.switchToApply();
+      auto& contract = storage.load<TestDeadlineQueueContract>(Ident{"queue"});
+      for (uint64_t id = 0; id < 500; ++id) {
+        uint64_t deadline = rng() % 100;
+        contract.queue.push(deadline, id);
+        expected.emplace_back(deadline, id);
+        deadlines.push_back(deadline);
+      }
+      storage.flush();
+    }
+    // Ties are broken by insertion order, which is also the order of ids.
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<std::pair<uint64_t, uint64_t>> actual;
+    for (uint64_t now = 0; now < 100; now += 10) {
+      storage.switchToApply();
+      auto& contract = storage.load<TestDeadlineQueueContract>(Ident{"queue"});
+      auto due = contract.queue.popDue(now, 1000);
+      for (auto id : due) {
+        TS_ASSERT(deadlines[id] <= now);
+        actual.emplace_back(deadlines[id], id);
+      }
+      if (auto next = contract.queue.nextDeadline(); next)
+        TS_ASSERT(*next > now);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& contract = storage.load<TestDeadlineQueueContract>(Ident{"queue"});
+      auto due = contract.queue.popDue(1000, 1000);
+      for (auto id : due)
+        actual.emplace_back(deadlines[id], id);
+      TS_ASSERT_EQUALS(0, contract.queue.size());
+      storage.flush();
+    }
+    TS_ASSERT(expected == actual);
+
+    // Every slot is removed from the storage once the queue drains.
+    storage.switchToApply();
+    TS_ASSERT(!storage.get("test/queue/queue/0").has_value());
+  }
+
+  void testPopDueLimit()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestDeadlineQueueContract>(Ident{"queue"});
+    storage.flush();
+
+    storage.switchToApply();
+    auto& contract = storage.load<TestDeadlineQueueContract>(Ident{"queue"});
+    contract.queue.push(5, 1);
+    contract.queue.push(3, 2);
+    contract.queue.push(8, 3);
+    contract.queue.push(3, 4);
+
+    TS_ASSERT(contract.queue.popDue(5, 1) == std::vector<uint64_t>({2}));
+    TS_ASSERT(contract.queue.popDue(5, 10) == std::vector<uint64_t>({4, 1}));
+    TS_ASSERT(contract.queue.popDue(7, 10).empty());
+    TS_ASSERT_EQUALS(8, *contract.queue.nextDeadline());
+  }
+};
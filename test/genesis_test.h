@@ -0,0 +1,142 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "contract/account.h"
+#include "contract/registry.h"
+#include "contract/token.h"
+#include "inc/essential.h"
+#include "listener/manager.h"
+#include "listener/primary.h"
+#include "store/paged_array.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
+#include "util/json.h"
+
+class GenesisTest : public CxxTest::TestSuite
+{
+public:
+  void testBulkLoadAccounts()
+  {
+    json state;
+    state["account"] = "BandGod";
+    state["token"] = "Band";
+    state["accounts"] = json::array();
+    for (int idx = 0; idx < 1000; ++idx) {
+      json account;
+      account["user"] = "user{}"_format(idx);
+      account["verifyKey"] = VerifyKey::rand().to_string();
+      account["balance"] = std::to_string(idx);
+      state["accounts"].push_back(account);
+    }
+    const std::string raw = state.dump();
+
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain(gsl::as_bytes(gsl::make_span(raw)));
+
+    storage.switchToApply();
+    PagedArray<uint256_t> balances(storage, Token::balancesKey(Ident("Band")));
+    auto& richest = storage.load<Account>(Ident("user999"));
+    TS_ASSERT_EQUALS(999, balances.get(richest.getNumber()));
+    auto& poorest = storage.load<Account>(Ident("user0"));
+    TS_ASSERT_EQUALS(0, balances.get(poorest.getNumber()));
+    TS_ASSERT_DIFFERS(richest.getNumber(), poorest.getNumber());
+
+    // The balances are usable right away.
+    auto& token = storage.load<Token>(Ident("Band"));
+    token.transfer(Ident("user999"), Ident("user0"), 999);
+    TS_ASSERT_THROWS_ANYTHING(
+        token.transfer(Ident("user999"), Ident("user0"), 1));
+  }
+
+  void testTransferToUnregisteredHolder()
+  {
+    json account;
+    account["user"] = "alice";
+    account["verifyKey"] = VerifyKey::rand().to_string();
+    account["balance"] = "100";
+    json state;
+    state["account"] = "BandGod";
+    state["token"] = "Band";
+    state["accounts"] = json::array({account});
+    const std::string raw = state.dump();
+
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain(gsl::as_bytes(gsl::make_span(raw)));
+
+    // Carol has no account, but can still hold tokens.
+    storage.switchToApply();
+    storage.load<Token>(Ident("Band")).transfer(Ident("alice"), Ident("carol"),
+                                                30);
+    storage.flush();
+
+    storage.switchToApply();
+    auto& token = storage.load<Token>(Ident("Band"));
+    TS_ASSERT_THROWS_ANYTHING(
+        token.transfer(Ident("carol"), Ident("alice"), 31));
+    token.transfer(Ident("carol"), Ident("alice"), 30);
+    token.transfer(Ident("alice"), Ident("alice"), 100);
+    TS_ASSERT_THROWS_ANYTHING(
+        token.transfer(Ident("alice"), Ident("carol"), 101));
+  }
+
+  void testDuplicateAccount()
+  {
+    json account;
+    account["user"] = "alice";
+    account["verifyKey"] = VerifyKey::rand().to_string();
+    json state;
+    state["accounts"] = json::array({account, account});
+    const std::string raw = state.dump();
+
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    TS_ASSERT_THROWS_ANYTHING(
+        manager.initChain(gsl::as_bytes(gsl::make_span(raw))));
+
+    // Nothing is written before the whole genesis is checked.
+    storage.switchToApply();
+    TS_ASSERT(!storage.get(Registry::accountCountKey()));
+    TS_ASSERT(!storage.get(Account::numberKey(Ident("BandGod"))));
+    TS_ASSERT(!storage.get(Account::numberKey(Ident("alice"))));
+  }
+
+  void testParseKeysInAnyOrder()
+  {
+    const std::string raw =
+        R"({"accounts": [{"user": "alice", "balance": "7", "verifyKey": ")" +
+        VerifyKey::rand().to_string() +
+        R"("}], "extra": [{"user": "mallory"}], "token": "Coin"})";
+
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain(gsl::as_bytes(gsl::make_span(raw)));
+
+    storage.switchToApply();
+    TS_ASSERT(!storage.get(Account::numberKey(Ident("mallory"))));
+    PagedArray<uint256_t> balances(storage, Token::balancesKey(Ident("Coin")));
+    auto& alice = storage.load<Account>(Ident("alice"));
+    TS_ASSERT_EQUALS(7, balances.get(alice.getNumber()));
+  }
+};
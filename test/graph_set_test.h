@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "inc/essential.h"
+#include "store/graph_set.h"
+#include "store/node_interner.h"
+#include "util/string.h"
+
+class GraphSetTest : public CxxTest::TestSuite
+{
+public:
+  void testInternIsDense()
+  {
+    NodeInterner interner;
+    TS_ASSERT_EQUALS(0, interner.intern(NodeID{"alice"}));
+    TS_ASSERT_EQUALS(1, interner.intern(NodeID{"knows"}));
+    TS_ASSERT_EQUALS(0, interner.intern(NodeID{"alice"}));
+    TS_ASSERT_EQUALS(2, interner.intern(NodeID{"bob"}));
+    TS_ASSERT_EQUALS(3, interner.size());
+
+    TS_ASSERT_EQUALS(NodeID{"bob"}, interner.get(2));
+    TS_ASSERT_EQUALS(1, *interner.find(NodeID{"knows"}));
+    TS_ASSERT(!interner.find(NodeID{"carol"}));
+    TS_ASSERT_THROWS(interner.get(3), const Error&);
+  }
+
+  void testAddAndDeleteEdge()
+  {
+    GraphStoreSet graph;
+    NodeID alice{"alice"}, bob{"bob"}, knows{"knows"}, label{""};
+    Quad ab = graph.intern(alice, knows, bob, label);
+    Quad ba = graph.intern(bob, knows, alice, label);
+    TS_ASSERT_EQUALS(ab.predicate, ba.predicate);
+    TS_ASSERT_EQUALS(4, graph.get_nodes().size());
+
+    graph.add_edge(ab);
+    graph.add_edge(ba);
+    graph.add_edge(ab);
+    TS_ASSERT_EQUALS(2, graph.size());
+
+    // Edges that only differ in their object must not collide.
+    graph.delete_edge(ba);
+    TS_ASSERT(graph.has_edge(ab));
+    TS_ASSERT(!graph.has_edge(ba));
+    TS_ASSERT_EQUALS(1, graph.size());
+  }
+
+  void testFindDoesNotIntern()
+  {
+    GraphStoreSet graph;
+    NodeID alice{"alice"}, bob{"bob"}, knows{"knows"}, label{""};
+    Quad ab = graph.intern(alice, knows, bob, label);
+    TS_ASSERT(graph.find(alice, knows, bob, label) == ab);
+    TS_ASSERT(!graph.find(alice, knows, NodeID{"carol"}, label));
+    TS_ASSERT_EQUALS(4, graph.get_nodes().size());
+  }
+};
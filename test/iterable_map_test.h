@@ -0,0 +1,198 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include "counting_storage.h"
+#include "inc/essential.h"
+#include "store/contract.h"
+#include "store/iterable_map.h"
+#include "store/storage_map.h"
+#include "util/string.h"
+
+class TestIterableMapContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+  ITERABLE_MAP(uint32_t, uint256_t, m)
+};
+
+class TestSmallPageContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+
+  /// Tiny pages to exercise page splits and removals.
+  IterableMap<uint32_t, uint32_t, 4> m{storage, key, "/m/"};
+};
+
+class IterableMapTest : public CxxTest::TestSuite
+{
+public:
+  void testContractField()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestIterableMapContract>(Ident{"map"});
+    {
+      storage.switchToApply();
+      auto& mapContract = storage.load<TestIterableMapContract>(Ident{"map"});
+      mapContract.m.set(7, 70);
+      mapContract.m.set(3, 30);
+      mapContract.m.set(5, 50);
+      mapContract.m.set(3, 33);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& mapContract = storage.load<TestIterableMapContract>(Ident{"map"});
+      TS_ASSERT_EQUALS(3, mapContract.m.size());
+      TS_ASSERT_EQUALS(33, *mapContract.m.get(3));
+      TS_ASSERT(!mapContract.m.contains(4));
+
+      auto it = mapContract.m.begin();
+      TS_ASSERT_EQUALS(3, it.key());
+      TS_ASSERT_EQUALS(50, (++it).value());
+      TS_ASSERT_EQUALS(7, (++it).key());
+      TS_ASSERT(++it == mapContract.m.end());
+    }
+  }
+
+  void testOrderAcrossPages()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestSmallPageContract>(Ident{"map"});
+    storage.flush();
+
+    std::map<uint32_t, uint32_t> model;
+    std::mt19937 rng(7);
+    for (int round = 0; round < 5; ++round) {
+      {
+        storage.switchToApply();
+        auto& map = storage.load<TestSmallPageContract>(Ident{"map"}).m;
+        for (int op = 0; op < 300; ++op) {
+          const uint32_t key = rng() % 400;
+          if (rng() % 3 == 0) {
+            TS_ASSERT_EQUALS(model.erase(key) == 1, map.erase(key));
+          } else {
+            map.set(key, key * 10 + round);
+            model[key] = key * 10 + round;
+          }
+        }
+        storage.flush();
+      }
+
+      storage.switchToApply();
+      auto& map = storage.load<TestSmallPageContract>(Ident{"map"}).m;
+      TS_ASSERT_EQUALS(model.size(), map.size());
+
+      // Forward.
+      auto modelIt = model.begin();
+      for (auto it = map.begin(); it != map.end(); ++it, ++modelIt) {
+        TS_ASSERT_EQUALS(modelIt->first, it.key());
+        TS_ASSERT_EQUALS(modelIt->second, it.value());
+      }
+      TS_ASSERT(modelIt == model.end());
+
+      // Backward.
+      auto it = map.end();
+      for (auto modelIt = model.rbegin(); modelIt != model.rend(); ++modelIt)
+        TS_ASSERT_EQUALS(modelIt->first, (--it).key());
+      TS_ASSERT(it == map.begin());
+
+      // Lower bound.
+      for (uint32_t key = 0; key < 410; key += 37) {
+        auto modelIt = model.lower_bound(key);
+        auto it = map.lowerBound(key);
+        TS_ASSERT_EQUALS(modelIt == model.end(), it == map.end());
+        if (modelIt != model.end() && it != map.end())
+          TS_ASSERT_EQUALS(modelIt->first, it.key());
+      }
+      storage.reset();
+    }
+  }
+
+  void testEraseEverything()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestSmallPageContract>(Ident{"map"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& map = storage.load<TestSmallPageContract>(Ident{"map"}).m;
+      for (uint32_t key = 0; key < 20; ++key)
+        map.set(key, key);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& map = storage.load<TestSmallPageContract>(Ident{"map"}).m;
+      for (uint32_t key = 0; key < 20; ++key)
+        TS_ASSERT(map.erase(key));
+      TS_ASSERT(!map.erase(0));
+      TS_ASSERT(map.begin() == map.end());
+      storage.flush();
+    }
+
+    // Only the contract, the empty directory and the zero size remain.
+    TS_ASSERT_EQUALS(3, storage.applyCache.size());
+  }
+
+  void testDirectoryIsPaged()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestSmallPageContract>(Ident{"map"});
+    auto& map = backend.load<TestSmallPageContract>(Ident{"map"}).m;
+    for (uint32_t key = 0; key < 1000; ++key)
+      map.set(2 * key, key);
+    backend.flush();
+
+    size_t segments = 0;
+    for (const auto& [key, value] : backend.applyCache)
+      segments += key.find("/m/s/") != std::string::npos;
+    TS_ASSERT_LESS_THAN(10, segments);
+
+    // Adding a key rewrites its value, its page and the size. The root of the
+    // directory is left alone.
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    storage.load<TestSmallPageContract>(Ident{"map"}).m.set(1001, 0);
+    storage.flush();
+    TS_ASSERT_EQUALS(3, storage.puts);
+
+    backend.switchToApply();
+    auto& loaded = backend.load<TestSmallPageContract>(Ident{"map"}).m;
+    TS_ASSERT_EQUALS(1001, loaded.size());
+    TS_ASSERT_EQUALS(1001, loaded.lowerBound(1001).key());
+    TS_ASSERT_EQUALS(1002, (++loaded.lowerBound(1001)).key());
+  }
+};
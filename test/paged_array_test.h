@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "counting_storage.h"
+#include "inc/essential.h"
+#include "store/contract.h"
+#include "store/paged_array.h"
+#include "store/storage_map.h"
+#include "util/string.h"
+
+class TestPagedArrayContract final : public Contract
+{
+public:
+  using Contract::Contract;
+
+  static constexpr char KeyPrefix[] = "test/";
+
+  void init() {}
+  PAGED_ARRAY(uint256_t, values)
+};
+
+class PagedArrayTest : public CxxTest::TestSuite
+{
+public:
+  void testSetAndAdd()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestPagedArrayContract>(Ident{"array"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& contract = storage.load<TestPagedArrayContract>(Ident{"array"});
+      contract.values.set(3, 30);
+      contract.values.add(3, 5);
+      contract.values.add(1000, 7);
+      TS_ASSERT_EQUALS(35, contract.values.get(3));
+      TS_ASSERT_EQUALS(0, contract.values.get(4));
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& contract = storage.load<TestPagedArrayContract>(Ident{"array"});
+      TS_ASSERT_EQUALS(35, contract.values.get(3));
+      TS_ASSERT_EQUALS(7, contract.values.get(1000));
+      TS_ASSERT_EQUALS(0, contract.values.get(999));
+    }
+
+    // Elements 3 and 1000 live in pages 0 and 15 only.
+    storage.switchToApply();
+    TS_ASSERT(storage.get("test/array/values/0").has_value());
+    TS_ASSERT(storage.get("test/array/values/15").has_value());
+    TS_ASSERT(!storage.get("test/array/values/1").has_value());
+  }
+
+  void testUntouchedPageIsNotWritten()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestPagedArrayContract>(Ident{"array"});
+    storage.flush();
+    {
+      storage.switchToApply();
+      auto& contract = storage.load<TestPagedArrayContract>(Ident{"array"});
+      contract.values.add(70, 0);
+      TS_ASSERT_EQUALS(0, contract.values.get(5));
+      storage.flush();
+    }
+    storage.switchToApply();
+    TS_ASSERT(!storage.get("test/array/values/0").has_value());
+    TS_ASSERT(!storage.get("test/array/values/1").has_value());
+  }
+
+  void testAddWithoutRead()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestPagedArrayContract>(Ident{"array"});
+    backend.load<TestPagedArrayContract>(Ident{"array"}).values.set(3, 30);
+    backend.flush();
+
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    auto& contract = storage.load<TestPagedArrayContract>(Ident{"array"});
+    const int gets = storage.gets;
+    contract.values.add(3, 5);
+    contract.values.add(3, 2);
+    contract.values.add(1000, 7);
+    // The deltas are only recorded until the flush folds them into the pages.
+    TS_ASSERT_EQUALS(gets, storage.gets);
+    storage.flush();
+
+    storage.switchToApply();
+    auto& reloaded = storage.load<TestPagedArrayContract>(Ident{"array"});
+    TS_ASSERT_EQUALS(37, reloaded.values.get(3));
+    TS_ASSERT_EQUALS(7, reloaded.values.get(1000));
+    // Reading a page folds the deltas pending on it.
+    reloaded.values.add(4, 1);
+    reloaded.values.add(70, 2);
+    TS_ASSERT_EQUALS(1, reloaded.values.get(4));
+    storage.flush();
+
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(
+        2, storage.load<TestPagedArrayContract>(Ident{"array"}).values.get(70));
+  }
+
+  void testMergedOverflowFailsFlush()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestPagedArrayContract>(Ident{"array"});
+    storage.load<TestPagedArrayContract>(Ident{"array"})
+        .values.set(3, std::numeric_limits<uint256_t>::max());
+    storage.flush();
+
+    storage.switchToApply();
+    storage.load<TestPagedArrayContract>(Ident{"array"}).values.add(3, 1);
+    TS_ASSERT_THROWS(storage.flush(), const std::overflow_error&);
+    storage.reset();
+
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(
+        std::numeric_limits<uint256_t>::max(),
+        storage.load<TestPagedArrayContract>(Ident{"array"}).values.get(3));
+  }
+};
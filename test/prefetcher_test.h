@@ -0,0 +1,125 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "contract/account.h"
+#include "contract/registry.h"
+#include "contract/token.h"
+#include "inc/essential.h"
+#include "listener/prefetcher.h"
+#include "listener/primary.h"
+#include "store/paged_array.h"
+#include "store/storage_cache.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
+
+class PrefetcherTest : public CxxTest::TestSuite
+{
+public:
+  void testPrefetchTransfer()
+  {
+    StorageMap backend;
+    PrimaryListener primary(backend);
+    primary.init({Ident("BandGod"), VerifyKey(), Ident("Band")},
+                 {{Ident("alice"), VerifyKey(), 100},
+                  {Ident("bob"), VerifyKey(), 0}});
+    StorageCache cache(backend, false);
+    TS_ASSERT(!cache.peek("u/alice").has_value());
+
+    Buffer buf;
+    buf << Ident("alice") << Signature() << uint64_t(1);
+    buf << MsgType(MsgType::TransferToken);
+    buf << TransferTokenMsg{Ident("Band"), Ident("bob"), 10};
+    const std::string raw = buf.to_raw_string();
+
+    Prefetcher prefetcher(cache);
+    prefetcher.enqueue(gsl::as_bytes(gsl::make_span(raw)));
+    prefetcher.wait();
+
+    // Both accounts, the token and both balances are in the read cache.
+    TS_ASSERT(cache.peek("u/alice").has_value());
+    TS_ASSERT(cache.peek("u/bob").has_value());
+    TS_ASSERT(cache.peek(Account::numberKey(Ident("bob"))).has_value());
+    TS_ASSERT(cache.peek(Account::nonceKey(Ident("alice"))).has_value());
+    TS_ASSERT(cache.peek("t/band").has_value());
+    TS_ASSERT(cache.peek(Token::curveDataKey(Ident("Band"))).has_value());
+    TS_ASSERT(cache.peek(Token::currentSupplyKey(Ident("Band"))).has_value());
+
+    backend.switchToApply();
+    auto& alice = backend.load<Account>(Ident("alice"));
+    auto& bob = backend.load<Account>(Ident("bob"));
+    for (const uint32_t number : {alice.getNumber(), bob.getNumber()}) {
+      const auto key = PagedArray<uint256_t>::pageKey(
+          Token::balancesKey(Ident("Band")),
+          number / PagedArray<uint256_t>::ElementsPerPage);
+      TS_ASSERT(cache.peek(key).has_value());
+    }
+    backend.reset();
+  }
+
+  void testPrefetchTransferToUnregisteredHolder()
+  {
+    // Enough genesis accounts that the number reserved for carol falls on a
+    // page of its own.
+    std::vector<GenesisAccount> accounts{{Ident("alice"), VerifyKey(), 100}};
+    for (int idx = 0; idx < 70; ++idx)
+      accounts.push_back({Ident("user" + std::to_string(idx)), VerifyKey(), 0});
+    StorageMap backend;
+    PrimaryListener primary(backend);
+    primary.init({Ident("BandGod"), VerifyKey(), Ident("Band")}, accounts);
+
+    backend.switchToApply();
+    backend.load<Token>(Ident("Band"))
+        .transfer(Ident("alice"), Ident("carol"), 10);
+    backend.flush();
+    backend.commit();
+
+    Buffer buf;
+    buf << Ident("alice") << Signature() << uint64_t(1);
+    buf << MsgType(MsgType::TransferToken);
+    buf << TransferTokenMsg{Ident("Band"), Ident("carol"), 10};
+    const std::string raw = buf.to_raw_string();
+
+    StorageCache cache(backend, false);
+    Prefetcher prefetcher(cache);
+    prefetcher.enqueue(gsl::as_bytes(gsl::make_span(raw)));
+    prefetcher.wait();
+
+    // Carol's balance is found through the number reserved for her.
+    const auto reserved = cache.peek(Registry::reservedKey(Ident("carol")));
+    TS_ASSERT(reserved.has_value());
+    const uint32_t number = Buffer::deserialize<uint32_t>(*reserved);
+    TS_ASSERT_EQUALS(number, accounts.size() + 1);
+    const auto key = PagedArray<uint256_t>::pageKey(
+        Token::balancesKey(Ident("Band")),
+        number / PagedArray<uint256_t>::ElementsPerPage);
+    TS_ASSERT(cache.peek(key).has_value());
+  }
+
+  void testMalformedTransactionIsIgnored()
+  {
+    StorageMap backend;
+    StorageCache cache(backend, false);
+    Prefetcher prefetcher(cache);
+
+    const std::string raw = "garbage";
+    prefetcher.enqueue(gsl::as_bytes(gsl::make_span(raw)));
+    prefetcher.wait();
+    TS_ASSERT(!cache.peek("u/garbage").has_value());
+  }
+};
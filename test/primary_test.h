@@ -0,0 +1,142 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include "contract/account.h"
+#include "contract/registry.h"
+#include "contract/token.h"
+#include "inc/essential.h"
+#include "listener/manager.h"
+#include "listener/primary.h"
+#include "store/storage_map.h"
+#include "util/buffer.h"
+#include "util/msg.h"
+
+class PrimaryTest : public CxxTest::TestSuite
+{
+public:
+  void testCheckKeepsNoncesUntilCommit()
+  {
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain({});
+
+    const std::string first = transaction(1);
+    const std::string second = transaction(2);
+    manager.checkTransaction(gsl::as_bytes(gsl::make_span(first)));
+    // The same transaction is not admitted twice.
+    TS_ASSERT_THROWS(
+        manager.checkTransaction(gsl::as_bytes(gsl::make_span(first))),
+        const Error&);
+    manager.checkTransaction(gsl::as_bytes(gsl::make_span(second)));
+
+    // A failed check leaves nothing behind.
+    const std::string stranger = transaction(1, Ident("stranger"));
+    TS_ASSERT_THROWS(
+        manager.checkTransaction(gsl::as_bytes(gsl::make_span(stranger))),
+        const Error&);
+
+    // Executing the block does not depend on the checks.
+    manager.beginBlock(0, Address());
+    manager.applyTransaction(gsl::as_bytes(gsl::make_span(first)));
+    manager.commitBlock();
+    storage.switchToApply();
+    TS_ASSERT_EQUALS(1, Buffer::deserialize<uint256_t>(
+                            *storage.get(Account::nonceKey(Ident("BandGod")))));
+
+    // After the commit, the checks start over from the committed state.
+    TS_ASSERT_THROWS(
+        manager.checkTransaction(gsl::as_bytes(gsl::make_span(first))),
+        const Error&);
+    manager.checkTransaction(gsl::as_bytes(gsl::make_span(second)));
+    TS_ASSERT_THROWS(
+        manager.checkTransaction(gsl::as_bytes(gsl::make_span(second))),
+        const Error&);
+  }
+
+  void testCheckDoesNotSeeExecutingBlock()
+  {
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain({});
+
+    // The delivered transaction is flushed but not committed, so checking it
+    // again still starts from the state of the last block.
+    const std::string first = transaction(1);
+    manager.beginBlock(0, Address());
+    manager.applyTransaction(gsl::as_bytes(gsl::make_span(first)));
+    manager.checkTransaction(gsl::as_bytes(gsl::make_span(first)));
+    manager.commitBlock();
+
+    TS_ASSERT_THROWS(
+        manager.checkTransaction(gsl::as_bytes(gsl::make_span(first))),
+        const Error&);
+  }
+
+  void testCreateAccountKeepsBalance()
+  {
+    StorageMap storage;
+    ListenerManager manager;
+    manager.setPrimary(std::make_unique<PrimaryListener>(storage));
+    manager.initChain({});
+
+    // Carol receives tokens before she registers.
+    const std::string mint = transaction(1);
+    const std::string send = transaction(
+        2, MsgType::TransferToken,
+        TransferTokenMsg{Ident("Band"), Ident("carol"), 10});
+    const std::string create =
+        transaction(3, MsgType::CreateAccount,
+                    CreateAccountMsg{VerifyKey(), Ident("carol")});
+    manager.beginBlock(0, Address());
+    manager.applyTransaction(gsl::as_bytes(gsl::make_span(mint)));
+    manager.applyTransaction(gsl::as_bytes(gsl::make_span(send)));
+    manager.applyTransaction(gsl::as_bytes(gsl::make_span(create)));
+    manager.commitBlock();
+
+    // Her account takes the number reserved for her, so the balance is kept.
+    storage.switchToApply();
+    TS_ASSERT(!storage.get(Registry::reservedKey(Ident("carol"))));
+    auto& token = storage.load<Token>(Ident("Band"));
+    TS_ASSERT_THROWS(token.transfer(Ident("carol"), Ident("BandGod"), 11),
+                     const Error&);
+    token.transfer(Ident("carol"), Ident("BandGod"), 10);
+  }
+
+private:
+  static std::string transaction(uint64_t nonce,
+                                 const Ident& user = Ident("BandGod"))
+  {
+    return transaction(nonce, MsgType::MintToken,
+                       MintTokenMsg{Ident("Band"), 10}, user);
+  }
+
+  template <typename T>
+  static std::string transaction(uint64_t nonce,
+                                 MsgType type,
+                                 const T& msg,
+                                 const Ident& user = Ident("BandGod"))
+  {
+    Buffer buf;
+    buf << user << Signature() << nonce;
+    buf << type << msg;
+    return buf.to_raw_string();
+  }
+};
@@ -17,6 +17,7 @@
 
 #include <cxxtest/TestSuite.h>
 
+#include "counting_storage.h"
 #include "inc/essential.h"
 #include "store/contract.h"
 #include "store/graph_set.h"
@@ -230,4 +231,99 @@ public:
     //   }
     // }
   }
+
+  void testReinsertIsNotWritten()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestContract>(Ident{"set"});
+    auto& setContract = backend.load<TestContract>(Ident{"set"});
+    for (uint16_t val = 0; val < 20; ++val)
+      setContract.s.insert(val);
+    backend.flush();
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    auto& countedContract = storage.load<TestContract>(Ident{"set"});
+    TS_ASSERT(!countedContract.s.insert(7));
+    TS_ASSERT(!countedContract.s.erase(42));
+    storage.flush();
+    TS_ASSERT_EQUALS(0, storage.writes());
+  }
+
+  void testBuildFromSorted()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestContract>(Ident{"set"});
+    backend.flush();
+    std::vector<uint16_t> values;
+    for (uint16_t val = 0; val < 1000; ++val)
+      values.push_back(3 * val);
+    {
+      CountingStorage storage(backend);
+      storage.switchToApply();
+      auto& setContract = storage.load<TestContract>(Ident{"set"});
+      setContract.s.buildFromSorted(values);
+      storage.flush();
+
+      // One write per node, plus the header.
+      TS_ASSERT_EQUALS(1001, storage.puts);
+      TS_ASSERT_EQUALS(1001, storage.writes());
+    }
+
+    backend.switchToApply();
+    auto& setContract = backend.load<TestContract>(Ident{"set"});
+    TS_ASSERT_EQUALS(1000, setContract.s.size());
+    TS_ASSERT(setContract.s.contains(2997));
+    TS_ASSERT(!setContract.s.contains(2998));
+    auto it = setContract.s.begin();
+    for (uint16_t val = 0; val < 1000; ++val, ++it)
+      TS_ASSERT_EQUALS(3 * val, *it);
+
+    TS_ASSERT_THROWS_ANYTHING(setContract.s.buildFromSorted(
+        std::vector<uint16_t>{1, 1}));
+  }
+
+  void testMergeFromSorted()
+  {
+    StorageMap storage;
+    storage.switchToApply();
+    storage.create<TestContract>(Ident{"set"});
+    {
+      storage.switchToApply();
+      auto& setContract = storage.load<TestContract>(Ident{"set"});
+      for (uint16_t val : {10, 20, 30, 40})
+        setContract.s.insert(val);
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& setContract = storage.load<TestContract>(Ident{"set"});
+      setContract.s.mergeFromSorted(std::vector<uint16_t>{5, 20, 35, 50});
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& setContract = storage.load<TestContract>(Ident{"set"});
+      TS_ASSERT_EQUALS(7, setContract.s.size());
+      auto it = setContract.s.begin();
+      for (uint16_t val : {5, 10, 20, 30, 35, 40, 50}) {
+        TS_ASSERT_EQUALS(val, *it);
+        ++it;
+      }
+
+      // The rebuilt tree keeps working with the usual operations.
+      TS_ASSERT(setContract.s.erase(20));
+      TS_ASSERT(setContract.s.insert(25));
+      storage.flush();
+    }
+    {
+      storage.switchToApply();
+      auto& setContract = storage.load<TestContract>(Ident{"set"});
+      TS_ASSERT_EQUALS(7, setContract.s.size());
+      TS_ASSERT(setContract.s.contains(25));
+      TS_ASSERT(!setContract.s.contains(20));
+      TS_ASSERT_EQUALS(50, setContract.s.maxValue());
+    }
+  }
 };
@@ -0,0 +1,263 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+#include "inc/essential.h"
+#include "store/storage_btree.h"
+
+class StorageBTreeTest : public CxxTest::TestSuite
+{
+public:
+  const std::string path = "/tmp/band_storage_btree_test.db";
+
+  void setUp()
+  {
+    std::remove(path.c_str());
+  }
+
+  void tearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  void testCheckAndApplyModes()
+  {
+    StorageBTree storage(path);
+
+    storage.switchToApply();
+    storage.put("a", "1");
+    storage.switchToCheck();
+    storage.put("b", "2");
+    TS_ASSERT(!storage.get("a").has_value());
+    TS_ASSERT_EQUALS("2", *storage.get("b"));
+
+    storage.commit();
+
+    // Check-mode changes are discarded while apply-mode changes are persisted.
+    storage.switchToCheck();
+    TS_ASSERT_EQUALS("1", *storage.get("a"));
+    TS_ASSERT(!storage.get("b").has_value());
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("1", *storage.get("a"));
+    TS_ASSERT(!storage.get("b").has_value());
+  }
+
+  void testRandomOperationsAcrossReopen()
+  {
+    std::mt19937 rng(42);
+    std::map<std::string, std::string> model;
+    for (int round = 0; round < 4; ++round) {
+      StorageBTree storage(path);
+      storage.switchToApply();
+      for (const auto& [key, val] : model)
+        TS_ASSERT_EQUALS(val, storage.get(key).value_or("<missing>"));
+
+      for (int commit = 0; commit < 5; ++commit) {
+        storage.switchToApply();
+        for (int op = 0; op < 400; ++op) {
+          const std::string key = "key/" + std::to_string(rng() % 1500);
+          if (rng() % 4 == 0) {
+            storage.del(key);
+            model.erase(key);
+          } else {
+            // Mostly small values, with some kept in overflow pages.
+            const size_t size = rng() % 8 == 0 ? rng() % 10000 : rng() % 100;
+            const std::string val(size, 'a' + rng() % 26);
+            storage.put(key, val);
+            model[key] = val;
+          }
+        }
+        storage.commit();
+      }
+
+      storage.switchToApply();
+      for (int idx = 0; idx < 1500; ++idx) {
+        const std::string key = "key/" + std::to_string(idx);
+        auto it = model.find(key);
+        auto val = storage.get(key);
+        TS_ASSERT_EQUALS(it != model.end(), val.has_value());
+        if (it != model.end() && val)
+          TS_ASSERT_EQUALS(it->second, *val);
+      }
+    }
+  }
+
+  void testUncommittedChangesAreDiscarded()
+  {
+    {
+      StorageBTree storage(path);
+      storage.switchToApply();
+      storage.put("a", "1");
+      storage.commit();
+      storage.switchToApply();
+      storage.put("a", "2");
+      storage.put("b", "3");
+    }
+    StorageBTree storage(path);
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("1", *storage.get("a"));
+    TS_ASSERT(!storage.get("b").has_value());
+  }
+
+  void testSnapshotKeepsCommittedState()
+  {
+    StorageBTree storage(path);
+    storage.switchToApply();
+    for (int idx = 0; idx < 1000; ++idx)
+      storage.put(std::to_string(idx), "old");
+    storage.commit();
+
+    auto snapshot = storage.snapshot();
+    for (int commit = 0; commit < 10; ++commit) {
+      storage.switchToApply();
+      for (int idx = 0; idx < 1000; ++idx)
+        storage.put(std::to_string(idx), "new" + std::to_string(commit));
+      storage.commit();
+    }
+
+    // The pages of the snapshot are not reused while it is alive.
+    for (int idx = 0; idx < 1000; ++idx)
+      TS_ASSERT_EQUALS("old", *snapshot->get(std::to_string(idx)));
+    TS_ASSERT_EQUALS("new9", *storage.snapshot()->get("0"));
+  }
+
+  void testBulkLoad()
+  {
+    std::vector<std::pair<std::string, std::string>> entries;
+    for (int idx = 0; idx < 50000; ++idx)
+      entries.emplace_back("{:08}"_format(idx), std::to_string(idx));
+    {
+      StorageBTree storage(path);
+      storage.switchToApply();
+      storage.bulkLoad(entries);
+      storage.commit();
+    }
+
+    StorageBTree storage(path);
+    storage.switchToApply();
+    for (int idx = 0; idx < 50000; idx += 7)
+      TS_ASSERT_EQUALS(std::to_string(idx), *storage.get("{:08}"_format(idx)));
+    TS_ASSERT(!storage.get("{:08}"_format(50000)).has_value());
+
+    // The bulk-loaded tree can be modified as usual.
+    storage.put("{:08}"_format(3), "three");
+    storage.del("{:08}"_format(4));
+    storage.commit();
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("three", *storage.get("{:08}"_format(3)));
+    TS_ASSERT(!storage.get("{:08}"_format(4)).has_value());
+  }
+
+  void testTornMetaPageFallsBack()
+  {
+    {
+      StorageBTree storage(path);
+      storage.switchToApply();
+      storage.put("a", "1");
+      storage.commit();
+      storage.switchToApply();
+      storage.put("a", "2");
+      storage.commit();
+    }
+    {
+      // Transaction 2 wrote meta page 0. Corrupt it.
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(16);
+      file.write("garbage", 7);
+    }
+    StorageBTree storage(path);
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("1", *storage.get("a"));
+  }
+
+  void testTruncatedFileIsRejected()
+  {
+    {
+      StorageBTree storage(path);
+      storage.switchToApply();
+      for (int idx = 0; idx < 1000; ++idx)
+        storage.put(std::to_string(idx), std::string(100, 'x'));
+      storage.put("big", std::string(3 * StorageBTree::PageSize, 'y'));
+      storage.commit();
+    }
+    TS_ASSERT_EQUALS(0, ::truncate(path.c_str(), 4 * StorageBTree::PageSize));
+    TS_ASSERT_THROWS(StorageBTree{path}, const Failure&);
+  }
+
+  void testReleasedPagesAreReused()
+  {
+    StorageBTree storage(path);
+    auto fileSize = [&] { return std::ifstream(path, std::ios::ate).tellg(); };
+    for (int commit = 0; commit < 200; ++commit) {
+      storage.switchToApply();
+      for (int idx = 0; idx < 100; ++idx)
+        storage.put(std::to_string(idx), std::string(100, 'a' + commit % 26));
+      storage.commit();
+    }
+    const auto size = fileSize();
+    for (int commit = 0; commit < 200; ++commit) {
+      storage.switchToApply();
+      for (int idx = 0; idx < 100; ++idx)
+        storage.put(std::to_string(idx), std::string(100, 'a' + commit % 26));
+      storage.commit();
+    }
+    TS_ASSERT_EQUALS(size, fileSize());
+  }
+
+  void testDeletesMergeSparseNodes()
+  {
+    StorageBTree storage(path);
+    auto fileSize = [&] { return std::ifstream(path, std::ios::ate).tellg(); };
+    auto key = [](const std::string& prefix, int idx) {
+      return prefix + std::to_string(100000 + idx);
+    };
+
+    storage.switchToApply();
+    for (int idx = 0; idx < 20000; ++idx)
+      storage.put(key("a", idx), std::string(100, 'a'));
+    storage.commit();
+    const auto size = fileSize();
+
+    // Keep one key in twenty. The leaves left behind are merged, and their
+    // pages can hold the next keys instead of growing the file.
+    storage.switchToApply();
+    for (int idx = 0; idx < 20000; ++idx)
+      if (idx % 20 != 0)
+        storage.del(key("a", idx));
+    storage.commit();
+    for (int commit = 0; commit < 10; ++commit) {
+      storage.switchToApply();
+      for (int idx = 0; idx < 1900; ++idx)
+        storage.put(key("b", commit * 1900 + idx), std::string(100, 'b'));
+      storage.commit();
+    }
+    TS_ASSERT_LESS_THAN(fileSize(), size * 3 / 2);
+
+    storage.switchToApply();
+    for (int idx = 0; idx < 20000; ++idx)
+      TS_ASSERT_EQUALS(idx % 20 == 0, storage.get(key("a", idx)).has_value());
+    for (int idx = 0; idx < 19000; ++idx)
+      TS_ASSERT(storage.get(key("b", idx)).has_value());
+  }
+};
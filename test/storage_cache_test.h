@@ -0,0 +1,190 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+#include <fstream>
+
+#include "inc/essential.h"
+#include "store/storage_cache.h"
+#include "store/storage_map.h"
+
+class StorageCacheTest : public CxxTest::TestSuite
+{
+public:
+  void testCheckAndApplyModes()
+  {
+    StorageMap backend;
+    StorageCache storage(backend, false);
+
+    storage.switchToApply();
+    storage.put("a", "1");
+    storage.switchToCheck();
+    storage.put("b", "2");
+    TS_ASSERT(!storage.get("a").has_value());
+    TS_ASSERT_EQUALS("2", *storage.get("b"));
+
+    storage.commit();
+
+    // Check-mode changes are discarded while apply-mode changes are persisted.
+    storage.switchToCheck();
+    TS_ASSERT_EQUALS("1", *storage.get("a"));
+    TS_ASSERT(!storage.get("b").has_value());
+
+    backend.switchToApply();
+    TS_ASSERT_EQUALS("1", *backend.get("a"));
+    TS_ASSERT(!backend.get("b").has_value());
+  }
+
+  void testPipelinedCommit()
+  {
+    StorageMap backend;
+    StorageCache storage(backend, true);
+
+    for (int block = 0; block < 10; ++block) {
+      storage.switchToApply();
+      storage.put("counter", std::to_string(block));
+      storage.put("block/" + std::to_string(block), "x");
+      if (block > 0)
+        storage.del("block/" + std::to_string(block - 1));
+      storage.commit();
+
+      // The committed state is visible right away, even if the background
+      // write has not finished yet.
+      storage.switchToApply();
+      TS_ASSERT_EQUALS(std::to_string(block), *storage.get("counter"));
+      TS_ASSERT(storage.get("block/" + std::to_string(block)).has_value());
+    }
+
+    storage.sync();
+    backend.switchToApply();
+    TS_ASSERT_EQUALS("9", *backend.get("counter"));
+    TS_ASSERT(backend.get("block/9").has_value());
+    TS_ASSERT(!backend.get("block/8").has_value());
+  }
+
+  void testPipelinedCommitInChunks()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.put("cold", "c");
+    StorageCache storage(backend, true);
+
+    const size_t count = 3 * StorageCache::PersistChunkSize + 1;
+    storage.switchToApply();
+    for (size_t idx = 0; idx < count; ++idx)
+      storage.put("key/" + std::to_string(idx), std::to_string(idx));
+    storage.commit();
+
+    // Read misses go to the backend while the block is being written.
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("c", *storage.get("cold"));
+    TS_ASSERT_EQUALS("7", *storage.get("key/7"));
+
+    storage.sync();
+    backend.switchToApply();
+    for (size_t idx = 0; idx < count; ++idx)
+      TS_ASSERT_EQUALS(std::to_string(idx),
+                       *backend.get("key/" + std::to_string(idx)));
+  }
+
+  void testFlushesWaitForTheBlockCommit()
+  {
+    StorageMap backend;
+    StorageCache storage(backend, true);
+
+    // Each transaction of the block flushes, but nothing is committed until
+    // the block is.
+    for (int tx = 0; tx < 3; ++tx) {
+      storage.switchToApply();
+      storage.put("tx/" + std::to_string(tx), "x");
+      storage.flush();
+    }
+    storage.sync();
+    backend.switchToApply();
+    TS_ASSERT(!backend.get("tx/0").has_value());
+    TS_ASSERT(!storage.getCommitted("tx/2").has_value());
+
+    storage.commit();
+    TS_ASSERT_EQUALS("x", *storage.getCommitted("tx/2"));
+    storage.sync();
+    backend.switchToApply();
+    for (int tx = 0; tx < 3; ++tx)
+      TS_ASSERT_EQUALS("x", *backend.get("tx/" + std::to_string(tx)));
+  }
+
+  void testWarmupFromAccessProfile()
+  {
+    const std::string path = "/tmp/band_storage_cache_test.profile";
+    std::remove(path.c_str());
+
+    StorageMap backend;
+    {
+      StorageCache storage(backend, false, path);
+      storage.switchToApply();
+      storage.put("hot", "1");
+      storage.put("cold", "2");
+      storage.commit();
+      storage.switchToApply();
+      for (int idx = 0; idx < 10; ++idx)
+        storage.get("hot");
+    }
+
+    StorageCache storage(backend, false, path);
+    storage.warmup();
+
+    // Change the backend behind the cache to observe that "hot" is now served
+    // from the read cache while "cold" still goes to the backend.
+    backend.applyCache["hot"] = "stale";
+    backend.applyCache["cold"] = "3";
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("1", *storage.get("hot"));
+    TS_ASSERT_EQUALS("3", *storage.get("cold"));
+
+    // Committed writes keep the read cache up to date.
+    storage.put("hot", "4");
+    storage.commit();
+    storage.switchToApply();
+    TS_ASSERT_EQUALS("4", *storage.get("hot"));
+
+    std::remove(path.c_str());
+  }
+
+  void testWarmupFromCorruptProfile()
+  {
+    const std::string path = "/tmp/band_storage_cache_test_corrupt.profile";
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file << "\xff\xff\xff\xff\xff\xff\xff\xffgarbage";
+    }
+
+    // The bogus entry count is rejected before anything is allocated.
+    AccessProfile profile(16);
+    TS_ASSERT_THROWS(profile.load(path), const Failure&);
+
+    StorageMap backend;
+    backend.switchToApply();
+    backend.put("a", "1");
+    {
+      StorageCache storage(backend, false, path);
+      TS_ASSERT_THROWS_NOTHING(storage.warmup());
+      storage.switchToApply();
+      TS_ASSERT_EQUALS("1", *storage.get("a"));
+    }
+
+    std::remove(path.c_str());
+  }
+};
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cxxtest/TestSuite.h>
+
+#include <fstream>
+
+#include "inc/essential.h"
+#include "store/storage_map.h"
+#include "store/storage_trace.h"
+
+class StorageTraceTest : public CxxTest::TestSuite
+{
+public:
+  void testRecordAndRead()
+  {
+    const std::string path = "/tmp/band_storage_trace_test.trace";
+    StorageMap backend;
+    {
+      StorageTrace storage(backend, path);
+      storage.switchToApply();
+      // Enough records to span several frames.
+      for (int idx = 0; idx < 1000; ++idx)
+        storage.put("key/" + std::to_string(idx), std::string(idx % 7, 'v'));
+      TS_ASSERT_EQUALS("vvvvvv", *storage.get("key/6"));
+      storage.del("key/6");
+      storage.commit();
+      storage.switchToCheck();
+      TS_ASSERT(!storage.get("key/6").has_value());
+    }
+
+    TraceReader reader(path);
+    auto record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::SwitchToApply, record->op);
+    for (int idx = 0; idx < 1000; ++idx) {
+      record = reader.next();
+      TS_ASSERT_EQUALS(+TraceOp::Put, record->op);
+      TS_ASSERT_EQUALS("key/" + std::to_string(idx), record->key);
+      TS_ASSERT_EQUALS(uint64_t(idx % 7), record->valueSize);
+    }
+    record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::Get, record->op);
+    TS_ASSERT_EQUALS(6, record->valueSize);
+    TS_ASSERT_EQUALS(+TraceOp::Del, reader.next()->op);
+    TS_ASSERT_EQUALS(+TraceOp::Commit, reader.next()->op);
+    TS_ASSERT_EQUALS(+TraceOp::SwitchToCheck, reader.next()->op);
+    record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::Get, record->op);
+    TS_ASSERT_EQUALS(0, record->valueSize);
+    TS_ASSERT(!reader.next().has_value());
+
+    std::remove(path.c_str());
+  }
+
+  void testRecordAddAndBulkLoad()
+  {
+    const std::string path = "/tmp/band_storage_trace_test_bulk.trace";
+    StorageMap backend;
+    {
+      StorageTrace storage(backend, path);
+      storage.switchToApply();
+      storage.bulkLoad({{"a", "vv"}, {"b", "vvv"}});
+      storage.add("c", 42);
+    }
+    backend.switchToApply();
+    TS_ASSERT_EQUALS("vvv", *backend.get("b"));
+
+    TraceReader reader(path);
+    TS_ASSERT_EQUALS(+TraceOp::SwitchToApply, reader.next()->op);
+    auto record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::BulkLoad, record->op);
+    TS_ASSERT_EQUALS(2, record->valueSize);
+    record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::Put, record->op);
+    TS_ASSERT_EQUALS("a", record->key);
+    TS_ASSERT_EQUALS(2, record->valueSize);
+    TS_ASSERT_EQUALS("b", reader.next()->key);
+    record = reader.next();
+    TS_ASSERT_EQUALS(+TraceOp::Add, record->op);
+    TS_ASSERT_EQUALS(42, record->delta);
+    TS_ASSERT(!reader.next().has_value());
+
+    std::remove(path.c_str());
+  }
+
+  void testFrameLengthIsChecked()
+  {
+    // A frame claiming far more bytes than the file holds.
+    const std::string path = "/tmp/band_storage_trace_test_corrupt.trace";
+    {
+      Buffer header;
+      header << (uint64_t(1) << 40);
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file << header.to_raw_string() << "abc";
+    }
+
+    TraceReader reader(path);
+    TS_ASSERT_THROWS(reader.next(), const Failure&);
+
+    std::remove(path.c_str());
+  }
+};
@@ -0,0 +1,103 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <atomic>
+#include <cxxtest/TestSuite.h>
+#include <thread>
+
+#include "inc/essential.h"
+#include "store/storage_cache.h"
+#include "store/storage_map.h"
+#include "store/storage_view.h"
+
+class StorageViewTest : public CxxTest::TestSuite
+{
+public:
+  void testReadsCommittedState()
+  {
+    StorageMap base;
+    StorageView view(base);
+
+    base.switchToApply();
+    base.put("a", "1");
+    base.commit();
+    base.switchToApply();
+    base.put("a", "2");
+    base.put("b", "2");
+
+    // Changes of the block being executed are not visible to the view.
+    TS_ASSERT_EQUALS("1", *view.get("a"));
+    TS_ASSERT(!view.get("b").has_value());
+
+    // Changes made in the view never reach the base and last until cleared.
+    view.put("a", "3");
+    view.put("c", "3");
+    view.flush();
+    TS_ASSERT_EQUALS("3", *view.get("a"));
+    TS_ASSERT_EQUALS("3", *view.get("c"));
+    TS_ASSERT_EQUALS("2", *base.get("a"));
+    TS_ASSERT(!base.get("c").has_value());
+
+    view.del("a");
+    TS_ASSERT(!view.get("a").has_value());
+
+    base.commit();
+    view.clear();
+    TS_ASSERT_EQUALS("2", *view.get("a"));
+    TS_ASSERT_EQUALS("2", *view.get("b"));
+    TS_ASSERT(!view.get("c").has_value());
+  }
+
+  void testReadsWhileCommitting()
+  {
+    StorageMap backend;
+    StorageCache cache(backend, true);
+    cache.switchToApply();
+    cache.put("counter", "0");
+    cache.commit();
+
+    // A reader on another thread only ever sees committed counters, in order.
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+    std::thread reader([&] {
+      StorageView view(cache);
+      int last = 0;
+      while (!done) {
+        const int counter = std::stoi(*view.get("counter"));
+        if (counter < last || counter % 2 != 0)
+          ++errors;
+        last = counter;
+      }
+    });
+
+    for (int block = 1; block <= 200; ++block) {
+      cache.switchToApply();
+      cache.put("counter", std::to_string(2 * block - 1));
+      cache.put("counter", std::to_string(2 * block));
+      cache.put("block/" + std::to_string(block), "x");
+      cache.commit();
+    }
+    done = true;
+    reader.join();
+    TS_ASSERT_EQUALS(0, errors);
+
+    StorageView view(cache);
+    TS_ASSERT_EQUALS("400", *view.get("counter"));
+    cache.sync();
+    TS_ASSERT_EQUALS("400", *view.get("counter"));
+  }
+};
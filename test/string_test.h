@@ -0,0 +1,86 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include <cxxtest/TestSuite.h>
+#include <unordered_set>
+
+#include "inc/essential.h"
+#include "util/buffer.h"
+#include "util/string.h"
+
+class StringTest : public CxxTest::TestSuite
+{
+public:
+  void testLowerCase()
+  {
+    Ident ident{"Hello-World_[AZ@az]"};
+    TS_ASSERT_EQUALS("hello-world_[az@az]", ident.to_string());
+    TS_ASSERT_EQUALS(Ident{"hello-world_[az@az]"}.hash(), ident.hash());
+    TS_ASSERT(Ident{"HELLO-WORLD_[AZ@AZ]"} == ident);
+
+    NodeID node{"Hello World"};
+    TS_ASSERT_EQUALS("Hello World", node.to_string());
+    TS_ASSERT(NodeID{"hello world"} != node);
+  }
+
+  void testValidate()
+  {
+    TS_ASSERT_THROWS_ANYTHING(Ident{std::string(21, 'a')});
+    TS_ASSERT_EQUALS(20, Ident{std::string(20, 'a')}.to_string().size());
+    TS_ASSERT_EQUALS(128, NodeID{std::string(128, '~')}.to_string().size());
+    TS_ASSERT_THROWS_ANYTHING(NodeID{std::string(129, 'a')});
+
+    // Unprintable characters are rejected at every position.
+    for (size_t idx = 0; idx < 40; ++idx) {
+      for (char bad : {'\0', '\n', '\x1f', '\x7f', '\x80', '\xff'}) {
+        std::string raw(40, 'x');
+        raw[idx] = bad;
+        TS_ASSERT_THROWS_ANYTHING(NodeID{raw});
+      }
+    }
+  }
+
+  void testBufferRoundTrip()
+  {
+    Ident ident{"Band"};
+    TS_ASSERT_EQUALS(Buffer::serialize(std::string("band")),
+                     Buffer::serialize(ident));
+    TS_ASSERT_EQUALS(encoded_size(ident), Buffer::serialize(ident).size());
+
+    const Ident decoded = Buffer::deserialize<Ident>(
+        Buffer::serialize(std::string("BAND")));
+    TS_ASSERT(decoded == ident);
+    TS_ASSERT_EQUALS(ident.hash(), decoded.hash());
+
+    TS_ASSERT_THROWS_ANYTHING(
+        Buffer::deserialize<Ident>(Buffer::serialize(std::string(21, 'a'))));
+    TS_ASSERT_THROWS_ANYTHING(
+        Buffer::deserialize<Ident>(Buffer::serialize(std::string("a\tb"))));
+  }
+
+  void testHashKey()
+  {
+    std::unordered_set<Ident> idents;
+    for (int idx = 0; idx < 100; ++idx)
+      idents.insert(Ident{"user" + std::to_string(idx)});
+    idents.insert(Ident{"USER7"});
+    idents.insert(Ident{});
+    TS_ASSERT_EQUALS(101, idents.size());
+    TS_ASSERT_EQUALS(1, idents.count(Ident{"User42"}));
+    TS_ASSERT_EQUALS(1, idents.count(Ident{""}));
+    TS_ASSERT(Ident{}.empty());
+  }
+};
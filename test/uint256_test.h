@@ -0,0 +1,155 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the LICENSE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include <cxxtest/TestSuite.h>
+#include <random>
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "inc/essential.h"
+#include "util/buffer.h"
+
+class UInt256Test : public CxxTest::TestSuite
+{
+public:
+  using Reference = boost::multiprecision::checked_uint256_t;
+
+  void testArithmeticMatchesReference()
+  {
+    std::mt19937_64 rng(7);
+    for (int round = 0; round < 5000; ++round) {
+      const uint256_t lhs = random(rng);
+      const uint256_t rhs = random(rng);
+      const Reference refLhs = reference(lhs);
+      const Reference refRhs = reference(rhs);
+
+      TS_ASSERT_EQUALS(lhs < rhs, refLhs < refRhs);
+      TS_ASSERT_EQUALS(lhs == rhs, refLhs == refRhs);
+      check([&] { return lhs + rhs; }, [&] { return refLhs + refRhs; });
+      check([&] { return lhs - rhs; }, [&] { return refLhs - refRhs; });
+      check([&] { return lhs * rhs; }, [&] { return refLhs * refRhs; });
+      if (rhs) {
+        TS_ASSERT_EQUALS((lhs / rhs).str(), Reference(refLhs / refRhs).str());
+        TS_ASSERT_EQUALS((lhs % rhs).str(), Reference(refLhs % refRhs).str());
+      }
+      const unsigned shift = rng() % 256;
+      TS_ASSERT_EQUALS((lhs >> shift).str(), Reference(refLhs >> shift).str());
+      TS_ASSERT_EQUALS(lhs.str(), refLhs.str());
+    }
+  }
+
+  void testDivisionByMultiLimbDivisors()
+  {
+    // Operands built from all-ones, all-zeros and high-bit limbs make the
+    // quotient estimates of long division need correcting.
+    const uint64_t patterns[] = {0,
+                                 1,
+                                 0x8000000000000000ull,
+                                 0x7fffffffffffffffull,
+                                 0xffffffffffffffffull,
+                                 0xfffffffffffffffeull};
+    std::mt19937_64 rng(11);
+    for (int round = 0; round < 20000; ++round) {
+      UInt256::Limbs lhsLimbs, rhsLimbs;
+      for (auto& limb : lhsLimbs)
+        limb = rng() % 3 == 0 ? rng() : patterns[rng() % 6];
+      for (auto& limb : rhsLimbs)
+        limb = rng() % 3 == 0 ? rng() : patterns[rng() % 6];
+      for (size_t idx = 1 + rng() % 4; idx < UInt256::LimbCount; ++idx)
+        rhsLimbs[idx] = 0;
+      const uint256_t lhs = uint256_t::fromLimbs(lhsLimbs);
+      const uint256_t rhs = uint256_t::fromLimbs(rhsLimbs);
+      if (!rhs)
+        continue;
+
+      uint256_t quotient, remainder;
+      uint256_t::divmod(lhs, rhs, quotient, remainder);
+      const Reference refLhs = reference(lhs);
+      const Reference refRhs = reference(rhs);
+      TS_ASSERT_EQUALS(quotient.str(), Reference(refLhs / refRhs).str());
+      TS_ASSERT_EQUALS(remainder.str(), Reference(refLhs % refRhs).str());
+    }
+  }
+
+  void testCheckedOverflow()
+  {
+    const uint256_t max = ~uint256_t(0);
+    TS_ASSERT_EQUALS(max, std::numeric_limits<uint256_t>::max());
+    TS_ASSERT_THROWS(max + 1, const std::overflow_error&);
+    TS_ASSERT_THROWS(uint256_t(3) - 4, const std::range_error&);
+    TS_ASSERT_THROWS(max * 2, const std::overflow_error&);
+    TS_ASSERT_THROWS((uint256_t(1) << 128) * (uint256_t(1) << 128),
+                     const std::overflow_error&);
+    TS_ASSERT_THROWS(max / 0, const std::overflow_error&);
+    TS_ASSERT_THROWS(max << 1, const std::overflow_error&);
+    TS_ASSERT_THROWS(uint256_t(-1), const std::range_error&);
+    TS_ASSERT_THROWS(static_cast<uint64_t>(uint256_t(1) << 64),
+                     const std::overflow_error&);
+
+    // A failed operation leaves the value untouched.
+    uint256_t value = max;
+    TS_ASSERT_THROWS_ANYTHING(value += 1);
+    TS_ASSERT_EQUALS(max, value);
+  }
+
+  void testStringConversion()
+  {
+    const std::string digits = "1157920892373161954235709850086879078532699846"
+                               "65640564039457584007913129639935";
+    TS_ASSERT_EQUALS(~uint256_t(0), uint256_t{digits});
+    TS_ASSERT_EQUALS(digits, (~uint256_t(0)).str());
+    TS_ASSERT_EQUALS(uint256_t(255), uint256_t{"0xff"});
+    TS_ASSERT_EQUALS("0", uint256_t(0).str());
+    TS_ASSERT_EQUALS("10000000000000000000", uint256_t{"10000000000000000000"}
+                                                 .str());
+    TS_ASSERT_EQUALS("1000", "{}"_format(uint256_t(1000)));
+    TS_ASSERT_THROWS_ANYTHING(uint256_t{"12a"});
+    TS_ASSERT_THROWS_ANYTHING(uint256_t{""});
+    TS_ASSERT_THROWS_ANYTHING(uint256_t{digits + "0"});
+  }
+
+private:
+  static uint256_t random(std::mt19937_64& rng)
+  {
+    // Mix small and large values so that every carry path is exercised.
+    const unsigned bits = rng() % 257;
+    uint256_t::Limbs limbs{rng(), rng(), rng(), rng()};
+    return bits == 256 ? uint256_t::fromLimbs(limbs)
+                       : uint256_t::fromLimbs(limbs) >> (256 - bits);
+  }
+
+  static Reference reference(const uint256_t& val)
+  {
+    return Reference(val.str());
+  }
+
+  /// Check that both computations either throw or produce the same value.
+  template <typename Fn, typename RefFn>
+  static void check(Fn&& actual, RefFn&& expected)
+  {
+    std::string actualResult = "throw";
+    std::string expectedResult = "throw";
+    try {
+      actualResult = actual().str();
+    } catch (const std::exception&) {
+    }
+    try {
+      expectedResult = Reference(expected()).str();
+    } catch (const std::exception&) {
+    }
+    TS_ASSERT_EQUALS(actualResult, expectedResult);
+  }
+};
@@ -16,9 +16,12 @@
 // under the License.
 
 #include <cxxtest/TestSuite.h>
+#include <random>
 
 #include "inc/essential.h"
 #include "util/buffer.h"
+#include "util/equation.h"
+#include "util/msg.h"
 
 class VarintTest : public CxxTest::TestSuite
 {
@@ -51,4 +54,98 @@ public:
     TS_ASSERT_EQUALS(val, decoded_val);
     TS_ASSERT_EQUALS(buf.size_bytes(), 1);
   }
+
+  void testVarintMatchesReferenceCodec()
+  {
+    // The reference codec processes one 7-bit group per step.
+    auto reference = [](uint256_t val) {
+      Buffer buf;
+      do {
+        std::byte group{uint8_t(val & 0x7F)};
+        val >>= 7;
+        buf << (val != 0 ? group | std::byte{0x80} : group);
+      } while (val != 0);
+      return buf.to_raw_string();
+    };
+
+    std::mt19937_64 rng(42);
+    for (int round = 0; round < 2000; ++round) {
+      uint64_t small = rng() >> (rng() % 64);
+      TS_ASSERT_EQUALS(reference(small), Buffer::serialize(small));
+      TS_ASSERT_EQUALS(small,
+                       Buffer::deserialize<uint64_t>(reference(small)));
+
+      uint256_t large = 0;
+      for (int limb = 0; limb < 4; ++limb)
+        large = (large << 64) | rng();
+      large >>= rng() % 256;
+      TS_ASSERT_EQUALS(reference(large), Buffer::serialize(large));
+      TS_ASSERT_EQUALS(large,
+                       Buffer::deserialize<uint256_t>(reference(large)));
+    }
+
+    uint256_t max = ~uint256_t(0);
+    TS_ASSERT_EQUALS(37, Buffer::serialize(max).size());
+    TS_ASSERT_EQUALS(max, Buffer::deserialize<uint256_t>(reference(max)));
+    // 36 full groups followed by a 7-bit group do not fit in 256 bits.
+    TS_ASSERT_THROWS_ANYTHING(Buffer::deserialize<uint256_t>(
+        std::string(36, '\xff') + std::string(1, '\x7f')));
+    TS_ASSERT_EQUALS(max,
+                     Buffer::deserialize<uint256_t>(std::string(36, '\xff') +
+                                                    std::string(1, '\x0f')));
+  }
+
+  void testVarintDecodeRun()
+  {
+    std::vector<uint64_t> small{0, 1, 127, 128, 300, ~uint64_t(0)};
+    std::vector<uint256_t> large{0, uint256_t(1) << 70, ~uint256_t(0), 5};
+    Buffer buf;
+    buf << small << large << std::byte{0xAB};
+
+    std::vector<uint64_t> smallRead;
+    std::vector<uint256_t> largeRead;
+    buf >> smallRead >> largeRead;
+    TS_ASSERT_EQUALS(small, smallRead);
+    TS_ASSERT_EQUALS(large, largeRead);
+    TS_ASSERT_EQUALS(1, buf.size_bytes());
+
+    Buffer truncated;
+    truncated << uint64_t(2) << std::byte{0x05} << std::byte{0x80};
+    TS_ASSERT_THROWS_ANYTHING(truncated.read<std::vector<uint16_t>>());
+  }
+
+  void testVarintSize()
+  {
+    static_assert(varint_size(uint64_t(0)) == 1);
+    static_assert(varint_size(uint64_t(127)) == 1);
+    static_assert(varint_size(uint64_t(128)) == 2);
+    static_assert(varint_size(~uint64_t(0)) == 10);
+    static_assert(encoded_size(VerifyKey()) == 32);
+
+    for (uint64_t val : {0ull, 1ull, 300ull, 1ull << 35, ~0ull}) {
+      TS_ASSERT_EQUALS(Buffer::serialize(val).size(), encoded_size(val));
+      TS_ASSERT_EQUALS(Buffer::serialize(uint256_t(val) << 100).size(),
+                       encoded_size(uint256_t(val) << 100));
+    }
+  }
+
+  void testStructEncodedSize()
+  {
+    HeaderMsg header;
+    header.user = Ident{"alice"};
+    header.nonce = 1000;
+    TS_ASSERT_EQUALS(Buffer::serialize(header).size(), header.encodedSize());
+
+    CreateTokenMsg msg;
+    msg.baseToken = Ident{"band"};
+    msg.createdToken = Ident{"token"};
+    msg.curve = Curve(std::make_unique<EqAdd>(
+        std::make_unique<EqVar>(), std::make_unique<EqConstant>(1000000)));
+    TS_ASSERT_EQUALS(Buffer::serialize(msg).size(), msg.encodedSize());
+
+    std::vector<std::pair<Ident, uint256_t>> entries{{Ident{"a"}, 1},
+                                                     {Ident{"bcd"}, 1 << 20}};
+    TS_ASSERT_EQUALS(Buffer::serialize(entries).size(), encoded_size(entries));
+    TS_ASSERT_EQUALS(0, encoded_size(CreateTokenResponse{}));
+  }
 };
@@ -17,6 +17,7 @@
 
 #include <cxxtest/TestSuite.h>
 
+#include "counting_storage.h"
 #include "inc/essential.h"
 #include "store/contract.h"
 #include "store/graph_set.h"
@@ -96,4 +97,21 @@ public:
       TS_ASSERT_EQUALS(5, testContract.v.lowerBoundIndex(100));
     }
   }
+
+  void testLoadWithoutUseReadsNothing()
+  {
+    StorageMap backend;
+    backend.switchToApply();
+    backend.create<TestVectorContract>(Ident{"vector"});
+    backend.flush();
+    CountingStorage storage(backend);
+    storage.switchToApply();
+    storage.load<TestVectorContract>(Ident{"vector"});
+    storage.flush();
+
+    // Only the contract itself is looked up. The vector never touches the
+    // storage since it is not used.
+    TS_ASSERT_EQUALS(1, storage.gets);
+    TS_ASSERT_EQUALS(0, storage.writes());
+  }
 };